@@ -18,6 +18,12 @@ int main(int argc, char **argv)
         auto version = false;
         auto ask = false;
         auto port = std::uint16_t{8080};
+        auto db_acquire_timeout_ms = config::db_acquire_timeout().count();
+        auto db_probe_after_ms = config::db_probe_after().count();
+        auto session_ttl_min = config::session_ttl().count();
+        auto session_idle_ttl_min = config::session_idle_ttl().count();
+        auto durability = std::string{"commit"};
+        auto ingest = std::string{};
 
         CLI::App app("homework-collection-remastered", "hc");
         app.add_flag("-V,--version", version, "Print hc version and exit");
@@ -25,7 +31,50 @@ int main(int argc, char **argv)
         app.add_flag("--ask", ask,
                      "Ask username and password for database connection");
         app.add_option("-p,--port", port, "Port of the web server");
+        app.add_option("--max-submission-size", config::max_submission_size(),
+                       "Maximum size of a submitted file in bytes");
+        app.add_option("--db-pool-size", config::db_pool_size(),
+                       "Maximum number of database connections");
+        app.add_option("--extract-threads", config::extract_threads(),
+                       "Threads extracting text of submitted files");
+        app.add_option("--http-threads", config::http_threads(),
+                       "HTTP worker threads");
+        app.add_option("--http-max-queued", config::http_max_queued(),
+                       "Connections waiting for an HTTP worker, beyond which "
+                       "they're closed");
+        app.add_option("--job-workers", config::job_workers(),
+                       "Threads running background jobs, e.g. exports");
+        app.add_option("--export-builders", config::export_builders(),
+                       "Threads building exported archives");
+        app.add_option("--max-queued-jobs", config::max_queued_jobs(),
+                       "Background jobs waiting, beyond which they're refused");
+        app.add_option("--aigc-endpoint", config::aigc_endpoint(),
+                       "URL of the AIGC scoring service, empty to disable");
+        app.add_option("--aigc-batch-size", config::aigc_batch_size(),
+                       "Texts sent to the AIGC scoring service per request");
+        app.add_option("--db-acquire-timeout-ms", db_acquire_timeout_ms,
+                       "Milliseconds to wait for a free database connection");
+        app.add_option("--db-probe-after-ms", db_probe_after_ms,
+                       "Milliseconds a database connection may be idle "
+                       "before it's probed on checkout");
+        app.add_option("--session-ttl-min", session_ttl_min,
+                       "Minutes a login lasts, however active it is");
+        app.add_option("--session-idle-ttl-min", session_idle_ttl_min,
+                       "Minutes a login lasts without requests");
+        app.add_option("--durability", durability,
+                       "Acknowledge writes after 'commit' or after 'enqueue'")
+            ->check(CLI::IsMember({"commit", "enqueue"}));
+        app.add_option("--ingest", ingest,
+                       "Ingest submissions from a tar.zst or zip laid out "
+                       "like exports, then exit")
+            ->check(CLI::ExistingFile);
         CLI11_PARSE(app, argc, argv);
+        config::db_acquire_timeout() =
+            std::chrono::milliseconds{db_acquire_timeout_ms};
+        config::db_probe_after() = std::chrono::milliseconds{db_probe_after_ms};
+        config::session_ttl() = std::chrono::minutes{session_ttl_min};
+        config::session_idle_ttl() = std::chrono::minutes{session_idle_ttl_min};
+        config::ack_after_commit() = durability == "commit";
 
         spdlog::set_level(verbose() ? spdlog::level::debug
                                     : spdlog::level::info);
@@ -33,6 +82,20 @@ int main(int argc, char **argv)
         spdlog::debug("verbose={}", verbose());
         spdlog::debug("version={}", version);
         spdlog::debug("port={}", port);
+        spdlog::debug("max_submission_size={}", config::max_submission_size());
+        spdlog::debug("db_pool_size={}", config::db_pool_size());
+        spdlog::debug("db_acquire_timeout={}", config::db_acquire_timeout());
+        spdlog::debug("db_probe_after={}", config::db_probe_after());
+        spdlog::debug("extract_threads={}", config::extract_threads());
+        spdlog::debug("aigc_endpoint={}", config::aigc_endpoint());
+        spdlog::debug("http_threads={}", config::http_threads());
+        spdlog::debug("http_max_queued={}", config::http_max_queued());
+        spdlog::debug("job_workers={}", config::job_workers());
+        spdlog::debug("export_builders={}", config::export_builders());
+        spdlog::debug("session_ttl={}", config::session_ttl());
+        spdlog::debug("session_idle_ttl={}", config::session_idle_ttl());
+        spdlog::debug("durability={}", durability);
+        spdlog::debug("ingest={}", ingest);
 
         if (version) {
             std::println("hc version {}", HCRE_VERSION);
@@ -52,6 +115,14 @@ int main(int argc, char **argv)
         }
 
         Server server(config);
+        if (!ingest.empty()) {
+            auto const result = server.ingest_submissions(ingest);
+            std::println("Ingested {} submissions", result.ingested);
+            for (auto const &skipped : result.skipped) {
+                std::println("Skipped {}", skipped);
+            }
+            return 0;
+        }
         server.start("127.0.0.1", port);
 
         using namespace std::chrono_literals;
@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <cassert>
 #include <hc/mock/mock-client.h>
 #include <httplib.h>
 #include <print>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -9,33 +11,37 @@ using namespace httplib;
 using namespace std::chrono;
 using namespace std::chrono_literals;
 
-int main()
+// Usage: api-assignments-benchmark [max-client-threads] [port]
+//
+// Requests a running server from 1, 2, 4, ... client threads. Start the
+// server with different `--http-threads` to see how throughput scales.
+int main(int argc, char **argv)
 {
-    constexpr auto total_threads = 6UZ;
     constexpr auto total_tasks = 10000Z;
+    auto const max_threads =
+        argc > 1 ? std::stoul(argv[1])
+                 : std::max(std::thread::hardware_concurrency(), 1U);
+    auto const port = argc > 2 ? std::stoi(argv[2]) : 8080;
 
-    // for (auto num_threads = 1UZ; num_threads != total_threads + 1;
-    //      ++num_threads) {
-    constexpr auto num_threads = total_threads;
-    std::atomic_int_least64_t remaining_tasks{total_tasks};
-    auto task = [&]() {
-        Client client("localhost", 8080);
-        client.set_keep_alive(false);
-        client.set_max_timeout(10s);
-        while (true) {
-            auto old = remaining_tasks.fetch_sub(1, std::memory_order_relaxed);
-            if (old <= 0)
-                break;
+    for (auto num_threads = 1UZ; num_threads <= max_threads;
+         num_threads *= 2) {
+        std::atomic_int_least64_t remaining_tasks{total_tasks};
+        auto task = [&]() {
+            Client client("localhost", port);
+            client.set_keep_alive(false);
+            client.set_max_timeout(10s);
+            while (true) {
+                auto old =
+                    remaining_tasks.fetch_sub(1, std::memory_order_relaxed);
+                if (old <= 0)
+                    break;
 
-            hc::mock::successfully_hi(client);
-            auto const res = client.Get("/api/assignments");
-            assert(res && res->status == StatusCode::OK_200);
-            // if ((old - 1) % 100 == 0)
-            //     std::println("executing task: {}", old - 1);
-        }
-    };
+                hc::mock::successfully_hi(client);
+                auto const res = client.Get("/api/assignments");
+                assert(res && res->status == StatusCode::OK_200);
+            }
+        };
 
-    {
         std::vector<std::jthread> threads;
         threads.reserve(num_threads);
 
@@ -49,9 +55,7 @@ int main()
             }
         }
         auto s = duration<double>(steady_clock::now() - start);
-        // std::println("{} tasks in {} ms", total_tasks, ms.count());
         std::println("Threads: {:3}, Rate: {:4} tasks/s", num_threads,
                      static_cast<double>(total_tasks) / s.count());
     }
-    // }
 }
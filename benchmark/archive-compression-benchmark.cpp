@@ -0,0 +1,107 @@
+#include <hc/archive.h>
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <print>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace std::chrono;
+
+namespace {
+
+// Looks like a class of submissions: text reports, with as many bytes of
+// already compressed files (scans, PDFs) that zstd can't shrink.
+std::vector<hc::archive::ManifestEntry> make_corpus(fs::path const &dir,
+                                                    std::size_t &total_bytes)
+{
+    constexpr auto students = 60UZ;
+    constexpr std::array words{
+        "the",      "algorithm", "complexity", "of",     "memory",
+        "server",   "request",   "we",         "report", "result",
+        "function", "return",    "int",        "for",    "while",
+        "student",  "analysis",  "figure",     "table",  "submission",
+    };
+
+    std::mt19937_64 rng{42};
+    std::uniform_int_distribution<std::size_t> pick{0, words.size() - 1};
+    std::vector<hc::archive::ManifestEntry> entries;
+    total_bytes = 0;
+    for (auto i = 0UZ; i != students; ++i) {
+        auto const sdir = dir / std::to_string(i);
+        fs::create_directories(sdir);
+
+        auto const report = sdir / "report.txt";
+        {
+            std::ofstream ofs(report);
+            for (auto w = 0UZ; w != 200'000; ++w) {
+                ofs << words[pick(rng)] << (w % 12 == 11 ? '\n' : ' ');
+            }
+        }
+
+        auto const scan = sdir / "scan.bin";
+        {
+            std::ofstream ofs(scan, std::ios::binary);
+            std::string noise(1 << 20, '\0');
+            for (auto &c : noise) {
+                c = static_cast<char>(rng());
+            }
+            ofs << noise;
+        }
+
+        for (auto const &p : {report, scan}) {
+            total_bytes += fs::file_size(p);
+            entries.push_back(
+                {p, (fs::path{"a"} / std::to_string(i) / p.filename())
+                        .u8string()});
+        }
+    }
+    return entries;
+}
+
+} // namespace
+
+int main()
+{
+    auto const dir = fs::temp_directory_path() / "hc" / "compression-benchmark";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+
+    std::size_t total_bytes{};
+    auto const entries = make_corpus(dir / "corpus", total_bytes);
+    std::println("Corpus: {} files, {:.1f} MiB", entries.size(),
+                 static_cast<double>(total_bytes) / (1 << 20));
+
+    using hc::archive::CompressionProfile;
+    auto const cores = std::thread::hardware_concurrency();
+    std::vector<std::pair<std::string, CompressionProfile>> const profiles{
+        {"default", CompressionProfile{}},
+        {"level 1", {.level = 1}},
+        {"level 9", {.level = 9}},
+        {"level 19", {.level = 19}},
+        {"level 3 mt", {.level = 3, .threads = cores}},
+        {"fast", CompressionProfile::fast()},
+        {"small", CompressionProfile::small()},
+    };
+
+    auto const out = dir / "out.tar.zst";
+    for (auto const &[name, profile] : profiles) {
+        auto const start = steady_clock::now();
+        hc::archive::create_tar_zst(out, entries, profile);
+        auto const s = duration<double>(steady_clock::now() - start);
+        auto const size = fs::file_size(out);
+        std::println("{:12} {:8.1f} MiB/s  ratio {:5.2f}  ({} bytes)", name,
+                     static_cast<double>(total_bytes) / (1 << 20) / s.count(),
+                     static_cast<double>(total_bytes) /
+                         static_cast<double>(size),
+                     size);
+    }
+
+    fs::remove_all(dir);
+}
@@ -0,0 +1,116 @@
+#include <hc/io.h>
+
+#include <array>
+#include <chrono>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <print>
+#include <string>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+using namespace std::chrono;
+
+namespace {
+
+constexpr auto file_size = std::size_t{256} << 20;
+// Size of pieces handed out by httplib's content reader.
+constexpr auto piece_size = std::size_t{16} << 10;
+
+// Drops the file from page cache, so that reads hit the disk.
+void evict(fs::path const &path)
+{
+    hc::io::UniqueFd const fd(path, O_RDONLY);
+    ::fdatasync(fd.get());
+    ::posix_fadvise(fd.get(), 0, 0, POSIX_FADV_DONTNEED);
+}
+
+void report(std::string_view what, std::function<void()> const &f)
+{
+    auto const start = steady_clock::now();
+    f();
+    auto const s = duration<double>(steady_clock::now() - start);
+    std::println("{:28} {:8.1f} MiB/s", what,
+                 static_cast<double>(file_size) / (1 << 20) / s.count());
+}
+
+} // namespace
+
+int main()
+{
+    auto const dir = fs::temp_directory_path() / "hc" / "file-io-benchmark";
+    fs::create_directories(dir);
+    auto const path = dir / "data";
+    auto &engine = hc::io::Engine::local();
+    std::println("Backend: {}, {} x {} KiB buffers", engine.backend(),
+                 engine.depth(), engine.block_size() >> 10);
+
+    std::string piece(piece_size, 'x');
+
+    // Each write goes to a new file like a submission does, rather than
+    // truncating the cached pages of the previous run.
+    fs::remove(path);
+    // What submit used to do: ofstream with a 64 KiB buffer.
+    report("write, ofstream", [&] {
+        auto buf = std::make_unique<char[]>(64 << 10);
+        std::ofstream ofs;
+        ofs.rdbuf()->pubsetbuf(buf.get(), 64 << 10);
+        ofs.open(path, std::ios::binary);
+        for (auto n = 0UZ; n < file_size; n += piece_size) {
+            ofs.write(piece.data(), static_cast<std::streamsize>(piece_size));
+        }
+    });
+    fs::remove(path);
+
+    report("write, hc::io::Writer", [&] {
+        hc::io::UniqueFd const fd(path, O_WRONLY | O_CREAT | O_TRUNC);
+        hc::io::Writer writer(engine, fd.get());
+        for (auto n = 0UZ; n < file_size; n += piece_size) {
+            writer.write(piece);
+        }
+        writer.finish();
+    });
+    evict(path);
+
+    auto sum = std::size_t{}; // Keeps reads from being optimized away
+
+    // What the archive writer used to do: ifstream in 4 KiB chunks.
+    report("cold read, ifstream", [&] {
+        std::ifstream ifs(path, std::ios::binary);
+        std::array<char, 4 << 10> buf{};
+        while (ifs.read(buf.data(), buf.size()) || ifs.gcount() > 0) {
+            sum += static_cast<unsigned char>(buf[0]);
+        }
+    });
+    evict(path);
+
+    report("cold read, hc::io::Reader", [&] {
+        hc::io::UniqueFd const fd(path, O_RDONLY);
+        hc::io::Reader reader(engine, fd.get(), file_size);
+        for (auto b = reader.next(); !b.empty(); b = reader.next()) {
+            sum += static_cast<unsigned char>(b[0]);
+        }
+    });
+
+    report("warm read, ifstream", [&] {
+        std::ifstream ifs(path, std::ios::binary);
+        std::array<char, 4 << 10> buf{};
+        while (ifs.read(buf.data(), buf.size()) || ifs.gcount() > 0) {
+            sum += static_cast<unsigned char>(buf[0]);
+        }
+    });
+
+    report("warm read, hc::io::Reader", [&] {
+        hc::io::UniqueFd const fd(path, O_RDONLY);
+        hc::io::Reader reader(engine, fd.get(), file_size);
+        for (auto b = reader.next(); !b.empty(); b = reader.next()) {
+            sum += static_cast<unsigned char>(b[0]);
+        }
+    });
+
+    std::println("(checksum {})", sum);
+    fs::remove_all(dir);
+}
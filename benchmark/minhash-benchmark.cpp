@@ -0,0 +1,104 @@
+#include <hc/minhash.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <print>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace {
+
+constexpr auto fingerprints_per_document = 64UZ;
+
+// Fingerprints of document `i` of the synthetic corpus, reproducible so that
+// the corpus needn't be kept in memory.
+hc::plagiarism::Fingerprints document(std::size_t i)
+{
+    std::mt19937_64 rng{i};
+    hc::plagiarism::Fingerprints fp(fingerprints_per_document);
+    for (auto &f : fp) {
+        f = rng();
+    }
+    std::ranges::sort(fp);
+    return fp;
+}
+
+// Document `i` with a fifth of it rewritten, i.e. Jaccard similarity ~0.67,
+// like a copy of last year's submission.
+hc::plagiarism::Fingerprints copy_of(std::size_t i, std::mt19937_64 &rng)
+{
+    auto fp = document(i);
+    for (auto j = 0UZ; j < fp.size(); j += 5) {
+        fp[j] = rng();
+    }
+    std::ranges::sort(fp);
+    return fp;
+}
+
+} // namespace
+
+// Usage: minhash-benchmark [documents]
+int main(int argc, char **argv)
+{
+    auto documents = 1'000'000UZ;
+    if (argc > 1) {
+        std::from_chars(argv[1], argv[1] + std::strlen(argv[1]), documents);
+    }
+    constexpr auto queries = 1000UZ;
+    constexpr auto scanned_queries = 10UZ;
+
+    std::vector<hc::minhash::Signature> signatures;
+    signatures.reserve(documents);
+    hc::minhash::LshIndex index;
+    auto start = steady_clock::now();
+    for (auto i = 0UZ; i != documents; ++i) {
+        signatures.push_back(hc::minhash::signature(document(i)));
+        index.put("Assignment " + std::to_string(i % 1000),
+                  std::to_string(i), signatures.back());
+    }
+    auto s = duration<double>(steady_clock::now() - start);
+    std::println("Indexed {} documents in {:.1f} s ({:.1f} us each)",
+                 documents, s.count(),
+                 s.count() * 1e6 / static_cast<double>(documents));
+
+    std::mt19937_64 rng{42};
+    std::vector<std::pair<std::size_t, hc::minhash::Signature>> copies;
+    for (auto q = 0UZ; q != queries; ++q) {
+        auto const i = rng() % documents;
+        copies.emplace_back(i, hc::minhash::signature(copy_of(i, rng)));
+    }
+
+    auto found = 0UZ;
+    auto matches = 0UZ;
+    start = steady_clock::now();
+    for (auto const &[i, sig] : copies) {
+        auto const res = index.query(sig, 10, 0.5);
+        matches += res.size();
+        found += std::ranges::any_of(res, [i](auto const &m) {
+            return m.student_id == std::to_string(i);
+        });
+    }
+    s = duration<double>(steady_clock::now() - start);
+    std::println("LSH query:  {:10.1f} us, recall {:.3f}, {:.2f} matches",
+                 s.count() * 1e6 / queries,
+                 static_cast<double>(found) / queries,
+                 static_cast<double>(matches) / queries);
+
+    // What it replaces: comparing with every submission.
+    auto best = 0.0;
+    start = steady_clock::now();
+    for (auto q = 0UZ; q != scanned_queries; ++q) {
+        for (auto const &sig : signatures) {
+            best = std::max(best,
+                            hc::minhash::similarity(copies[q].second, sig));
+        }
+    }
+    s = duration<double>(steady_clock::now() - start);
+    std::println("Full scan:  {:10.1f} us (best {:.2f})",
+                 s.count() * 1e6 / scanned_queries, best);
+}
@@ -0,0 +1,133 @@
+#include <hc/similarity.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <print>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+using hc::plagiarism::Fingerprints;
+
+namespace {
+
+// Submissions of an assignment: each shares a common template with all, and
+// a fifth of them copy from another one.
+std::vector<Fingerprints> assignment(std::size_t students, std::size_t size)
+{
+    std::mt19937_64 rng{42};
+    Fingerprints common(size / 10);
+    std::ranges::generate(common, std::ref(rng));
+    std::vector<Fingerprints> sets;
+    for (auto i = 0UZ; i != students; ++i) {
+        auto s = common;
+        if (i % 5 == 4) {
+            auto const &copied = sets[rng() % sets.size()];
+            s.insert(s.end(), copied.begin(),
+                     copied.begin() + static_cast<std::ptrdiff_t>(size / 2));
+        }
+        while (s.size() < size) {
+            s.push_back(rng());
+        }
+        std::ranges::sort(s);
+        auto const [first, last] = std::ranges::unique(s);
+        s.erase(first, last);
+        sets.push_back(std::move(s));
+    }
+    return sets;
+}
+
+// What the kernel replaces: merging sorted fingerprints of every pair.
+std::vector<float> merge_matrix(std::vector<Fingerprints> const &sets)
+{
+    auto const n = sets.size();
+    std::vector<float> m(n * n, 1.0F);
+    for (auto i = 0UZ; i != n; ++i) {
+        for (auto j = i + 1; j != n; ++j) {
+            auto both = 0UZ;
+            auto a = sets[i].begin();
+            auto b = sets[j].begin();
+            while (a != sets[i].end() && b != sets[j].end()) {
+                if (*a < *b) {
+                    ++a;
+                }
+                else if (*b < *a) {
+                    ++b;
+                }
+                else {
+                    ++both;
+                    ++a;
+                    ++b;
+                }
+            }
+            m[(i * n) + j] = m[(j * n) + i] =
+                static_cast<float>(both) /
+                static_cast<float>(sets[i].size() + sets[j].size() - both);
+        }
+    }
+    return m;
+}
+
+template <typename F> double elapsed(F &&f)
+{
+    auto const start = steady_clock::now();
+    f();
+    return duration<double>(steady_clock::now() - start).count();
+}
+
+} // namespace
+
+// Usage: similarity-benchmark [students] [fingerprints per submission]
+int main(int argc, char **argv)
+{
+    auto students = 500UZ;
+    auto size = 2000UZ; // ~40 KiB of text each
+    if (argc > 1) {
+        std::from_chars(argv[1], argv[1] + std::strlen(argv[1]), students);
+    }
+    if (argc > 2) {
+        std::from_chars(argv[2], argv[2] + std::strlen(argv[2]), size);
+    }
+    auto const sets = assignment(students, size);
+
+    std::vector<float> exact;
+    auto s = elapsed([&] { exact = merge_matrix(sets); });
+    std::println("{} students, {} fingerprints each", students, size);
+    std::println("{:>20}: {:8.3f} s", "sorted merge", s);
+
+    std::optional<hc::similarity::Sketches> sketches;
+    s = elapsed([&] { sketches.emplace(sets); });
+    std::println("{:>20}: {:8.3f} s ({} bits each)", "sketching", s,
+                 sketches->words() * 64);
+
+    auto const hardware = std::max(1U, std::thread::hardware_concurrency());
+    for (auto const kernel :
+         {hc::similarity::Kernel::scalar, hc::similarity::Kernel::avx2,
+          hc::similarity::Kernel::avx512}) {
+        if (!hc::similarity::supported(kernel)) {
+            std::println("{:>20}: unsupported", to_string(kernel));
+            continue;
+        }
+        for (auto const threads : {1UZ, std::size_t{hardware}}) {
+            std::vector<float> m;
+            s = elapsed([&] {
+                m = hc::similarity::matrix(
+                    *sketches, {.kernel = kernel, .threads = threads});
+            });
+            auto error = 0.0F;
+            for (auto i = 0UZ; i != m.size(); ++i) {
+                error = std::max(error, std::abs(m[i] - exact[i]));
+            }
+            std::println("{:>12}, {:2} thr: {:8.3f} s (max error {:.3f})",
+                         to_string(kernel), threads, s, error);
+            if (hardware == 1) {
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#include <hc/task-queue.h>
+
+#include <atomic>
+#include <chrono>
+#include <httplib.h>
+#include <memory>
+#include <print>
+#include <thread>
+
+using namespace std::chrono;
+
+namespace {
+
+// Like what httplib does per connection, minus the socket: one thread
+// enqueues short tasks as fast as it can, and workers run them.
+double tasks_per_second(httplib::TaskQueue &q, std::size_t tasks)
+{
+    std::atomic_size_t done{};
+    auto const start = steady_clock::now();
+    for (auto i = 0UZ; i != tasks; ++i) {
+        while (!q.enqueue([&done] {
+            // A request handled from cache takes about this long.
+            auto const until = steady_clock::now() + 2us;
+            while (steady_clock::now() < until) {
+            }
+            done.fetch_add(1, std::memory_order_relaxed);
+        })) {
+            std::this_thread::yield();
+        }
+    }
+    q.shutdown();
+    return static_cast<double>(done) /
+           duration<double>(steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main()
+{
+    constexpr auto tasks = 200'000UZ;
+    constexpr auto max_queued = 1024UZ;
+    auto const max_threads =
+        std::max(std::thread::hardware_concurrency(), 1U);
+
+    std::println("{:>8} {:>16} {:>20}", "threads", "ThreadPool/s",
+                 "WorkStealingQueue/s");
+    for (auto threads = 1UZ; threads <= max_threads; threads *= 2) {
+        httplib::ThreadPool pool{threads};
+        auto const shared = tasks_per_second(pool, tasks);
+        hc::WorkStealingQueue stealing{threads, max_queued};
+        auto const per_worker = tasks_per_second(stealing, tasks);
+        std::println("{:>8} {:>16.0f} {:>20.0f}", threads, shared, per_worker);
+    }
+}
@@ -23,7 +23,13 @@ class HCReRecipe(ConanFile):
         "libpqxx/8.0.1",
         "libarchive/3.8.1",
     )
+
     generators = (
         "CMakeDeps",
         "CMakeToolchain",
     )
+
+    def requirements(self):
+        # Optional backend of file I/O. See HCRE_WITH_IO_URING.
+        if self.settings.os == "Linux":
+            self.requires("liburing/2.6")
@@ -0,0 +1,123 @@
+#pragma once
+#include <hc/optional.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace hc::aigc {
+
+/// @brief  Estimated rate of AI-generated content of a file, in [0, 1].
+struct Scored {
+    std::string content_hash;
+    double score;
+};
+
+struct ScorerOptions {
+    // Scoring service, e.g. "http://127.0.0.1:9000/score". It's POSTed
+    // {"texts": [...]} and responds {"scores": [...]} in the same order.
+    std::string endpoint;
+    std::size_t max_batch{16};
+    // How long a batch waits to fill up once it has a text.
+    std::chrono::milliseconds max_delay{200};
+    // Before a batch that failed is sent again.
+    std::chrono::milliseconds retry_delay{5000};
+    std::chrono::seconds timeout{60};
+    std::size_t max_text_size{std::size_t{64} << 10}; // Bytes sent per text
+    std::size_t max_queued{4096};
+};
+
+/// @brief  Splits an endpoint into scheme, host and port, e.g.
+/// "http://127.0.0.1:9000", and path, e.g. "/score". Returns nullopt unless
+/// it begins with "http://" or "https://".
+std::optional<std::pair<std::string, std::string>>
+split_endpoint(std::string_view endpoint);
+
+/// @brief  Scores files in background, sending their texts to a scoring
+/// service in batches, so that neither submits wait for the model nor the
+/// model is called once per file. Files are known by content hash, and one
+/// queued or being scored already isn't queued again.
+///
+/// Batches are sent again while the service is unreachable or fails with
+/// 5xx. Files without text, and batches it rejects, are left unscored.
+class Scorer {
+  public:
+    struct Job {
+        std::string content_hash;
+        std::filesystem::path path;
+        std::string filename;
+    };
+
+    /// @brief  Text of the file of a job, called from the scorer thread.
+    /// Throwing skips the job.
+    using TextOf = std::function<std::string(Job const &)>;
+    /// @brief  Called from the scorer thread with scores of a batch.
+    using OnScored = std::function<void(std::span<Scored const>)>;
+
+    /// @brief  Throws `std::invalid_argument` if the endpoint is malformed.
+    Scorer(ScorerOptions options, TextOf text_of, OnScored on_scored);
+
+    Scorer(Scorer const &) = delete;
+    Scorer(Scorer &&) = delete;
+    Scorer &operator=(Scorer const &) = delete;
+    Scorer &operator=(Scorer &&) = delete;
+
+    /// @brief  Stops the thread, dropping what's queued.
+    ~Scorer();
+
+    /// @brief  Queues `job` unless its file is queued already. Returns false
+    /// if the queue is full.
+    bool post(Job job);
+
+    /// @brief  Blocks until nothing is queued or being scored. Batches that
+    /// keep failing with 5xx block it forever.
+    void drain();
+
+  private:
+    enum class Outcome {
+        scored,
+        retry,    // Unreachable or failed, which may pass
+        rejected, // Responded 4xx or malformed, which would happen again
+    };
+
+    void run(std::stop_token const &stop);
+    // Sends `texts`, setting `scores` of them if scored.
+    Outcome request(std::vector<std::string> const &texts,
+                    std::vector<double> &scores);
+
+    ScorerOptions options_;
+    std::string base_; // Scheme, host and port of the endpoint
+    std::string path_;
+    TextOf text_of_;
+    OnScored on_scored_;
+
+    std::mutex mutex_;
+    std::condition_variable_any cv_;
+    std::condition_variable idle_;
+    std::deque<Job> queue_;
+    std::set<std::string, std::less<>> pending_; // Queued or being scored
+    std::jthread thread_; // Last, so joined first
+};
+
+// Per submission, as the read endpoint responds.
+struct SubmissionScore {
+    std::string student_id;
+    std::string content_hash;
+    std::optional<double> score; // Null until scored
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(SubmissionScore, student_id, content_hash,
+                                   score);
+};
+
+} // namespace hc::aigc
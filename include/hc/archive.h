@@ -1,12 +1,20 @@
 #pragma once
 #include <archive.h>
 #include <archive_entry.h>
+#include <hc/io.h>
+#include <sys/stat.h>
 
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
-#include <locale>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <set>
 #include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace hc::archive {
@@ -15,11 +23,60 @@ namespace fs = std::filesystem;
 
 using ModeType = __LA_MODE_T;
 
+/// @brief  Receives output of an archive. Returns false to abort writing.
+using Sink = std::function<bool(std::span<char const>)>;
+
+/// @brief  Tuning of the zstd filter. Defaults are the same as libarchive's.
+struct CompressionProfile {
+    int level{3};       // 1 to 19. Higher is smaller but slower.
+    unsigned threads{}; // zstd worker threads. 0 compresses in caller thread.
+    int long_window{};  // Window log of long distance matching. 0 disables it.
+
+    /// @brief  Lowest level with all cores, for exports needed right now.
+    static CompressionProfile fast();
+    /// @brief  High level and long distance matching with all cores, for
+    /// exports kept for long.
+    static CompressionProfile small();
+    /// @brief  "default", "fast" or "small".
+    static std::optional<CompressionProfile> from_name(std::string_view name);
+};
+
+/// @brief  Whether data beginning with `head` would hardly shrink if
+/// compressed, judging from magic numbers of compressed formats (ZIP and so
+/// DOCX, PDF, images, ...) and byte entropy of `head`.
+bool looks_incompressible(std::span<char const> head);
+
+/// @brief  What an `ArchiveWriter` has done with contents of regular files.
+struct ArchiveStats {
+    std::size_t entries{};
+    std::size_t stored_entries{}; // Written without compression
+    std::uint64_t bytes_stored{};
+    std::uint64_t bytes_compressed{};
+    std::chrono::nanoseconds store_time{};
+    std::chrono::nanoseconds compress_time{};
+
+    /// @brief  Estimated time saved by storing rather than compressing, at
+    /// the rate compressed bytes were written.
+    [[nodiscard]] std::chrono::nanoseconds saved_time() const;
+};
+
+/// @brief  A regular file at `disk_path`, stored in archive as `ar_path`.
+struct ManifestEntry {
+    fs::path disk_path;
+    std::u8string ar_path;
+};
+
 class ArchiveEntry {
   public:
     /// @brief  Copys staticstics from disk_path, as ar_path.
     ArchiveEntry(fs::path const &disk_path, std::u8string const &ar_path);
 
+    /// @brief  Copys statistics from `st` already fetched, as ar_path.
+    ArchiveEntry(struct stat const &st, std::u8string const &ar_path);
+
+    /// @brief  A directory entry not backed by disk.
+    static ArchiveEntry directory(std::u8string const &ar_path);
+
     ArchiveEntry(ArchiveEntry const &) = delete;
     ArchiveEntry(ArchiveEntry &&other) noexcept;
     ArchiveEntry &operator=(ArchiveEntry const &) = delete;
@@ -30,10 +87,17 @@ class ArchiveEntry {
     [[nodiscard]] std::size_t size() const;
     [[nodiscard]] std::string_view pathname() const;
 
+    /// @brief  Marks pathname and symlink target as UTF-8 for formats that
+    /// record it, e.g. ZIP. Otherwise they're raw bytes, which are written
+    /// verbatim.
+    void mark_utf8();
+
     [[nodiscard]] struct archive_entry *get();
     [[nodiscard]] struct archive_entry const *get() const;
 
   private:
+    ArchiveEntry();
+
     struct archive_entry *entry_;
 };
 
@@ -69,12 +133,27 @@ class OArchive {
         file_opened_ = true;
     }
 
-    void close()
+    /// @brief  Writes archive to `sink` instead of a file. Data is handed out
+    /// in blocks as soon as it's produced.
+    void open(Sink sink)
+    {
+        close();
+        sink_ = std::move(sink);
+        if (archive_write_open(archive_, this, nullptr, &OArchive::write_sink,
+                               nullptr) != ARCHIVE_OK) {
+            throw std::runtime_error{archive_error_string(archive_)};
+        }
+        file_opened_ = true;
+    }
+
+    /// @brief  Flushes remaining data. Returns false on failure.
+    bool close()
     {
         if (file_opened_) {
-            archive_write_close(archive_);
             file_opened_ = false;
+            return archive_write_close(archive_) == ARCHIVE_OK;
         }
+        return true;
     }
 
     void set_format(int format)
@@ -92,34 +171,84 @@ class OArchive {
         }
     }
 
+    /// @brief  Sets option of filters. Must be called after `add_filter()`
+    /// and before `open()`. Returns false if libarchive doesn't support it.
+    bool set_filter_option(char const *module, char const *option,
+                           char const *value)
+    {
+        auto const res =
+            archive_write_set_filter_option(archive_, module, option, value);
+        if (res == ARCHIVE_FATAL) {
+            throw std::runtime_error{archive_error_string(archive_)};
+        }
+        return res == ARCHIVE_OK;
+    }
+
+    /// @brief  Sets option of the format. Must be called after `set_format()`
+    /// and before `open()`. Returns false if libarchive doesn't support it.
+    bool set_format_option(char const *module, char const *option,
+                           char const *value)
+    {
+        auto const res =
+            archive_write_set_format_option(archive_, module, option, value);
+        if (res == ARCHIVE_FATAL) {
+            throw std::runtime_error{archive_error_string(archive_)};
+        }
+        return res == ARCHIVE_OK;
+    }
+
+    /// @brief  Applies `profile` to zstd filter.
+    void set_compression(CompressionProfile const &profile);
+
     struct archive *get()
     {
         return archive_;
     }
 
   private:
+    static la_ssize_t write_sink(struct archive * /*unused*/, void *self,
+                                 void const *buf, std::size_t len)
+    {
+        auto *oa = static_cast<OArchive *>(self);
+        if (!oa->sink_(std::span{static_cast<char const *>(buf), len})) {
+            return -1;
+        }
+        return static_cast<la_ssize_t>(len);
+    }
+
     struct archive *archive_;
     bool file_opened_{};
+    Sink sink_;
 };
 
 class ArchiveWriter {
   public:
     /// @param format   Sane options are ARCHIVE_FORMAT_XXXs.
     /// @param filters  Sane options are ARCHIVE_FILTER_XXXs.
+    /// @param profile  Used if ARCHIVE_FILTER_ZSTD is among `filters`.
     template <std::ranges::range Filters = std::vector<int>>
     explicit ArchiveWriter(fs::path const &out,
                            int format = ARCHIVE_FORMAT_TAR_PAX_RESTRICTED,
-                           Filters const &filters = {})
+                           Filters const &filters = {},
+                           CompressionProfile const &profile = {})
     {
         // Invocation order here is important. Don't change unless you know what
         // you're doing.
-        oa_.set_format(format);
-        for (auto const &filter : filters) {
-            oa_.add_filter(filter);
-        }
+        set_up(format, filters, profile);
         oa_.open(out);
     }
 
+    /// @brief  Writes archive to `sink` rather than a file. See `OArchive`.
+    template <std::ranges::range Filters = std::vector<int>>
+    explicit ArchiveWriter(Sink sink,
+                           int format = ARCHIVE_FORMAT_TAR_PAX_RESTRICTED,
+                           Filters const &filters = {},
+                           CompressionProfile const &profile = {})
+    {
+        set_up(format, filters, profile);
+        oa_.open(std::move(sink));
+    }
+
     ArchiveWriter(ArchiveWriter const &) = delete;
     ArchiveWriter(ArchiveWriter &&) = delete;
     ArchiveWriter &operator=(ArchiveWriter const &) = delete;
@@ -131,25 +260,153 @@ class ArchiveWriter {
     /// TODO: Currently lost all meta information.
     void add_path(fs::path const &disk_path, std::u8string const &ar_path);
 
-    /// @brief  Sets internal locale to use. Default value is C.
-    std::locale imbue(std::locale const &l);
+    /// @brief  Writes regular files listed in `entries` straight from disk
+    /// under their archive paths, with parent directories synthesized. Each
+    /// file costs one open and one stat, with no copy to a staging layout.
+    /// Throws if a file is missing, unless `skip_missing` is set.
+    ///
+    /// In ZIP format, files that look incompressible are stored as they are
+    /// and others are deflated. Other formats compress the whole stream by
+    /// their filters, so every file goes through them.
+    void add_entries(std::span<ManifestEntry const> entries,
+                     bool skip_missing = false);
+
+    /// @brief  Finishes the archive, flushing everything to output. Throws on
+    /// failure. Destructor does the same but ignores errors.
+    void close();
+
+    [[nodiscard]] ArchiveStats const &stats() const noexcept
+    {
+        return stats_;
+    }
 
   private:
+    template <std::ranges::range Filters>
+    void set_up(int format, Filters const &filters,
+                CompressionProfile const &profile)
+    {
+        oa_.set_format(format);
+        set_charset(format);
+        per_entry_compression_ = format == ARCHIVE_FORMAT_ZIP;
+        auto zstd = false;
+        for (auto const &filter : filters) {
+            oa_.add_filter(filter);
+            zstd = zstd || filter == ARCHIVE_FILTER_ZSTD;
+        }
+        if (zstd) {
+            oa_.set_compression(profile);
+        }
+    }
+
+    void set_charset(int format);
     void throw_on_error(int res);
+    void write_header(ArchiveEntry &entry);
     void write_file(fs::path const &disk_path, std::u8string const &ar_path);
     void write_directory_recursive(fs::path disk_path,
                                    std::u8string const &ar_path);
     void write_symlink(fs::path const &disk_path, std::u8string const &ar_path);
+    bool write_manifest_entry(ManifestEntry const &e);
+    std::uint64_t write_data(io::Reader &reader, std::span<char const> first);
+    void write_parent_directories(std::u8string const &ar_path);
 
     OArchive oa_;
-    std::locale locale_;
+    bool utf8_names_{}; // Whether format marks names as UTF-8
+    std::set<std::u8string> directories_; // Synthesized so far
+    bool per_entry_compression_{};
+    ArchiveStats stats_;
 };
 
 // Create .tar.zst archives using libarchive. Function throws on failure.
-void create_tar_zst(fs::path const &out_path, std::span<fs::path> const &paths);
+void create_tar_zst(fs::path const &out_path, std::span<fs::path> const &paths,
+                    CompressionProfile const &profile = {});
+
+// Create .tar.zst archive from a manifest. See `ArchiveWriter::add_entries`.
+ArchiveStats create_tar_zst(fs::path const &out_path,
+                            std::span<ManifestEntry const> entries,
+                            CompressionProfile const &profile = {});
+
+// Create .zip archive from a manifest, where already compressed files are
+// stored rather than deflated again.
+ArchiveStats create_zip(fs::path const &out_path,
+                        std::span<ManifestEntry const> entries);
+
+/// @brief  Turns an entry name into a relative path that stays inside the
+/// directory it's extracted to: "./", empty and "." components are dropped
+/// and backslashes are taken as separators. Returns nullopt if the name has
+/// ".." components or a drive letter, or nothing is left.
+std::optional<std::u8string> sanitize_path(std::string_view name);
+
+/// @brief  Bounds on what an `ArchiveReader` accepts, so that a small archive
+/// can't expand into filling the disk.
+struct ReadLimits {
+    std::uint64_t max_entry_size{std::uint64_t{1} << 30};
+    std::uint64_t max_total_size{std::uint64_t{8} << 30};
+    std::size_t max_entries{100'000};
+};
+
+enum class EntryType : std::uint8_t { regular, directory, symlink, other };
+
+/// @brief  Header of the entry an `ArchiveReader` is at.
+struct ReadEntry {
+    std::u8string path; // Sanitized, without trailing '/'
+    EntryType type;
+    std::optional<std::uint64_t> size; // Unknown until read for some ZIPs
+    std::optional<std::chrono::system_clock::time_point> mtime;
+};
+
+/// @brief  Reads tar (with any filter, e.g. zstd) or ZIP archives entry by
+/// entry, in one pass with constant memory. The file is read ahead
+/// asynchronously, and data of entries is handed out as the blocks libarchive
+/// decompresses into, without copying.
+///
+/// ZIPs are read as a stream, from local headers rather than the central
+/// directory. Names are sanitized with `sanitize_path()` and `limits` are
+/// checked as entries are read. Both throw `std::runtime_error`.
+class ArchiveReader {
+  public:
+    explicit ArchiveReader(fs::path const &in, ReadLimits const &limits = {});
+
+    ArchiveReader(ArchiveReader const &) = delete;
+    ArchiveReader(ArchiveReader &&) = delete;
+    ArchiveReader &operator=(ArchiveReader const &) = delete;
+    ArchiveReader &operator=(ArchiveReader &&) = delete;
+
+    ~ArchiveReader();
+
+    /// @brief  Advances to the next entry, skipping what's left of the
+    /// current one. Returns nullopt at the end.
+    std::optional<ReadEntry> next();
+
+    /// @brief  Returns the next block of the current entry's data, or an
+    /// empty span at its end. The block is valid until the next call.
+    std::span<char const> read();
+
+  private:
+    static la_ssize_t read_source(struct archive * /*unused*/, void *self,
+                                  void const **buf);
+    std::span<char const> account(std::span<char const> block);
+
+    ReadLimits limits_;
+    io::UniqueFd fd_;
+    std::unique_ptr<io::Engine> engine_; // Own one, as callers write with theirs
+    std::unique_ptr<io::Reader> source_;
+    struct archive *archive_{};
+
+    std::size_t entries_{};
+    std::uint64_t total_bytes_{};
+    std::uint64_t entry_bytes_{};  // Of current entry, holes included
+    std::span<char const> block_;  // Read from libarchive, not handed out yet
+    std::uint64_t block_offset_{}; // Where `block_` goes in the entry
+    bool data_eof_{};
+};
 
-// This may be not needed since we only output tar.zst but not input them.
-// bool extract_tar_zst(fs::path const &archive_path, fs::path const &dest_dir,
-//                      std::string &err);
+/// @brief  Extracts regular files and directories of the archive at
+/// `archive_path` under `dest_dir`, which is created if missing. Symlinks and
+/// other entries are skipped. Besides .tar.zst, any format `ArchiveReader`
+/// reads is accepted. Returns the number of files extracted; throws on
+/// failure, leaving what's extracted so far.
+std::size_t extract_tar_zst(fs::path const &archive_path,
+                            fs::path const &dest_dir,
+                            ReadLimits const &limits = {});
 
 } // namespace hc::archive
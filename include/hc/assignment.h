@@ -15,6 +15,9 @@ struct Assignment {
     // StudentID -> Submission
     std::unordered_map<std::string, Submission> submissions;
 
+    // Bumped whenever `submissions` changes. In-memory only, not serialized.
+    std::uint64_t revision{};
+
     NLOHMANN_DEFINE_TYPE_INTRUSIVE(Assignment, name, start_time, end_time,
                                    submissions);
 };
@@ -0,0 +1,92 @@
+#pragma once
+#include <hc/io.h>
+#include <hc/sha256.h>
+
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace hc {
+
+/// @brief  Stores files by SHA-256 of their content, so that identical
+/// files are stored once, e.g. resubmissions or a template a whole class
+/// submits. Blobs are counted by references of their users and removed when
+/// the last one is released.
+///
+/// References live in memory only. Users rebuild them on start with
+/// `retain()` from what they persist, then `collect_garbage()`.
+class BlobStore {
+  public:
+    explicit BlobStore(std::filesystem::path root);
+
+    BlobStore(BlobStore const &) = delete;
+    BlobStore(BlobStore &&) = delete;
+    BlobStore &operator=(BlobStore const &) = delete;
+    BlobStore &operator=(BlobStore &&) = delete;
+
+    ~BlobStore() = default;
+
+    /// @brief  Writes a blob through the I/O engine of calling thread,
+    /// hashing it on the way. Data goes to a temporary file, which is removed
+    /// unless committed.
+    class Writer {
+      public:
+        explicit Writer(BlobStore &store);
+
+        Writer(Writer const &) = delete;
+        Writer(Writer &&) = delete;
+        Writer &operator=(Writer const &) = delete;
+        Writer &operator=(Writer &&) = delete;
+
+        ~Writer();
+
+        /// @brief  Throws `std::system_error` on failure.
+        void write(std::span<char const> data);
+
+        /// @brief  Finishes writing and adds a reference to the blob, which
+        /// is stored unless an identical one is. Returns its hash.
+        std::string commit();
+
+      private:
+        BlobStore &store_;
+        std::filesystem::path tmp_;
+        io::UniqueFd fd_;
+        io::Writer writer_;
+        Sha256 sha_;
+        bool committed_{};
+    };
+
+    /// @brief  Stores `data` as with a `Writer`.
+    std::string put(std::span<char const> data);
+
+    /// @brief  Where blob of `hash` is, e.g. `root/ab/abcdef...`.
+    [[nodiscard]] std::filesystem::path path(std::string_view hash) const;
+
+    /// @brief  Adds a reference to an existing blob.
+    void retain(std::string const &hash);
+
+    /// @brief  Drops a reference, removing the blob if it's the last one.
+    void release(std::string const &hash);
+
+    [[nodiscard]] std::size_t references(std::string const &hash) const;
+
+    /// @brief  Removes blobs without references last written before
+    /// `min_age` ago, e.g. left by a crash before their users persisted them.
+    /// Younger ones may be being committed by another process. Returns the
+    /// number removed.
+    std::size_t collect_garbage(std::chrono::seconds min_age);
+
+  private:
+    std::string adopt(std::filesystem::path const &tmp,
+                      std::string const &hash);
+
+    std::filesystem::path root_;
+    mutable std::mutex mutex_; // Also orders renames against removals
+    std::unordered_map<std::string, std::size_t> references_;
+};
+
+} // namespace hc
@@ -1,4 +1,9 @@
 #pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <thread>
 #include <hc/xdg-basedir.h>
 
 namespace config {
@@ -21,4 +26,121 @@ inline bool &verbose()
     return verbose;
 }
 
+// Upper bound of a single submitted file, in bytes.
+inline std::size_t &max_submission_size()
+{
+    static auto max_submission_size = std::size_t{100} << 20;
+    return max_submission_size;
+}
+
+// Upper bound of an uploaded archive of submissions to ingest, in bytes.
+inline std::size_t &max_ingest_size()
+{
+    static auto max_ingest_size = std::size_t{4} << 30;
+    return max_ingest_size;
+}
+
+// Maximum number of simultaneous database connections.
+inline std::size_t &db_pool_size()
+{
+    static auto db_pool_size = std::size_t{8};
+    return db_pool_size;
+}
+
+// How long a request waits for a free database connection before failing.
+inline std::chrono::milliseconds &db_acquire_timeout()
+{
+    static auto db_acquire_timeout = std::chrono::milliseconds{5000};
+    return db_acquire_timeout;
+}
+
+// How long a database connection may sit idle before it's probed with a
+// round trip on checkout, as the server may have closed it meanwhile.
+inline std::chrono::milliseconds &db_probe_after()
+{
+    static auto db_probe_after = std::chrono::milliseconds{30'000};
+    return db_probe_after;
+}
+
+// Whether mutating requests are acknowledged after their changes are
+// committed to database, or right after they're queued for writing.
+inline bool &ack_after_commit()
+{
+    static auto ack_after_commit = true;
+    return ack_after_commit;
+}
+
+// Threads extracting text of submitted files in background.
+inline std::size_t &extract_threads()
+{
+    static auto extract_threads = std::size_t{2};
+    return extract_threads;
+}
+
+// Scoring service of AIGC rates, e.g. "http://127.0.0.1:9000/score". Empty
+// disables scoring. See `hc::aigc::ScorerOptions`.
+inline std::string &aigc_endpoint()
+{
+    static auto aigc_endpoint = std::string{};
+    return aigc_endpoint;
+}
+
+// Texts sent to the scoring service per request.
+inline std::size_t &aigc_batch_size()
+{
+    static auto aigc_batch_size = std::size_t{16};
+    return aigc_batch_size;
+}
+
+// HTTP worker threads. Same default as httplib's.
+inline std::size_t &http_threads()
+{
+    static auto http_threads = std::size_t{
+        std::max(8U, std::max(1U, std::thread::hardware_concurrency()) - 1)};
+    return http_threads;
+}
+
+// Connections waiting for an HTTP worker, beyond which they're closed.
+inline std::size_t &http_max_queued()
+{
+    static auto http_max_queued = std::size_t{1024};
+    return http_max_queued;
+}
+
+// Login sessions end this long after login, however active they are.
+inline std::chrono::minutes &session_ttl()
+{
+    static auto session_ttl = std::chrono::minutes{std::chrono::hours{12}};
+    return session_ttl;
+}
+
+// Login sessions end this long after their last request.
+inline std::chrono::minutes &session_idle_ttl()
+{
+    static auto session_idle_ttl = std::chrono::minutes{std::chrono::hours{2}};
+    return session_idle_ttl;
+}
+
+// Threads running background jobs, e.g. exports. See `hc::jobs::Scheduler`.
+inline std::size_t &job_workers()
+{
+    static auto job_workers = std::size_t{2};
+    return job_workers;
+}
+
+// Threads building exported archives, shared by export jobs waiting for
+// them. See `hc::ExportCache`.
+inline std::size_t &export_builders()
+{
+    static auto export_builders = std::size_t{2};
+    return export_builders;
+}
+
+// Jobs waiting for a worker, beyond which new ones are refused.
+inline std::size_t &max_queued_jobs()
+{
+    static auto max_queued_jobs = std::size_t{256};
+    return max_queued_jobs;
+}
+
 } // namespace config
@@ -0,0 +1,147 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <sqlpp23/postgresql/postgresql.h>
+#include <utility>
+#include <vector>
+
+namespace hc::db {
+
+struct PoolStats {
+    std::size_t capacity;
+    std::size_t open;    // Connections currently established
+    std::size_t idle;    // Connections waiting in the pool
+    std::uint64_t checkouts;
+    std::uint64_t waits;    // Checkouts that blocked because pool is exhausted
+    std::uint64_t timeouts; // Checkouts that gave up
+    std::uint64_t dropped;  // Broken connections discarded
+    std::uint64_t probes;   // Round trips checking idle connections
+    std::uint64_t total_wait_us;     // Time blocked on an exhausted pool
+    std::uint64_t max_wait_us;
+    std::uint64_t total_checkout_us; // Time spent in acquire(), in total
+
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(PoolStats, capacity, open, idle, checkouts,
+                                   waits, timeouts, dropped, probes,
+                                   total_wait_us, max_wait_us,
+                                   total_checkout_us);
+};
+
+/// @brief  A bounded pool of PostgreSQL connections. Connections are created
+/// lazily up to `capacity`, checked on checkout and dropped if found broken,
+/// in which case a new one is established on demand. The client only learns
+/// that the server closed a connection when it next talks to it, so one
+/// idle for `probe_after` is probed with `SELECT 1` before it's handed out.
+class ConnectionPool {
+  public:
+    using Connection = sqlpp::postgresql::connection;
+    using Config = sqlpp::postgresql::connection_config;
+
+    /// @brief  RAII checkout. The connection goes back to the pool on
+    /// destruction, unless it's broken.
+    class Handle {
+      public:
+        Handle(Handle const &) = delete;
+        Handle(Handle &&other) noexcept
+            : pool_{std::exchange(other.pool_, nullptr)},
+              conn_{std::move(other.conn_)}, uncaught_{other.uncaught_}
+        {
+        }
+        Handle &operator=(Handle const &) = delete;
+        Handle &operator=(Handle &&) = delete;
+
+        ~Handle()
+        {
+            if (pool_ != nullptr) {
+                pool_->release(std::move(conn_),
+                               std::uncaught_exceptions() > uncaught_);
+            }
+        }
+
+        Connection &operator*()
+        {
+            return *conn_;
+        }
+
+        Connection *operator->()
+        {
+            return conn_.get();
+        }
+
+        /// @brief  Executes `statement` on the underlying connection.
+        template <typename Statement> decltype(auto) operator()(Statement &&s)
+        {
+            return (*conn_)(std::forward<Statement>(s));
+        }
+
+      private:
+        friend class ConnectionPool;
+        Handle(ConnectionPool *pool, std::unique_ptr<Connection> conn)
+            : pool_{pool}, conn_{std::move(conn)},
+              uncaught_{std::uncaught_exceptions()}
+        {
+        }
+
+        ConnectionPool *pool_;
+        std::unique_ptr<Connection> conn_;
+        int uncaught_;
+    };
+
+    /// @brief  Establishes the first connection eagerly, so that a bad config
+    /// fails here instead of on the first request.
+    ConnectionPool(Config config, std::size_t capacity,
+                   std::chrono::milliseconds acquire_timeout,
+                   std::chrono::milliseconds probe_after);
+
+    ConnectionPool(ConnectionPool const &) = delete;
+    ConnectionPool(ConnectionPool &&) = delete;
+    ConnectionPool &operator=(ConnectionPool const &) = delete;
+    ConnectionPool &operator=(ConnectionPool &&) = delete;
+
+    /// @brief  All handles must have been returned before destruction.
+    ~ConnectionPool() = default;
+
+    /// @brief  Blocks until a connection is available. Throws if no
+    /// connection can be obtained within the acquire timeout.
+    [[nodiscard]] Handle acquire();
+
+    [[nodiscard]] PoolStats stats() const;
+
+  private:
+    struct Idle {
+        std::unique_ptr<Connection> conn;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    void release(std::unique_ptr<Connection> conn, bool failed) noexcept;
+    std::unique_ptr<Connection> connect();
+    // Whether `idle` still works. Requires `mutex_` being held, and releases
+    // it during the round trip if it's probed.
+    bool healthy(Idle const &idle, std::unique_lock<std::mutex> &guard);
+
+    Config config_;
+    std::size_t capacity_;
+    std::chrono::milliseconds acquire_timeout_;
+    std::chrono::milliseconds probe_after_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<Idle> idle_; // Most recently used last
+    std::size_t open_{}; // Idle and checked out
+
+    std::atomic_uint64_t checkouts_;
+    std::atomic_uint64_t waits_;
+    std::atomic_uint64_t timeouts_;
+    std::atomic_uint64_t dropped_;
+    std::atomic_uint64_t probes_;
+    std::atomic_uint64_t total_wait_us_;
+    std::atomic_uint64_t max_wait_us_;
+    std::atomic_uint64_t total_checkout_us_;
+};
+
+} // namespace hc::db
@@ -0,0 +1,106 @@
+#pragma once
+#include <hc/jobs.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace hc {
+
+/// @brief  Caches exported archives by (key, revision of its submissions),
+/// where key identifies the assignment and how it's exported. Concurrent
+/// requests of the same key share one build (single-flight), and later
+/// requests reuse its result until a newer revision is requested.
+///
+/// Builds run on a fixed number of build threads, queued beyond them, under
+/// a context no caller owns. Callers wait for a build each with their own
+/// cancellation check, and it's cancelled once every one of them has stopped
+/// waiting.
+class ExportCache {
+  public:
+    using Path = std::filesystem::path;
+    /// @brief  Builds the blob, calling `Context::progress()` between steps.
+    using Build = std::function<Path(hc::jobs::Context &)>;
+    /// @brief  Called with progress of the build while waiting for it.
+    /// Throwing stops waiting, e.g. `Context::progress()` of a cancelled job.
+    using Waiting = std::function<void(double)>;
+
+    /// @param builders  Threads building blobs, at least one.
+    /// @param on_evict  Called with blobs replaced by a newer revision. They
+    /// may still be downloading, so they shouldn't be removed immediately.
+    ExportCache(std::size_t builders, std::function<void(Path)> on_evict);
+
+    ExportCache(ExportCache const &) = delete;
+    ExportCache(ExportCache &&) = delete;
+    ExportCache &operator=(ExportCache const &) = delete;
+    ExportCache &operator=(ExportCache &&) = delete;
+
+    /// @brief  Cancels builds, waits for them to stop and joins build
+    /// threads.
+    ~ExportCache();
+
+    /// @brief  Returns the blob of `key` at `revision`, starting `build`
+    /// only if there is neither a cached nor an in-flight one, and waits for
+    /// it. If the build throws, every waiter gets the exception and the next
+    /// call builds again.
+    Path get_or_build(std::string const &key, std::uint64_t revision,
+                      Build const &build, Waiting const &waiting);
+
+    /// @brief  Cancels builds going on, and blocks until they stop.
+    void cancel_all();
+
+    /// @brief  Forgets all entries, without evicting them, e.g. after the
+    /// blobs are removed from disk.
+    void clear();
+
+  private:
+    struct Flight {
+        std::uint64_t revision;
+        std::shared_future<Path> blob;
+        std::stop_source stop; // Requested once nobody waits for it
+        std::atomic<double> progress;
+        std::size_t waiters{}; // Guarded by `mutex_`
+        // Replaced by a newer revision before it finished, so that it evicts
+        // its own blob. Guarded by `mutex_`.
+        bool superseded{};
+    };
+
+    // A build waiting for a build thread.
+    struct Pending {
+        std::string key;
+        std::shared_ptr<Flight> flight;
+        Build build;
+        std::promise<Path> promise;
+    };
+
+    // Waits for `flight`, as one of its waiters.
+    Path wait(Flight &flight, Waiting const &waiting);
+    // Loop of a build thread.
+    void run(std::stop_token const &stop);
+    void build(Pending &pending);
+    // Hands the blob of finished `flight` to `on_evict_`, if it has one.
+    void evict(Flight const &flight);
+
+    std::function<void(Path)> on_evict_;
+    std::mutex mutex_;
+    std::condition_variable idle_;
+    std::condition_variable_any work_;
+    std::map<std::string, std::shared_ptr<Flight>> slots_; // Latest revisions
+    std::set<Flight *> building_; // Queued or running, replaced or not
+    std::deque<Pending> queue_;
+    std::vector<std::jthread> builders_; // Last, so joined first
+};
+
+} // namespace hc
@@ -0,0 +1,193 @@
+#pragma once
+#include <hc/archive.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace hc::extract {
+
+namespace fs = std::filesystem;
+
+/// @brief  Thrown when no extractor accepts a file, e.g. a PDF or an image.
+class UnsupportedFormat : public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+/// @brief  Plain text for analyses: valid UTF-8 (invalid bytes become
+/// U+FFFD) without BOM or control characters, LF line ends, runs of blanks
+/// squeezed into a space, at most one empty line in a row, trimmed.
+std::string normalize(std::string_view text);
+
+/// @brief  Cuts `s` to at most `size` bytes, at a boundary of UTF-8 code
+/// points.
+void truncate_utf8(std::string &s, std::size_t size);
+
+class Pipeline;
+
+/// @brief  Turns files of a format into text. Implementations must be
+/// stateless, as a pipeline runs them from several threads at once.
+class Extractor {
+  public:
+    Extractor() = default;
+    Extractor(Extractor const &) = delete;
+    Extractor(Extractor &&) = delete;
+    Extractor &operator=(Extractor const &) = delete;
+    Extractor &operator=(Extractor &&) = delete;
+    virtual ~Extractor() = default;
+
+    [[nodiscard]] virtual std::string_view name() const = 0;
+
+    /// @brief  Whether the file is of this format, judging from the lower
+    /// case `extension` of its original name, e.g. ".docx", and its first
+    /// bytes `head`.
+    [[nodiscard]] virtual bool accepts(std::string_view extension,
+                                       std::span<char const> head) const = 0;
+
+    /// @brief  Appends text of the file at `path` to `out`, unnormalized.
+    /// Containers hand their entries back to `pipeline`, one level deeper.
+    virtual void extract(fs::path const &path, Pipeline const &pipeline,
+                         std::size_t depth, std::string &out) const = 0;
+};
+
+/// @brief  Bounds on an extraction, so that a crafted file can't take the
+/// disk or memory.
+struct Limits {
+    std::size_t max_text_size{std::size_t{16} << 20}; // Of output, in bytes
+    std::size_t max_depth{2};                         // Of nested containers
+    hc::archive::ReadLimits archive{
+        .max_entry_size = std::uint64_t{256} << 20,
+        .max_total_size = std::uint64_t{1} << 30,
+        .max_entries = 10'000,
+    };
+};
+
+/// @brief  Extractors tried in the order they're added; the first accepting
+/// a file extracts it.
+class Pipeline {
+  public:
+    /// @param tmp_dir  Where containers are unpacked while extracted.
+    explicit Pipeline(fs::path tmp_dir, Limits const &limits = {});
+
+    /// @brief  DOCX, ZIP/tar containers and plain text, in that order.
+    static Pipeline with_defaults(fs::path tmp_dir, Limits const &limits = {});
+
+    void add(std::unique_ptr<Extractor> extractor);
+
+    /// @brief  Normalized text of the file at `path`, originally named
+    /// `filename`. Throws `UnsupportedFormat` if no extractor accepts it,
+    /// `std::runtime_error` if it's malformed or beyond limits.
+    [[nodiscard]] std::string extract(fs::path const &path,
+                                      std::string_view filename) const;
+
+    /// @brief  Appends raw text of the file at `path` to `out`, for
+    /// containers.
+    void extract_into(fs::path const &path, std::string_view filename,
+                      std::size_t depth, std::string &out) const;
+
+    [[nodiscard]] fs::path const &tmp_dir() const noexcept;
+    [[nodiscard]] Limits const &limits() const noexcept;
+
+  private:
+    fs::path tmp_dir_;
+    Limits limits_;
+    std::vector<std::unique_ptr<Extractor>> extractors_;
+};
+
+/// @brief  Extracted text of files by SHA-256 of their content, as
+/// `root/ab/abcdef....txt`, so that no file is extracted twice. Files
+/// without text are cached as empty text as well.
+class TextCache {
+  public:
+    explicit TextCache(fs::path root);
+
+    [[nodiscard]] std::optional<std::string> get(std::string_view hash) const;
+
+    /// @brief  Written to a temporary file then renamed, so that readers
+    /// never see a partial text.
+    void put(std::string_view hash, std::string_view text) const;
+
+    [[nodiscard]] fs::path path(std::string_view hash) const;
+
+  private:
+    fs::path root_;
+};
+
+/// @brief  Extracts text of submitted files in background, with a bounded
+/// number of threads and queue, into a `TextCache`.
+class Service {
+  public:
+    /// @brief  Called from an extraction thread with text of a file.
+    using OnText = std::function<void(std::string const &text)>;
+
+    Service(Pipeline pipeline, TextCache cache, std::size_t threads,
+            std::size_t max_queued = 1024);
+
+    Service(Service const &) = delete;
+    Service(Service &&) = delete;
+    Service &operator=(Service const &) = delete;
+    Service &operator=(Service &&) = delete;
+
+    /// @brief  Stops the threads, dropping what's queued, which is extracted
+    /// on demand later.
+    ~Service();
+
+    /// @brief  Queues extraction of the file of `hash` at `path` unless its
+    /// text is cached or queued already. Returns false if the queue is full.
+    /// `on_text`, if any, is called with its text once it's ready, or never
+    /// if extraction fails.
+    bool post(std::string hash, fs::path path, std::string filename,
+              OnText on_text = {});
+
+    /// @brief  Text of the file of `hash` if it's extracted already.
+    [[nodiscard]] std::optional<std::string>
+    cached(std::string_view hash) const;
+
+    /// @brief  Text of the file of `hash` at `path`, extracted now if not
+    /// cached. Throws as `Pipeline::extract()`, except that unsupported
+    /// formats are empty text.
+    std::string text(std::string const &hash, fs::path const &path,
+                     std::string_view filename);
+
+    /// @brief  Blocks until nothing is queued or being extracted.
+    void drain();
+
+  private:
+    struct Job {
+        std::string hash;
+        fs::path path;
+        std::string filename;
+        std::vector<OnText> on_text;
+    };
+
+    void run(std::stop_token const &stop);
+    std::string extract_and_cache(Job const &job);
+
+    Pipeline pipeline_;
+    TextCache cache_;
+    std::size_t max_queued_;
+
+    std::mutex mutex_;
+    std::condition_variable_any cv_;
+    std::condition_variable idle_;
+    std::deque<Job> queue_;
+    // Queued or being extracted. A file being extracted may be queued again
+    // for those waiting for its text.
+    std::multiset<std::string, std::less<>> pending_;
+    std::vector<std::jthread> threads_; // Last, so joined first
+};
+
+} // namespace hc::extract
@@ -0,0 +1,199 @@
+#pragma once
+#include <sys/types.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace hc::io {
+
+/// @brief  Owns a file descriptor, closing it on destruction.
+class UniqueFd {
+  public:
+    /// @brief  Opens `path` with `flags` of open(2). Throws
+    /// `std::system_error` on failure.
+    UniqueFd(std::filesystem::path const &path, int flags, mode_t mode = 0644);
+
+    UniqueFd(UniqueFd const &) = delete;
+    UniqueFd(UniqueFd &&other) noexcept : fd_{std::exchange(other.fd_, -1)} {}
+    UniqueFd &operator=(UniqueFd const &) = delete;
+    UniqueFd &operator=(UniqueFd &&) = delete;
+
+    ~UniqueFd();
+
+    [[nodiscard]] int get() const noexcept
+    {
+        return fd_;
+    }
+
+  private:
+    int fd_;
+};
+
+/// @brief  A finished read or write. `result` is the number of bytes
+/// transferred, or -errno.
+struct Completion {
+    std::uint64_t tag;
+    std::int64_t result;
+};
+
+/// @brief  Asynchronous positional reads and writes into a fixed set of
+/// buffers owned by the engine. Requests are prepared, then submitted in one
+/// batch, and complete in any order.
+///
+/// Backed by io_uring with the buffers registered to kernel if built with
+/// liburing and the kernel allows it, or by a pool of threads doing
+/// pread(2)/pwrite(2) otherwise. An engine is used by one thread at a time.
+class Engine {
+  public:
+    static constexpr auto default_depth = 4UZ;
+    static constexpr auto default_block_size = std::size_t{256} << 10;
+
+    /// @brief  Creates the best engine available, with `depth` buffers of
+    /// `block_size` bytes.
+    static std::unique_ptr<Engine> make(std::size_t depth = default_depth,
+                                        std::size_t block_size =
+                                            default_block_size);
+
+    /// @brief  Engine of the calling thread with default sizes, created on
+    /// first use. Readers and writers on it mustn't overlap.
+    static Engine &local();
+
+    Engine(Engine const &) = delete;
+    Engine(Engine &&) = delete;
+    Engine &operator=(Engine const &) = delete;
+    Engine &operator=(Engine &&) = delete;
+
+    virtual ~Engine() = default;
+
+    [[nodiscard]] virtual std::string_view backend() const noexcept = 0;
+
+    [[nodiscard]] std::size_t depth() const noexcept
+    {
+        return buffers_.size();
+    }
+
+    [[nodiscard]] std::size_t block_size() const noexcept
+    {
+        return block_size_;
+    }
+
+    [[nodiscard]] std::span<char> buffer(std::size_t index) const noexcept
+    {
+        return buffers_[index];
+    }
+
+    /// @brief  Prepares reading `len` bytes at `offset` of `fd` into buffer
+    /// `index`. Nothing is done until `submit()`.
+    virtual void prepare_read(int fd, std::size_t index, std::size_t len,
+                              std::uint64_t offset, std::uint64_t tag) = 0;
+
+    /// @brief  Prepares writing first `len` bytes of buffer `index` at
+    /// `offset` of `fd`.
+    virtual void prepare_write(int fd, std::size_t index, std::size_t len,
+                               std::uint64_t offset, std::uint64_t tag) = 0;
+
+    /// @brief  Starts everything prepared, with one system call if possible.
+    virtual void submit() = 0;
+
+    /// @brief  Blocks until a submitted request completes.
+    virtual Completion wait() = 0;
+
+  protected:
+    Engine(std::size_t depth, std::size_t block_size);
+
+  private:
+    std::size_t block_size_;
+    std::unique_ptr<char[]> memory_;
+    std::vector<std::span<char>> buffers_;
+};
+
+/// @brief  Reads a file from beginning to end, keeping all buffers of the
+/// engine in flight ahead of the caller (readahead).
+class Reader {
+  public:
+    /// @param size  Bytes to read, usually from fstat(2). Reading stops
+    /// early if the file is shorter.
+    Reader(Engine &engine, int fd, std::uint64_t size);
+
+    Reader(Reader const &) = delete;
+    Reader(Reader &&) = delete;
+    Reader &operator=(Reader const &) = delete;
+    Reader &operator=(Reader &&) = delete;
+
+    /// @brief  Waits for requests still in flight, as they target buffers
+    /// of the engine.
+    ~Reader();
+
+    /// @brief  Returns the next block of the file, or an empty span at the
+    /// end. The block is valid until the next call. Throws
+    /// `std::system_error` on failure.
+    std::span<char const> next();
+
+  private:
+    void request(std::uint64_t block);
+    void drain() noexcept;
+
+    Engine &engine_;
+    int fd_;
+    std::uint64_t size_;
+    std::uint64_t requested_{}; // Blocks requested so far
+    std::uint64_t current_{};   // Block returned by next call of `next()`
+    std::vector<std::int64_t> results_; // By buffer, -1 if pending
+    std::size_t in_flight_{};
+    bool eof_{};
+};
+
+/// @brief  Appends to a file through the engine's buffers. A buffer is
+/// written once filled, while the caller goes on filling the next one.
+class Writer {
+  public:
+    Writer(Engine &engine, int fd);
+
+    Writer(Writer const &) = delete;
+    Writer(Writer &&) = delete;
+    Writer &operator=(Writer const &) = delete;
+    Writer &operator=(Writer &&) = delete;
+
+    /// @brief  Waits for requests still in flight, ignoring errors. Call
+    /// `finish()` to know whether everything is written.
+    ~Writer();
+
+    /// @brief  Throws `std::system_error` if a previous write failed.
+    void write(std::span<char const> data);
+
+    /// @brief  Writes what's buffered and waits for everything. Throws
+    /// `std::system_error` on failure.
+    void finish();
+
+    [[nodiscard]] std::uint64_t size() const noexcept
+    {
+        return offset_ + filled_;
+    }
+
+  private:
+    void flush_current();
+    void reap();
+    void drain() noexcept;
+
+    struct Pending {
+        std::uint64_t offset;
+        std::size_t len;
+    };
+
+    Engine &engine_;
+    int fd_;
+    std::vector<std::size_t> free_;     // Buffers not in flight
+    std::vector<Pending> pending_;      // By buffer
+    std::size_t current_{};             // Buffer being filled
+    std::size_t filled_{};              // Bytes in current buffer
+    std::uint64_t offset_{};            // File offset of current buffer
+    std::size_t in_flight_{};
+    int error_{};                       // First errno seen
+};
+
+} // namespace hc::io
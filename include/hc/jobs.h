@@ -0,0 +1,154 @@
+#pragma once
+#include <hc/optional.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace hc::jobs {
+
+enum class Priority : std::uint8_t { low, normal, high };
+
+enum class State : std::uint8_t { queued, running, succeeded, failed, cancelled };
+
+NLOHMANN_JSON_SERIALIZE_ENUM(State, {
+                                        {State::queued, "queued"},
+                                        {State::running, "running"},
+                                        {State::succeeded, "succeeded"},
+                                        {State::failed, "failed"},
+                                        {State::cancelled, "cancelled"},
+                                    });
+
+/// @brief  Thrown out of a job by `Context::progress()` once it's cancelled.
+class Cancelled : public std::runtime_error {
+  public:
+    Cancelled() : std::runtime_error{"Cancelled"} {}
+};
+
+/// @brief  Handed to a running job, to report how far it is and to notice
+/// cancellation.
+class Context {
+  public:
+    Context(std::stop_token stop, std::atomic<double> &progress);
+
+    /// @brief  Records `fraction` done, in [0, 1]. Throws `Cancelled` if the
+    /// job is cancelled, so jobs should call it between steps.
+    void progress(double fraction);
+
+    [[nodiscard]] bool cancelled() const noexcept;
+
+  private:
+    std::stop_token stop_;
+    std::atomic<double> *progress_;
+};
+
+/// @brief  Snapshot of a job, as `GET /api/jobs/{id}` responds.
+struct Status {
+    std::string id;
+    std::string kind;  // e.g. "export"
+    std::string owner; // Who submitted it, empty for internal jobs
+    State state;
+    double progress; // In [0, 1]
+    std::optional<std::string> result; // What the job returned, once succeeded
+    std::optional<std::string> error;  // Once failed
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(Status, id, kind, owner, state, progress,
+                                   result, error);
+};
+
+struct SchedulerOptions {
+    std::size_t workers{2};
+    std::size_t max_queued{256};
+    // How long finished jobs are kept for their status to be queried.
+    std::chrono::seconds retention{3600};
+};
+
+/// @brief  Runs jobs on a fixed number of worker threads, higher priority
+/// first and then in order of submission, so that long tasks, e.g. exports,
+/// neither occupy HTTP worker threads nor outnumber the cores.
+class Scheduler {
+  public:
+    /// @brief  Returns the result of the job, e.g. URI of what it produced.
+    /// Throwing fails the job.
+    using Body = std::function<std::string(Context &)>;
+
+    explicit Scheduler(SchedulerOptions options);
+
+    Scheduler(Scheduler const &) = delete;
+    Scheduler(Scheduler &&) = delete;
+    Scheduler &operator=(Scheduler const &) = delete;
+    Scheduler &operator=(Scheduler &&) = delete;
+
+    /// @brief  Cancels all jobs and joins workers.
+    ~Scheduler();
+
+    /// @brief  Queues a job and returns its id, or nullopt if the queue is
+    /// full. `owner` is only reported in its `Status`.
+    std::optional<std::string> submit(std::string kind, Priority priority,
+                                      Body body, std::string owner = {});
+
+    /// @brief  Returns nullopt if `id` is unknown or expired.
+    std::optional<Status> status(std::string_view id);
+
+    /// @brief  Cancels a queued job at once, and asks a running one to stop
+    /// at its next `Context::progress()`. Returns false if `id` is unknown or
+    /// finished already.
+    bool cancel(std::string_view id);
+
+    /// @brief  Cancels every job and blocks until running ones return.
+    void cancel_all();
+
+    /// @brief  Blocks until nothing is queued or running.
+    void drain();
+
+  private:
+    // Higher priority first, then in order of submission.
+    using QueueKey = std::pair<int, std::uint64_t>;
+
+    struct Job {
+        std::string id;
+        std::string kind;
+        std::string owner;
+        QueueKey key;
+        Body body; // Released once finished
+        std::stop_source stop;
+        State state{State::queued};
+        std::atomic<double> progress;
+        std::optional<std::string> result;
+        std::optional<std::string> error;
+        std::chrono::steady_clock::time_point finished;
+    };
+
+    void run(std::stop_token const &stop);
+    // Requires `mutex_` being held.
+    void finish(Job &job, State state);
+    // Forgets jobs finished longer than retention ago. Requires `mutex_`
+    // being held.
+    void prune();
+
+    SchedulerOptions options_;
+    std::mutex mutex_;
+    std::condition_variable_any cv_;
+    std::condition_variable idle_;
+    std::map<std::string, std::shared_ptr<Job>, std::less<>> jobs_;
+    std::map<QueueKey, std::shared_ptr<Job>> queue_;
+    std::uint64_t sequence_{};
+    std::size_t running_{};
+    std::vector<std::jthread> workers_; // Last, so joined first
+};
+
+} // namespace hc::jobs
@@ -0,0 +1,103 @@
+#pragma once
+#include <hc/plagiarism.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace hc::minhash {
+
+// Banding of signatures. Pairs of Jaccard similarity s collide in some band
+// with probability 1 - (1 - s^rows)^bands, i.e. ~0.12 at s = 0.3, ~0.64 at
+// s = 0.5 and ~0.9998 at s = 0.8. The curve is steepest near
+// (1 / bands)^(1 / rows) = 0.5.
+inline constexpr std::size_t bands = 16;
+inline constexpr std::size_t rows = 4;
+
+/// @brief  MinHash of a set, whose rows agree between two sets with
+/// probability of their Jaccard similarity.
+using Signature = std::array<std::uint32_t, bands * rows>;
+
+/// @brief  MinHash of winnowing fingerprints of a document, so that it
+/// tolerates the same reformatting. All rows of an empty set are max.
+Signature signature(hc::plagiarism::Fingerprints const &fingerprints);
+
+/// @brief  Estimated Jaccard similarity, the fraction of agreeing rows.
+double similarity(Signature const &a, Signature const &b) noexcept;
+
+/// @brief  Packs a signature into little-endian bytes, as persisted.
+std::vector<std::uint8_t> pack(Signature const &signature);
+/// @brief  Throws `std::invalid_argument` if `bytes` is not of a signature.
+Signature unpack(std::span<std::uint8_t const> bytes);
+
+struct Match {
+    std::string assignment_name;
+    std::string student_id;
+    double similarity; // Estimated Jaccard similarity
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(Match, assignment_name, student_id,
+                                   similarity);
+};
+
+/// @brief  Locality-sensitive hashing of signatures of submissions across
+/// all assignments. Each band of a signature is a key into the bucket table
+/// of the band, so a query only compares with submissions colliding with it
+/// in some band, instead of all of them.
+///
+/// Not thread-safe.
+class LshIndex {
+  public:
+    /// @brief  Replaces the signature of the submission unless `sequence` is
+    /// older than that of the current one. Empty documents are left out, as
+    /// they'd all collide.
+    void put(std::string const &assignment_name, std::string const &student_id,
+             Signature const &signature, std::uint64_t sequence = 0);
+
+    void erase(std::string const &assignment_name,
+               std::string const &student_id);
+
+    [[nodiscard]] Signature const *find(std::string const &assignment_name,
+                                        std::string const &student_id) const;
+
+    [[nodiscard]] std::size_t size() const noexcept;
+
+    /// @brief  At most `limit` submissions estimated at least
+    /// `min_similarity` similar to `signature`, most similar first.
+    [[nodiscard]] std::vector<Match> query(Signature const &signature,
+                                           std::size_t limit,
+                                           double min_similarity) const;
+
+  private:
+    using DocId = std::uint32_t;
+    static constexpr auto none = static_cast<DocId>(-1);
+
+    struct Document {
+        std::string assignment_name;
+        std::string student_id;
+        Signature signature;
+        std::uint64_t sequence;
+        // Next document in the bucket of each band. Buckets are chained
+        // through documents instead of owning containers, which matters at
+        // millions of documents.
+        std::array<DocId, bands> next;
+    };
+
+    static std::uint64_t band_key(Signature const &signature,
+                                  std::size_t band) noexcept;
+    void link(DocId id);
+    void unlink(DocId id);
+
+    std::vector<Document> documents_;
+    std::vector<DocId> free_; // Slots of erased documents
+    std::map<std::pair<std::string, std::string>, DocId> ids_;
+    // Band key -> first document of the bucket, per band.
+    std::array<std::unordered_map<std::uint64_t, DocId>, bands> buckets_;
+};
+
+} // namespace hc::minhash
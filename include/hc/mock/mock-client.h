@@ -1,5 +1,7 @@
 #pragma once
+#include <cstddef>
 #include <httplib.h>
+#include <string>
 
 namespace hc::mock {
 
@@ -12,6 +14,24 @@ void successfully_add_assignment_testassignmentinfinite(
 
 void successfully_add_student_ljf(httplib::Client &client);
 
+void successfully_add_student_lilei(httplib::Client &client);
+
 void ljf_successfully_submit_to_testassignmentinfinite(httplib::Client &client);
 
+void ljf_successfully_stream_submit_to_testassignmentinfinite(
+    httplib::Client &client);
+
+// Submits `content` as "report.txt" of the student, whose name is
+// percent-encoded.
+void successfully_stream_submit_to_testassignmentinfinite(
+    httplib::Client &client, std::string const &student_id,
+    std::string const &student_name, std::string const &content);
+
+// A report of `paragraphs` paragraphs, none alike.
+std::string report_text(std::size_t paragraphs);
+
+// Logs in as the admin, and returns headers authorizing as them. Throws
+// if login fails.
+httplib::Headers admin_authorization(httplib::Client &client);
+
 } // namespace hc::mock
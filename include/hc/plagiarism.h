@@ -0,0 +1,125 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace hc::plagiarism {
+
+/// @brief  Sorted and unique hashes selected from a document.
+using Fingerprints = std::vector<std::uint64_t>;
+
+struct WinnowOptions {
+    std::size_t k{25};      // Characters per k-gram
+    std::size_t window{20}; // K-grams per window
+    // Only the smallest are kept beyond this, which are still consistent
+    // among documents, so that huge files don't blow up the index.
+    std::size_t max_fingerprints{1 << 16};
+};
+
+/// @brief  Fingerprints a document with winnowing (Schleimer et al., 2003),
+/// fed as data streams by. Whitespace is ignored and ASCII letters are
+/// lowercased, so reformatting doesn't hide copying. Any common substring of
+/// at least `k + window - 1` such characters shares a fingerprint.
+class Winnower {
+  public:
+    explicit Winnower(WinnowOptions const &options = {});
+
+    void update(std::span<char const> data);
+
+    /// @brief  Don't update afterwards.
+    Fingerprints finish();
+
+  private:
+    void push(unsigned char c);
+    void select(std::uint64_t hash);
+
+    WinnowOptions options_;
+    std::uint64_t power_{1}; // Base ^ (k - 1), to roll the leading char out
+    std::uint64_t hash_{};   // Of the last k characters
+    std::vector<unsigned char> ring_; // The last k characters
+    std::size_t chars_{};
+    // Candidates of the current window, increasing in hash, as (hash,
+    // position). Front is the rightmost minimum.
+    std::deque<std::pair<std::uint64_t, std::size_t>> minima_;
+    std::size_t grams_{};
+    std::size_t selected_at_{SIZE_MAX};
+    Fingerprints selected_;
+};
+
+Fingerprints fingerprint(std::span<char const> data,
+                         WinnowOptions const &options = {});
+
+/// @brief  Fingerprints a file. Throws `std::system_error` on failure.
+Fingerprints fingerprint_file(std::filesystem::path const &path,
+                              WinnowOptions const &options = {});
+
+/// @brief  Packs fingerprints into little-endian bytes, as persisted.
+std::vector<std::uint8_t> pack(Fingerprints const &fingerprints);
+Fingerprints unpack(std::span<std::uint8_t const> bytes);
+
+struct SimilarPair {
+    std::string first;  // Student ID
+    std::string second; // Student ID
+    std::size_t shared; // Fingerprints in both
+    // `shared` over fingerprints of the smaller one, i.e. how much of it is
+    // found in the other.
+    double similarity;
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(SimilarPair, first, second, shared,
+                                   similarity);
+};
+
+/// @brief  Inverted index (fingerprint -> documents) of the submissions of
+/// an assignment, keyed by student ID. Counts of shared fingerprints of every
+/// pair are maintained as documents come and go, so updating a document
+/// costs the postings of its fingerprints, and querying doesn't read any
+/// document.
+///
+/// Not thread-safe.
+class Index {
+  public:
+    /// @brief  Replaces the document of `student_id` unless `sequence` is
+    /// older than that of the current one, e.g. an update that lost a race
+    /// to a newer one.
+    void put(std::string const &student_id, Fingerprints fingerprints,
+             std::uint64_t sequence = 0);
+
+    void erase(std::string const &student_id);
+
+    [[nodiscard]] std::size_t size() const noexcept;
+
+    /// @brief  Copy of fingerprints of all documents, by student ID.
+    [[nodiscard]] std::map<std::string, Fingerprints> documents() const;
+
+    /// @brief  At most `limit` pairs, most similar first. Pairs with less
+    /// than `min_shared` fingerprints in common are left out.
+    [[nodiscard]] std::vector<SimilarPair>
+    top_pairs(std::size_t limit, std::size_t min_shared = 1) const;
+
+  private:
+    using DocId = std::uint32_t;
+
+    struct Document {
+        std::string student_id;
+        Fingerprints fingerprints;
+        std::uint64_t sequence;
+    };
+
+    static std::uint64_t pair_key(DocId a, DocId b) noexcept;
+    void unlink(DocId id);
+
+    std::vector<Document> documents_;
+    std::vector<DocId> free_; // Slots of erased documents
+    std::unordered_map<std::string, DocId> ids_;
+    std::unordered_map<std::uint64_t, std::vector<DocId>> postings_;
+    std::unordered_map<std::uint64_t, std::uint32_t> shared_; // By pair_key
+};
+
+} // namespace hc::plagiarism
@@ -0,0 +1,41 @@
+#pragma once
+#include <hc/student.h>
+#include <hc/teacher.h>
+
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace hc::roster {
+
+/// @brief  A roster that can't be parsed, e.g. a row with a wrong number of
+/// fields.
+class ParseError : public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+/// @brief  Splits CSV text (RFC 4180) into rows of fields. Quoted fields may
+/// contain commas, quotes ("") and line breaks. CRLF, LF and a leading UTF-8
+/// BOM, as spreadsheets export, are accepted. Empty lines are skipped.
+/// Throws `ParseError` on an unterminated quote.
+std::vector<std::vector<std::string>> parse_csv(std::string_view text);
+
+/// @brief  Parses a roster of students, either CSV with `student_id,name`
+/// rows (a header row is optional) or a JSON array of `Student`. Throws
+/// `ParseError` if malformed.
+std::vector<Student> parse_students(std::string_view body, bool csv);
+
+/// @brief  Same as `parse_students()`, with `teacher_id,name,password` rows.
+std::vector<Teacher> parse_teachers(std::string_view body, bool csv);
+
+/// @brief  Problems of rows on their own or among each other, e.g. bad ID
+/// length or duplicate IDs, one message per problem. Rows are numbered from
+/// 1. Duplicates against existing data aren't checked.
+std::vector<std::string> validate(std::span<Student const> students);
+std::vector<std::string> validate(std::span<Teacher const> teachers);
+
+} // namespace hc::roster
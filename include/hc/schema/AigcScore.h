@@ -0,0 +1,36 @@
+#pragma once
+
+// clang-format off
+// generated schema header (made to match sqlpp23 expectations)
+
+#include <optional>
+
+#include <sqlpp23/core/basic/table.h>
+#include <sqlpp23/core/basic/table_columns.h>
+#include <sqlpp23/core/name/create_name_tag.h>
+#include <sqlpp23/core/type_traits.h>
+
+namespace schema {
+  struct AigcScore_ {
+    struct ContentHash {
+      SQLPP_CREATE_NAME_TAG_FOR_SQL_AND_CPP(content_hash, content_hash);
+      using data_type = ::sqlpp::text;
+      using has_default = std::false_type;
+    };
+    struct Score {
+      SQLPP_CREATE_NAME_TAG_FOR_SQL_AND_CPP(score, score);
+      using data_type = ::sqlpp::floating_point;
+      using has_default = std::false_type;
+    };
+    SQLPP_CREATE_NAME_TAG_FOR_SQL_AND_CPP(aigc_score, aigc_score);
+    template<typename T>
+    using _table_columns = sqlpp::table_columns<T,
+               ContentHash,
+               Score>;
+    using _required_insert_columns = sqlpp::detail::type_set<
+               sqlpp::column_t<sqlpp::table_t<AigcScore_>, ContentHash>,
+               sqlpp::column_t<sqlpp::table_t<AigcScore_>, Score>>;
+  };
+  using AigcScore = ::sqlpp::table_t<AigcScore_>;
+
+} // namespace schema
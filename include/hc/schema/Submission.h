@@ -37,6 +37,11 @@ namespace schema {
       using data_type = ::sqlpp::text;
       using has_default = std::false_type;
     };
+    struct ContentHash {
+      SQLPP_CREATE_NAME_TAG_FOR_SQL_AND_CPP(content_hash, content_hash);
+      using data_type = std::optional<::sqlpp::text>;
+      using has_default = std::true_type;
+    };
     SQLPP_CREATE_NAME_TAG_FOR_SQL_AND_CPP(submission, submission);
     template<typename T>
     using _table_columns = sqlpp::table_columns<T,
@@ -44,7 +49,8 @@ namespace schema {
                StudentId,
                SubmissionTime,
                Filepath,
-               OriginalFilename>;
+               OriginalFilename,
+               ContentHash>;
     using _required_insert_columns = sqlpp::detail::type_set<
                sqlpp::column_t<sqlpp::table_t<Submission_>, AssignmentName>,
                sqlpp::column_t<sqlpp::table_t<Submission_>, StudentId>,
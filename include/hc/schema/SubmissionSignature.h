@@ -0,0 +1,43 @@
+#pragma once
+
+// clang-format off
+// generated schema header (made to match sqlpp23 expectations)
+
+#include <optional>
+
+#include <sqlpp23/core/basic/table.h>
+#include <sqlpp23/core/basic/table_columns.h>
+#include <sqlpp23/core/name/create_name_tag.h>
+#include <sqlpp23/core/type_traits.h>
+
+namespace schema {
+  struct SubmissionSignature_ {
+    struct AssignmentName {
+      SQLPP_CREATE_NAME_TAG_FOR_SQL_AND_CPP(assignment_name, assignment_name);
+      using data_type = ::sqlpp::text;
+      using has_default = std::false_type;
+    };
+    struct StudentId {
+      SQLPP_CREATE_NAME_TAG_FOR_SQL_AND_CPP(student_id, student_id);
+      using data_type = ::sqlpp::text;
+      using has_default = std::false_type;
+    };
+    struct Signature {
+      SQLPP_CREATE_NAME_TAG_FOR_SQL_AND_CPP(signature, signature);
+      using data_type = ::sqlpp::blob;
+      using has_default = std::false_type;
+    };
+    SQLPP_CREATE_NAME_TAG_FOR_SQL_AND_CPP(submission_signature, submission_signature);
+    template<typename T>
+    using _table_columns = sqlpp::table_columns<T,
+               AssignmentName,
+               StudentId,
+               Signature>;
+    using _required_insert_columns = sqlpp::detail::type_set<
+               sqlpp::column_t<sqlpp::table_t<SubmissionSignature_>, AssignmentName>,
+               sqlpp::column_t<sqlpp::table_t<SubmissionSignature_>, StudentId>,
+               sqlpp::column_t<sqlpp::table_t<SubmissionSignature_>, Signature>>;
+  };
+  using SubmissionSignature = ::sqlpp::table_t<SubmissionSignature_>;
+
+} // namespace schema
@@ -1,16 +1,37 @@
 #pragma once
+#include <hc/aigc.h>
+#include <hc/archive.h>
 #include <hc/assignment.h>
+#include <hc/blob-store.h>
+#include <hc/connection-pool.h>
+#include <hc/export-cache.h>
+#include <hc/extract.h>
+#include <hc/jobs.h>
+#include <hc/minhash.h>
+#include <hc/optional.h>
+#include <hc/plagiarism.h>
+#include <hc/schema/AigcScore.h>
 #include <hc/schema/Assignment.h>
 #include <hc/schema/Student.h>
 #include <hc/schema/Submission.h>
+#include <hc/schema/SubmissionFingerprint.h>
+#include <hc/schema/SubmissionSignature.h>
 #include <hc/schema/Teacher.h> 
+#include <hc/session-store.h>
+#include <hc/similarity.h>
 #include <hc/student.h>
 #include <hc/submission.h>
 #include <hc/teacher.h>
+#include <hc/write-behind.h>
 #include <httplib.h>
+#include <atomic>
 #include <map>
+#include <memory>
 #include <queue>
 #include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
 #include <spdlog/spdlog.h>
 #include <sqlpp23/postgresql/postgresql.h>
 #include <optional>
@@ -24,8 +45,34 @@ std::map<std::string, Assignment> load_assignments(sqlpp::postgresql::connection
 // TeacherID -> Teacher
 std::map<std::string, Teacher> load_teachers(sqlpp::postgresql::connection &db);
 
+// (AssignmentName, StudentID) -> Fingerprints of the submission
+std::map<std::pair<std::string, std::string>, hc::plagiarism::Fingerprints>
+load_fingerprints(sqlpp::postgresql::connection &db);
+
+// (AssignmentName, StudentID) -> MinHash signature of the submission
+std::map<std::pair<std::string, std::string>, hc::minhash::Signature>
+load_signatures(sqlpp::postgresql::connection &db);
+
+// ContentHash -> AIGC rate of the file
+std::unordered_map<std::string, double>
+load_aigc_scores(sqlpp::postgresql::connection &db);
+
+/// @brief  Changes that couldn't be committed to database, and were rolled
+/// back in memory.
+class PersistError : public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+// Outcome of `Server::ingest_submissions()`.
+struct IngestResult {
+    std::size_t ingested{};
+    std::vector<std::string> skipped; // "path: reason" of entries left out
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(IngestResult, ingested, skipped);
+};
+
 class Server {
-    using DatabaseConnection = sqlpp::postgresql::connection;
+    using DatabaseConfig = sqlpp::postgresql::connection_config;
 
   public:
     Server(Server const &) = delete;
@@ -33,7 +80,10 @@ class Server {
     Server &operator=(Server const &) = delete;
     Server &operator=(Server &&) = delete;
 
-    Server(DatabaseConnection &&db);
+    /// @brief  Connects to database with a pool sized by
+    /// `config::db_pool_size()`, probing connections idle for
+    /// `config::db_probe_after()`.
+    Server(DatabaseConfig const &db_config);
 
     ~Server() noexcept;
 
@@ -53,6 +103,18 @@ class Server {
     void wait_until_started() noexcept;
     void wait_until_stopped() noexcept;
 
+    /// @brief  Ingests submissions from an archive laid out like exports,
+    /// i.e. `assignment_name/student_id+student_name/filename`, e.g. when
+    /// migrating from another system. Files are extracted into the blob store
+    /// in one pass, then registered all at once, replacing
+    /// submissions of the same students. Entry mtime is taken as submission
+    /// time. Entries of unknown assignments or students are skipped.
+    ///
+    /// Throws if the archive can't be read, with nothing ingested. Throws
+    /// `PersistError` if they can't be committed to database, with nothing
+    /// ingested either.
+    IngestResult ingest_submissions(std::filesystem::path const &archive);
+
   private:
     bool verify_assignment_not_exists(std::string_view assignment_name,
                                       httplib::Response &w) noexcept;
@@ -66,63 +128,346 @@ class Server {
 
     using Handler = void (Server::*)(httplib::Request const &,
                                      httplib::Response &);
+    using StreamHandler = void (Server::*)(httplib::Request const &,
+                                           httplib::Response &,
+                                           httplib::ContentReader const &);
     void get(std::string const &path, Handler h);
     void post(std::string const &path, Handler h);
+    void post(std::string const &path, StreamHandler h);
 
     void hi(httplib::Request const &_, httplib::Response &w);
 
     void api_admin_login(httplib::Request const &r, httplib::Response &w);
     void api_admin_verify_token(httplib::Request const &r,
                                 httplib::Response &w);
+    /// @brief  Lists assignments. Without query, responds the full list.
+    /// Otherwise, responds an `AssignmentsPage`, with queries:
+    ///   - view=full|summary: Whether items are `Assignment`s or
+    ///     `AssignmentSummary`s. Defaults to full.
+    ///   - name=...: Only assignments whose name contains it.
+    ///   - limit=N: At most N items per page.
+    ///   - cursor=...: `next_cursor` of the previous page.
     void api_assignments(httplib::Request const &, httplib::Response &);
     void api_assignments_add(httplib::Request const &, httplib::Response &);
     void api_assignments_submit(httplib::Request const &, httplib::Response &);
 
-    /// @brief Creates a blob publicly accessible in `server/api/blob/`.
+    /// @brief  Same as `api_assignments_submit`, but the file is sent as raw
+    /// request body (application/octet-stream) and streamed to disk. Metadata
+    /// travels in percent-encoded `X-Student-Id`, `X-Student-Name`,
+    /// `X-Assignment-Name` and `X-Filename` headers.
+    void api_assignments_submit_stream(httplib::Request const &,
+                                       httplib::Response &,
+                                       httplib::ContentReader const &);
+
+    /// @brief  Admin only. Ingests the tar.zst or zip sent as raw request
+    /// body with `ingest_submissions()`, up to `config::max_ingest_size()`
+    /// bytes. Responds an `IngestResult`.
+    void api_assignments_ingest(httplib::Request const &, httplib::Response &,
+                                httplib::ContentReader const &);
+
+    /// @brief  Lists groups of students of an assignment who submitted
+    /// identical files, by `content_hash`. Query: assignment_name=... .
+    /// Responds an array of `DuplicateGroup`s.
+    void api_assignments_duplicates(httplib::Request const &,
+                                    httplib::Response &);
+
+    /// @brief  Lists pairs of submissions of an assignment sharing most
+    /// winnowing fingerprints, from the index kept up to date as students
+    /// submit. Queries: assignment_name=..., limit=N (defaults to 20).
+    /// Responds an array of `hc::plagiarism::SimilarPair`s.
+    void api_assignments_plagiarism(httplib::Request const &,
+                                    httplib::Response &);
+
+    /// @brief  Finds submissions of any assignment, e.g. of last semester,
+    /// similar to that of a student, by LSH of MinHash signatures. Queries:
+    /// assignment_name=..., student_id=..., limit=N (defaults to 20),
+    /// min_similarity=S (defaults to 0.5). Responds an array of
+    /// `hc::minhash::Match`es, without the submission itself.
+    void api_assignments_near_duplicates(httplib::Request const &,
+                                         httplib::Response &);
+
+    /// @brief  Similarities between all pairs of submissions of an
+    /// assignment, estimated from bitsets of their fingerprints by a SIMD
+    /// popcount kernel. Queries: assignment_name=...,
+    /// measure=jaccard|containment (defaults to jaccard). Responds a
+    /// `SimilarityMatrix`.
+    void api_assignments_similarity_matrix(httplib::Request const &,
+                                           httplib::Response &);
+
+    /// @brief  Plain text extracted from the file of a submission, which is
+    /// cached by its content hash. Queries: assignment_name=...,
+    /// student_id=... . Files without text, e.g. PDFs, respond empty text.
+    /// Responds 202 while it's being extracted in background, or 503 if too
+    /// many files are, after which it should be asked again.
+    void api_assignments_submission_text(httplib::Request const &,
+                                         httplib::Response &);
+
+    /// @brief  Queues extraction of text of the file of `s`, if it's content
+    /// addressed, to be indexed by `index_text()` then. `raw` are
+    /// fingerprints of its bytes, which it's indexed by at `sequence` until
+    /// then.
+    void extract_text_later(Submission const &s, std::uint64_t sequence,
+                            hc::plagiarism::Fingerprints raw);
+
+    /// @brief  Persists and indexes fingerprints of `text` of `s` in place
+    /// of `raw`, unless they're the same, e.g. of plain text, or `s` is no
+    /// longer current. From an extraction thread.
+    void index_text(Submission const &s, std::uint64_t sequence,
+                    hc::plagiarism::Fingerprints const &raw,
+                    std::string const &text);
+
+    /// @brief  AIGC rates of submissions of an assignment, null for those
+    /// not scored yet. Query: assignment_name=... . Responds an array of
+    /// `hc::aigc::SubmissionScore`s.
+    void api_assignments_aigc(httplib::Request const &, httplib::Response &);
+
+    /// @brief  Queues scoring of the file of `s`, if a scoring endpoint is
+    /// configured and no identical file is scored already.
+    void score_later(Submission const &s);
+
+    /// @brief  Caches and persists scores, from the scorer thread.
+    void take_aigc_scores(std::span<hc::aigc::Scored const> scored);
+
+    /// @brief  Drops the file of `s`: a reference to its blob, or the file
+    /// itself if stored before content addressing.
+    void release_file(Submission const &s) noexcept;
+
+    /// @brief  Swaps `s`, whose file is already stored, in as the submission
+    /// of its student within a short exclusive section. Once it's persisted,
+    /// releases the file it supersedes and indexes it by `fingerprints`. The
+    /// file of `s` is released if the student or assignment fails
+    /// verification, or if persisting fails, where the superseded one is put
+    /// back and 500 is responded.
+    bool commit_submission(Submission const &s, std::string_view student_name,
+                           hc::plagiarism::Fingerprints fingerprints,
+                           httplib::Response &w);
+
+    /// @brief  Puts fingerprints of a submission into the index of its
+    /// assignment, and its signature into the LSH index. `sequence` is the
+    /// data version its submission was committed at, so that a late update
+    /// doesn't overwrite a newer one.
+    void index_submission(std::string const &assignment_name,
+                          std::string const &student_id,
+                          hc::plagiarism::Fingerprints fingerprints,
+                          hc::minhash::Signature const &signature,
+                          std::uint64_t sequence);
+
+    // A submission stored before fingerprints or signatures were.
+    struct BackfillItem {
+        std::string assignment_name;
+        std::string student_id;
+        std::filesystem::path filepath;
+        std::string content_hash; // Empty if stored before content addressing
+        std::string original_filename;
+        // Persisted ones, if any. Otherwise its text is fingerprinted.
+        std::optional<hc::plagiarism::Fingerprints> fingerprints;
+    };
+
+    /// @brief  Computes, persists and indexes what `items` lack, in
+    /// background, as it reads every file.
+    void backfill(std::stop_token const &stop, std::vector<BackfillItem> items);
+
+    /// @brief Submits a job creating a blob publicly accessible in
+    /// `server/api/blob/`, and responds 202 with a `JobSubmitted`. The job's
+    /// result is the URI of the blob. With mode "stream", responds the
+    /// archive directly instead. Profile "fast" trades size for latency, and
+    /// "small" the other way round. Format "zip" stores already compressed
+    /// files instead of compressing them again. 400 if any of them is
+    /// unknown. Requires login, and the job is owned by whoever logged in.
     void api_assignments_export(httplib::Request const &, httplib::Response &);
 
+    /// @brief  Responds `hc::jobs::Status` of job `:id`. 404 unless it's
+    /// owned by whoever logged in, or they're admin.
+    void api_jobs(httplib::Request const &, httplib::Response &);
+
+    /// @brief  Cancels job `:id`, and responds its `hc::jobs::Status`. 409 if
+    /// it's finished already. Owned as in `api_jobs()`.
+    void api_jobs_cancel(httplib::Request const &, httplib::Response &);
+
+    /// @brief  Lists files of `a` under their paths in exported archive,
+    /// i.e. `assignment_name/student_id+student_name/filename`. Requires
+    /// `lock_` being held.
+    std::vector<hc::archive::ManifestEntry>
+    export_entries(Assignment const &a) const;
+
+    /// @brief  Responds a tar.zst of `entries`, produced incrementally as
+    /// the response is sent. No temporary file is involved.
+    static void
+    stream_export(std::string const &assignment_name,
+                  std::vector<hc::archive::ManifestEntry> entries,
+                  std::string const &format,
+                  hc::archive::CompressionProfile const &profile,
+                  httplib::Response &w);
+
     void api_students(httplib::Request const &, httplib::Response &);
     void api_students_add(httplib::Request const &, httplib::Response &);
+
+    /// @brief  Adds a roster of students at once, as CSV if Content-Type is
+    /// text/csv, or JSON array otherwise. See `hc::roster`. All rows are
+    /// validated before any is added, and they're persisted in one
+    /// transaction, so either the whole roster is added or none. Responds a
+    /// `RosterImportResult`.
+    void api_students_import(httplib::Request const &, httplib::Response &);
     void api_stop(httplib::Request const &, httplib::Response &);
 
+    /// @brief  Statistics of database connection pool, for tuning its size.
+    void api_admin_db_pool(httplib::Request const &, httplib::Response &);
+
     // Teacher APIs
     void api_teacher_login(httplib::Request const &r, httplib::Response &w);
     void api_teacher_add(httplib::Request const &r, httplib::Response &w);
+    /// @brief  Same as `api_students_import`, for teachers. Admin only.
+    void api_teacher_import(httplib::Request const &r, httplib::Response &w);
     void api_teacher_verify_token(httplib::Request const &r, httplib::Response &w);
 
+    /// @brief  Validates `rows`, then merges them into `into` and enqueues
+    /// their `make_mutation`s as one group, in one exclusive section.
+    template <typename T, typename MakeMutation>
+    void import_roster(std::vector<T> rows, std::string T::*id,
+                       std::map<std::string, T> &into,
+                       MakeMutation make_mutation, httplib::Response &w);
+
     // 认证：返回 token 对应的主体（"admin" 或 teacher_id），失败返回 std::nullopt
     std::optional<std::string> authenticate_request(httplib::Request const &req,
                                                     httplib::Response &w) noexcept;
 
+    // Serialized body of a GET endpoint at some data version. Immutable once
+    // published, so responses share it instead of copying.
+    struct CachedBody {
+        std::uint64_t version;
+        std::shared_ptr<std::string const> body;
+    };
+
+    /// @brief  Returns body in `cache` if it's up to date, otherwise renders
+    /// a new one with `render` under shared `lock_` and publishes it.
+    std::shared_ptr<CachedBody const>
+    cached(std::atomic<std::shared_ptr<CachedBody const>> &cache,
+           std::string (Server::*render)() const);
+
+    /// @brief  Responds `cached` with an ETag derived from its version, or
+    /// 304 if it matches `If-None-Match` of the request.
+    void serve_cached(httplib::Request const &r, httplib::Response &w,
+                      std::shared_ptr<CachedBody const> const &cached);
+
+    // Renderers for cached GET endpoints. Require `lock_` being held.
+    std::string render_assignments() const;
+    std::string render_students() const;
+
+    /// @brief  Must be called by every mutation of data, while holding `lock_`
+    /// exclusively.
+    void bump_data_version() noexcept;
+
     // Clean files
     static void clean_all_files();
     void clean_expired_files();
+    /// @brief  Submits a job of `clean_expired_files()`, unless one is
+    /// pending already.
+    void clean_later();
+    /// @brief  Removes `path` an hour later, after downloads are done.
+    void remove_later(std::filesystem::path path);
+
+    // Distinguishes ETags of different runs, as data version restarts from 0.
+    std::string instance_id_;
 
     httplib::Server http_server_;
 
     // If has_value, then server is running
     std::optional<std::jthread> server_thread_;
 
-    DatabaseConnection db_;
+    hc::db::ConnectionPool db_;
+    hc::db::WriteBehind writer_; // All writes to database go through it
     std::shared_mutex lock_; // For data
     std::mutex http_lock_;   // For http server
     std::map<std::string, Student> students_;
     std::map<std::string, Assignment> assignments_;
     std::map<std::string, Teacher> teachers_;
+    hc::BlobStore blob_store_; // Files of submissions
+    // Guards both indexes below. They're updated after `lock_` is released,
+    // so ordered by sequence instead.
+    std::mutex plagiarism_lock_;
+    // AssignmentName -> Index of its submissions
+    std::map<std::string, hc::plagiarism::Index> plagiarism_;
+    hc::minhash::LshIndex near_duplicates_; // Of all submissions
+    // Text of blobs. Destroyed before what its callbacks use above.
+    hc::extract::Service extraction_;
+    std::mutex aigc_lock_;
+    // ContentHash -> score, so that identical files are scored once.
+    std::unordered_map<std::string, double> aigc_scores_;
+    // Null unless a scoring endpoint is configured. Destroyed before what
+    // its callbacks use above.
+    std::unique_ptr<hc::aigc::Scorer> scorer_;
+    std::mutex tmp_files_lock_;
     std::queue<std::pair<TimePoint, std::filesystem::path>> tmp_files_;
+    std::atomic_bool cleanup_pending_;
+    hc::ExportCache export_cache_;
 
-    // token -> principal ("admin" or teacher_id)
-    std::map<std::string, std::string> tokens_;
+    std::atomic_uint64_t data_version_;
+    std::atomic<std::shared_ptr<CachedBody const>> assignments_cache_;
+    std::atomic<std::shared_ptr<CachedBody const>> students_cache_;
+
+    // token -> principal ("admin" or teacher_id). Not guarded by `lock_`.
+    hc::SessionStore sessions_;
+
+    // Exports and cleanups. Destroyed after `backfill_thread_` but before
+    // everything else, so that jobs stop before what they use is destroyed.
+    hc::jobs::Scheduler jobs_;
+
+    // Last, so that it stops before what it uses is destroyed.
+    std::jthread backfill_thread_;
+};
+
+// Projection of Assignment, without submission details.
+struct AssignmentSummary {
+    std::string name;
+    TimePoint start_time;
+    TimePoint end_time;
+    std::size_t submission_count;
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(AssignmentSummary, name, start_time,
+                                   end_time, submission_count);
+};
+
+struct AssignmentsPage {
+    nlohmann::json items; // Array of Assignment or AssignmentSummary
+    std::optional<std::string> next_cursor; // null if there are no more
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(AssignmentsPage, items, next_cursor);
 };
 
 struct ApiAssignmentsExportParam {
     std::string assignment_name;
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(ApiAssignmentsExportParam, assignment_name);
+    std::string mode{"blob"};       // "blob" or "stream"
+    std::string profile{"default"}; // See `CompressionProfile::from_name()`
+    std::string format{"tar.zst"};  // "tar.zst" or "zip"
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(ApiAssignmentsExportParam,
+                                                assignment_name, mode,
+                                                profile, format);
+};
+
+struct RosterImportResult {
+    std::size_t imported;
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(RosterImportResult, imported);
+};
+
+// Students whose submissions are byte-for-byte identical.
+struct DuplicateGroup {
+    std::string content_hash;
+    std::vector<std::string> student_ids;
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(DuplicateGroup, content_hash, student_ids);
+};
+
+// Similarities between all pairs of submissions of an assignment, for a
+// heatmap. Row i and column j are of student_ids[i] and student_ids[j].
+struct SimilarityMatrix {
+    std::string measure;
+    std::vector<std::string> student_ids;
+    std::vector<std::vector<float>> matrix;
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(SimilarityMatrix, measure, student_ids,
+                                   matrix);
 };
 
-struct AssignmentsExportResult {
-    std::string exported_uri;
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(AssignmentsExportResult, exported_uri);
+struct JobSubmitted {
+    std::string job_id;
+    std::string status_uri; // GET it for `hc::jobs::Status`
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE(JobSubmitted, job_id, status_uri);
 };
 
 // Teacher Login DTOs
@@ -0,0 +1,226 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace hc {
+
+/// @brief  Hierarchical timer wheel: 4 levels of 64 slots, where a slot of
+/// level i spans 64^i ticks. Timers are placed by how far they're due, and
+/// move one level down each time the level below wraps, so scheduling is
+/// O(1) and each timer is touched at most 4 times however many are pending.
+/// Timers farther than 64^4 ticks are kept at the top and placed again on
+/// cascade.
+template <typename T> class TimerWheel {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    TimerWheel(Clock::duration tick, Clock::time_point now)
+        : tick_{tick}, origin_{now}
+    {
+    }
+
+    /// @brief  Schedules `payload` to fire at `when`, rounded up to a tick.
+    /// Times passed fire at the next tick.
+    void schedule(T payload, Clock::time_point when)
+    {
+        auto const due = std::max(ticks_at(when, true), current_ + 1);
+        place({due, std::move(payload)});
+        ++size_;
+    }
+
+    /// @brief  Advances to `now`, returning payloads due by then.
+    std::vector<T> advance(Clock::time_point now)
+    {
+        std::vector<T> fired;
+        auto const target = ticks_at(now, false);
+        if (size_ == 0) {
+            current_ = std::max(current_, target);
+            return fired;
+        }
+        while (current_ < target) {
+            ++current_;
+            // When a level wraps, the next slot of the level above moves
+            // down.
+            for (auto level = 1UZ; level != levels; ++level) {
+                if (((current_ >> (bits * (level - 1))) & mask) != 0) {
+                    break;
+                }
+                cascade(level);
+            }
+            auto &slot = wheels_[0][current_ & mask];
+            for (auto &t : slot) {
+                fired.push_back(std::move(t.payload));
+            }
+            size_ -= slot.size();
+            slot.clear();
+            if (size_ == 0) {
+                current_ = target;
+            }
+        }
+        return fired;
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return size_;
+    }
+
+  private:
+    static constexpr auto levels = 4UZ;
+    static constexpr auto bits = 6UZ;
+    static constexpr auto slots = std::size_t{1} << bits;
+    static constexpr auto mask = std::uint64_t{slots - 1};
+
+    struct Timer {
+        std::uint64_t due; // In ticks since origin
+        T payload;
+    };
+
+    std::uint64_t ticks_at(Clock::time_point t, bool round_up) const
+    {
+        if (t <= origin_) {
+            return 0;
+        }
+        auto const elapsed = t - origin_;
+        auto n = static_cast<std::uint64_t>(elapsed / tick_);
+        if (round_up && elapsed % tick_ != Clock::duration::zero()) {
+            ++n;
+        }
+        return n;
+    }
+
+    void place(Timer t)
+    {
+        auto const delta = t.due - current_;
+        for (auto level = 0UZ; level != levels - 1; ++level) {
+            if (delta < (std::uint64_t{1} << (bits * (level + 1)))) {
+                wheels_[level][(t.due >> (bits * level)) & mask].push_back(
+                    std::move(t));
+                return;
+            }
+        }
+        // Beyond the top level's span, it's kept at the farthest slot and
+        // placed again when that slot cascades.
+        auto constexpr top = levels - 1;
+        auto const span = std::uint64_t{1} << (bits * levels);
+        auto const due = delta < span ? t.due : current_ + span - 1;
+        wheels_[top][(due >> (bits * top)) & mask].push_back(std::move(t));
+    }
+
+    void cascade(std::size_t level)
+    {
+        auto &slot = wheels_[level][(current_ >> (bits * level)) & mask];
+        auto timers = std::move(slot);
+        slot.clear();
+        for (auto &t : timers) {
+            place(std::move(t));
+        }
+    }
+
+    Clock::duration tick_;
+    Clock::time_point origin_;
+    std::uint64_t current_{}; // Ticks advanced so far
+    std::size_t size_{};
+    std::array<std::array<std::vector<Timer>, slots>, levels> wheels_;
+};
+
+struct SessionOptions {
+    // Since login, however active the session is.
+    std::chrono::milliseconds absolute_ttl{std::chrono::hours{12}};
+    // Since last use.
+    std::chrono::milliseconds idle_ttl{std::chrono::hours{2}};
+    // Resolution of expiry, and how often expired sessions are swept.
+    std::chrono::milliseconds tick{std::chrono::seconds{1}};
+    std::size_t shards{16};
+};
+
+/// @brief  Login sessions by token. Tokens are spread over shards, each with
+/// its own lock and timer wheel, so that checking a token takes a shared
+/// lock of one shard and never contends with other data. Sessions expire
+/// after absolute or idle TTL, whichever is first, and are removed by a
+/// background sweep, so memory stays bounded by logins within a TTL.
+class SessionStore {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit SessionStore(SessionOptions options);
+
+    SessionStore(SessionStore const &) = delete;
+    SessionStore(SessionStore &&) = delete;
+    SessionStore &operator=(SessionStore const &) = delete;
+    SessionStore &operator=(SessionStore &&) = delete;
+
+    ~SessionStore() = default;
+
+    /// @brief  Starts a session of `principal`, e.g. "admin" or a
+    /// teacher_id, and returns its token.
+    std::string create(std::string principal);
+
+    /// @brief  Returns the principal of `token` if its session is alive,
+    /// which also counts as a use.
+    std::optional<std::string> find(std::string_view token);
+
+    /// @brief  Ends the session of `token`, if any.
+    void revoke(std::string_view token);
+
+    /// @brief  Sessions not swept yet, including expired ones.
+    [[nodiscard]] std::size_t size() const;
+
+    /// @brief  Removes expired sessions now rather than at the next sweep.
+    void sweep();
+
+  private:
+    using Rep = Clock::duration::rep;
+
+    struct Session {
+        std::string principal;
+        Clock::time_point expires; // Absolute TTL
+        // Since epoch of `Clock`. Updated under shared lock.
+        std::atomic<Rep> last_used;
+    };
+
+    struct Hash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const noexcept
+        {
+            return std::hash<std::string_view>{}(s);
+        }
+    };
+
+    struct Shard {
+        explicit Shard(Clock::duration tick) : timers{tick, Clock::now()} {}
+
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, std::unique_ptr<Session>, Hash,
+                           std::equal_to<>>
+            sessions;
+        TimerWheel<std::string> timers; // Tokens, when they may expire
+    };
+
+    // When `s` expires if not used again.
+    Clock::time_point deadline(Session const &s) const;
+    Shard &shard_of(std::string_view token);
+    void run(std::stop_token const &stop);
+
+    SessionOptions options_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::mutex sweep_mutex_; // Only to wait on
+    std::condition_variable_any sweep_cv_;
+    std::jthread sweeper_; // Last, so joined first
+};
+
+} // namespace hc
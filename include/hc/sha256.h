@@ -0,0 +1,35 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+
+namespace hc {
+
+/// @brief  Incremental SHA-256 (FIPS 180-4), fed as data streams by.
+class Sha256 {
+  public:
+    using Digest = std::array<std::uint8_t, 32>;
+
+    Sha256() noexcept;
+
+    void update(std::span<char const> data) noexcept;
+
+    /// @brief  Pads and returns the digest. Don't update afterwards.
+    Digest finish() noexcept;
+
+    /// @brief  Lowercase hex of `finish()`, as stored in database.
+    std::string hex_digest();
+
+    static std::string hex(Digest const &digest);
+
+  private:
+    void compress(std::uint8_t const *block) noexcept;
+
+    std::array<std::uint32_t, 8> state_;
+    std::array<std::uint8_t, 64> buffer_{};
+    std::size_t buffered_{};
+    std::uint64_t length_{}; // Bytes so far
+};
+
+} // namespace hc
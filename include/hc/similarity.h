@@ -0,0 +1,80 @@
+#pragma once
+#include <hc/plagiarism.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace hc::similarity {
+
+/// @brief  Implementations of the popcount kernel, chosen at runtime by what
+/// the CPU supports.
+enum class Kernel {
+    scalar,
+    avx2,   // Nibble lookup by pshufb, summed by psadbw
+    avx512, // vpopcntq
+};
+
+[[nodiscard]] std::string_view to_string(Kernel kernel) noexcept;
+[[nodiscard]] std::optional<Kernel> kernel_from_name(std::string_view name);
+
+/// @brief  Whether the CPU runs `kernel`. The scalar one always runs.
+[[nodiscard]] bool supported(Kernel kernel) noexcept;
+
+/// @brief  The fastest kernel the CPU runs, detected once.
+[[nodiscard]] Kernel best_kernel() noexcept;
+
+/// @brief  Number of bits set in both `a` and `b`, which are of a size.
+[[nodiscard]] std::uint64_t and_count(std::span<std::uint64_t const> a,
+                                      std::span<std::uint64_t const> b,
+                                      Kernel kernel = best_kernel());
+
+/// @brief  Fingerprint sets as bitsets of a common width, so that the size of
+/// an intersection is a popcount of words instead of a merge of sorted
+/// arrays. The width is a power of two with at least 16 bits per fingerprint
+/// of the largest set, so that collisions hardly bias the estimate.
+class Sketches {
+  public:
+    explicit Sketches(std::span<hc::plagiarism::Fingerprints const> sets);
+
+    [[nodiscard]] std::size_t size() const noexcept;
+    /// @brief  64-bit words per bitset.
+    [[nodiscard]] std::size_t words() const noexcept;
+    [[nodiscard]] std::span<std::uint64_t const>
+    operator[](std::size_t i) const noexcept;
+    /// @brief  Bits set in the bitset of set `i`.
+    [[nodiscard]] std::uint64_t count(std::size_t i) const noexcept;
+
+  private:
+    std::size_t words_;
+    std::vector<std::uint64_t> bits_; // Row-major
+    std::vector<std::uint64_t> counts_;
+};
+
+enum class Measure {
+    jaccard,     // |A ∩ B| / |A ∪ B|
+    containment, // |A ∩ B| / min(|A|, |B|), for copies padded with own text
+};
+
+[[nodiscard]] std::optional<Measure> measure_from_name(std::string_view name);
+
+struct MatrixOptions {
+    Measure measure{Measure::jaccard};
+    Kernel kernel{best_kernel()};
+    std::size_t threads{0}; // At most, 0 for hardware concurrency
+};
+
+/// @brief  Row-major n x n matrix of similarities between all pairs of
+/// `sketches`, in [0, 1]. Tiles of the upper triangle, sized so that both
+/// blocks of rows stay in L2, are spread over threads.
+///
+/// Threads beyond the caller's come from a budget of hardware concurrency
+/// shared by all calls at once, so that concurrent calls don't oversubscribe
+/// the CPU. A call finding none left runs on the caller's thread alone.
+[[nodiscard]] std::vector<float> matrix(Sketches const &sketches,
+                                        MatrixOptions const &options = {});
+
+} // namespace hc::similarity
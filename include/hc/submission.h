@@ -11,8 +11,12 @@ struct Submission {
     TimePoint submission_time;
     std::filesystem::path filepath;
     std::string original_filename;
+    // SHA-256 of the file, which is then stored in `hc::BlobStore`. Empty for
+    // files stored before content addressing, which `filepath` owns alone.
+    std::string content_hash;
 
-    NLOHMANN_DEFINE_TYPE_INTRUSIVE(Submission, assignment_name, student_id,
-                                   submission_time, filepath,
-                                   original_filename);
+    NLOHMANN_DEFINE_TYPE_INTRUSIVE_WITH_DEFAULT(Submission, assignment_name,
+                                                student_id, submission_time,
+                                                filepath, original_filename,
+                                                content_hash);
 };
@@ -0,0 +1,89 @@
+#pragma once
+#include <httplib.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace hc {
+
+/// @brief  Task queue of HTTP worker threads, installed with
+/// `httplib::Server::new_task_queue`, where each worker has its own bounded
+/// lock-free queue and idle ones steal from others. Unlike
+/// `httplib::ThreadPool`, no mutex is shared by the accepting thread and all
+/// workers.
+///
+/// Tasks come from the accepting thread rather than from workers, so queues
+/// are multi-producer multi-consumer rings instead of owner-only deques:
+/// connections are spread round-robin and popped by the owner or a thief.
+class WorkStealingQueue final : public httplib::TaskQueue {
+  public:
+    /// @param max_queued  Bound of tasks waiting, divided among workers and
+    /// rounded up to a power of two each. `enqueue()` fails beyond it, and
+    /// httplib closes the connection.
+    WorkStealingQueue(std::size_t workers, std::size_t max_queued);
+
+    WorkStealingQueue(WorkStealingQueue const &) = delete;
+    WorkStealingQueue(WorkStealingQueue &&) = delete;
+    WorkStealingQueue &operator=(WorkStealingQueue const &) = delete;
+    WorkStealingQueue &operator=(WorkStealingQueue &&) = delete;
+
+    /// @brief  Shuts down if not yet.
+    ~WorkStealingQueue() override;
+
+    /// @brief  Returns false if queues are full or it's shut down.
+    bool enqueue(std::function<void()> fn) override;
+
+    /// @brief  Runs what's queued, then joins workers.
+    void shutdown() override;
+
+    /// @brief  Tasks run by a worker other than the one they were queued to.
+    [[nodiscard]] std::uint64_t steals() const noexcept
+    {
+        return steals_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    static constexpr auto cache_line = 64UZ;
+
+    // Bounded MPMC ring by Dmitry Vyukov: each cell's sequence tells whether
+    // it's free for the push at that position or full for the pop.
+    class Ring {
+      public:
+        explicit Ring(std::size_t capacity);
+
+        bool push(std::function<void()> &task);
+        bool pop(std::function<void()> &task);
+
+      private:
+        struct Cell {
+            std::atomic<std::size_t> sequence;
+            std::function<void()> task;
+        };
+
+        std::unique_ptr<Cell[]> cells_;
+        std::size_t mask_;
+        // On their own cache lines, as pushes and pops come from different
+        // threads.
+        alignas(cache_line) std::atomic<std::size_t> head_{};
+        alignas(cache_line) std::atomic<std::size_t> tail_{};
+    };
+
+    void run(std::size_t self);
+    // Pops from `self`'s ring, or steals from others.
+    bool take(std::size_t self, std::function<void()> &task);
+
+    std::vector<std::unique_ptr<Ring>> rings_; // One per worker
+    std::atomic<std::size_t> next_{};          // Ring to push to
+    // Bumped after each push, so that sleeping workers wait on it.
+    std::atomic<std::uint64_t> epoch_{};
+    std::atomic_bool stopping_{};
+    std::atomic<std::uint64_t> steals_{};
+    std::vector<std::jthread> workers_;
+};
+
+} // namespace hc
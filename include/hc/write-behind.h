@@ -0,0 +1,129 @@
+#pragma once
+#include <hc/connection-pool.h>
+#include <hc/minhash.h>
+#include <hc/plagiarism.h>
+#include <hc/student.h>
+#include <hc/submission.h>
+#include <hc/teacher.h>
+#include <hc/time-defs.h>
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace hc::db {
+
+struct InsertStudent {
+    Student student;
+};
+
+struct InsertTeacher {
+    Teacher teacher;
+};
+
+struct InsertAssignment {
+    std::string name;
+    TimePoint start_time;
+    TimePoint end_time;
+};
+
+// Replaces the row of (assignment_name, student_id) if there is one.
+struct UpsertSubmission {
+    Submission submission;
+};
+
+// Replaces fingerprints of the submission of (assignment_name, student_id).
+struct UpsertFingerprints {
+    std::string assignment_name;
+    std::string student_id;
+    hc::plagiarism::Fingerprints fingerprints;
+};
+
+// Replaces MinHash signature of the submission of (assignment_name,
+// student_id).
+struct UpsertSignature {
+    std::string assignment_name;
+    std::string student_id;
+    hc::minhash::Signature signature;
+};
+
+// Replaces AIGC rate of the file of `content_hash`.
+struct UpsertAigcScore {
+    std::string content_hash;
+    double score;
+};
+
+// Alternatives are in the order batches are written in, so that rows come
+// after those they reference, e.g. a submission after its student.
+using Mutation = std::variant<InsertStudent, InsertTeacher, InsertAssignment,
+                              UpsertSubmission, UpsertFingerprints,
+                              UpsertSignature, UpsertAigcScore>;
+
+enum class Durability {
+    commit,  // Acknowledge requests after their mutations are committed
+    enqueue, // Acknowledge requests once their mutations are queued
+};
+
+/// @brief  Persists mutations asynchronously. A dedicated writer thread drains
+/// the queue and commits everything pending in one transaction (group
+/// commit), grouping mutations by kind into multi-row statements.
+///
+/// Mutations of a kind are committed in the order they're enqueued, so
+/// callers should enqueue while still holding the lock that ordered their
+/// in-memory update. Kinds are written in the order of `Mutation`.
+class WriteBehind {
+  public:
+    WriteBehind(ConnectionPool &pool, Durability durability,
+                std::size_t max_batch = 1024);
+
+    WriteBehind(WriteBehind const &) = delete;
+    WriteBehind(WriteBehind &&) = delete;
+    WriteBehind &operator=(WriteBehind const &) = delete;
+    WriteBehind &operator=(WriteBehind &&) = delete;
+
+    /// @brief  Commits everything pending, then stops the writer thread.
+    ~WriteBehind();
+
+    /// @brief  Queues `mutations` to be committed atomically together. The
+    /// returned future becomes ready (or holds the error) after commit.
+    std::shared_future<void> enqueue(std::vector<Mutation> mutations);
+    std::shared_future<void> enqueue(Mutation mutation);
+
+    /// @brief  Blocks as required by the durability mode: until `persisted`
+    /// is committed under `Durability::commit`, not at all otherwise. Throws
+    /// if the commit failed.
+    void wait_ack(std::shared_future<void> const &persisted) const;
+
+    /// @brief  Blocks until everything enqueued so far is committed.
+    void flush();
+
+    [[nodiscard]] Durability durability() const noexcept;
+
+  private:
+    struct Group {
+        std::vector<Mutation> mutations;
+        std::promise<void> committed;
+    };
+
+    void run(std::stop_token stop);
+    void commit(std::vector<Group> &groups);
+    void execute(ConnectionPool::Handle &db, std::span<Group> groups);
+
+    ConnectionPool &pool_;
+    Durability durability_;
+    std::size_t max_batch_;
+
+    std::mutex mutex_;
+    std::condition_variable_any cv_;
+    std::condition_variable drained_;
+    std::deque<Group> queue_;
+    bool writing_{};
+
+    std::jthread writer_;
+};
+
+} // namespace hc::db
@@ -1,3 +1,6 @@
+DROP TABLE submission_fingerprint;
+DROP TABLE submission_signature;
+DROP TABLE aigc_score;
 DROP TABLE submission;
 DROP TABLE assignment;
 DROP TABLE student;
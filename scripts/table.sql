@@ -17,11 +17,41 @@ CREATE TABLE IF NOT EXISTS submission (
     submission_time TIMESTAMPTZ NOT NULL,
     filepath VARCHAR(1024) NOT NULL,
     original_filename VARCHAR(1024) NOT NULL,
+    content_hash CHAR(64),
     PRIMARY KEY (assignment_name, student_id),
     FOREIGN KEY (student_id) REFERENCES student(student_id),
     FOREIGN KEY (assignment_name) REFERENCES assignment(name)
 );
 
+-- For databases created before content addressing.
+ALTER TABLE submission ADD COLUMN IF NOT EXISTS content_hash CHAR(64);
+
+-- Winnowing fingerprints of submissions, as packed little-endian 64-bit
+-- hashes. See hc::plagiarism.
+CREATE TABLE IF NOT EXISTS submission_fingerprint (
+    assignment_name VARCHAR(50) NOT NULL,
+    student_id CHAR(12) NOT NULL,
+    fingerprints BYTEA NOT NULL,
+    PRIMARY KEY (assignment_name, student_id)
+);
+
+-- MinHash signatures of submissions, as packed little-endian 32-bit rows.
+-- See hc::minhash.
+CREATE TABLE IF NOT EXISTS submission_signature (
+    assignment_name VARCHAR(50) NOT NULL,
+    student_id CHAR(12) NOT NULL,
+    signature BYTEA NOT NULL,
+    PRIMARY KEY (assignment_name, student_id)
+);
+
+-- AIGC rates of files by content hash, i.e. shared by identical
+-- submissions. See hc::aigc.
+CREATE TABLE IF NOT EXISTS aigc_score (
+    content_hash CHAR(64) NOT NULL,
+    score DOUBLE PRECISION NOT NULL,
+    PRIMARY KEY (content_hash)
+);
+
 CREATE TABLE IF NOT EXISTS teacher (
   teacher_id TEXT PRIMARY KEY,
   name TEXT NOT NULL,
@@ -0,0 +1,215 @@
+#include <hc/aigc.h>
+
+#include <hc/extract.h>
+
+#include <algorithm>
+#include <format>
+#include <httplib.h>
+#include <ranges>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <tuple>
+
+namespace hc::aigc {
+
+std::optional<std::pair<std::string, std::string>>
+split_endpoint(std::string_view endpoint)
+{
+    if (!endpoint.starts_with("http://") && !endpoint.starts_with("https://")) {
+        return std::nullopt;
+    }
+    auto const host = endpoint.find("://") + 3;
+    auto const slash = endpoint.find('/', host);
+    if (slash == host) {
+        return std::nullopt;
+    }
+    if (slash == std::string_view::npos) {
+        return std::pair{std::string{endpoint}, std::string{"/"}};
+    }
+    return std::pair{std::string{endpoint.substr(0, slash)},
+                     std::string{endpoint.substr(slash)}};
+}
+
+Scorer::Scorer(ScorerOptions options, TextOf text_of, OnScored on_scored)
+    : options_{std::move(options)}, text_of_{std::move(text_of)},
+      on_scored_{std::move(on_scored)}
+{
+    auto split = split_endpoint(options_.endpoint);
+    if (!split) {
+        throw std::invalid_argument{
+            std::format("Bad scoring endpoint: '{}'", options_.endpoint)};
+    }
+    std::tie(base_, path_) = *std::move(split);
+    options_.max_batch = std::max(options_.max_batch, 1UZ);
+    thread_ = std::jthread{std::bind_front(&Scorer::run, this)};
+}
+
+Scorer::~Scorer()
+{
+    {
+        std::scoped_lock guard{mutex_};
+        queue_.clear();
+    }
+    thread_.request_stop();
+}
+
+bool Scorer::post(Job job)
+{
+    {
+        std::scoped_lock guard{mutex_};
+        if (pending_.contains(job.content_hash)) {
+            return true;
+        }
+        if (queue_.size() >= options_.max_queued) {
+            return false;
+        }
+        pending_.insert(job.content_hash);
+        queue_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void Scorer::drain()
+{
+    std::unique_lock guard{mutex_};
+    idle_.wait(guard, [this] { return pending_.empty(); });
+}
+
+void Scorer::run(std::stop_token const &stop)
+{
+    while (true) {
+        std::vector<Job> batch;
+        {
+            std::unique_lock guard{mutex_};
+            cv_.wait(guard, stop, [this] { return !queue_.empty(); });
+            // Others submitted around a deadline join the batch.
+            cv_.wait_for(guard, stop, options_.max_delay, [this] {
+                return queue_.size() >= options_.max_batch;
+            });
+            if (stop.stop_requested()) {
+                return;
+            }
+            while (!queue_.empty() && batch.size() != options_.max_batch) {
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+        }
+
+        std::vector<std::string> texts;
+        std::vector<std::string> done; // Hashes no longer pending
+        std::vector<Job> sent;
+        for (auto &job : batch) {
+            try {
+                auto text = text_of_(job);
+                if (text.empty()) {
+                    // Nothing to judge, e.g. an image. Left unscored.
+                    spdlog::debug("No text of '{}' to score", job.filename);
+                    done.push_back(std::move(job.content_hash));
+                    continue;
+                }
+                hc::extract::truncate_utf8(text, options_.max_text_size);
+                texts.push_back(std::move(text));
+                sent.push_back(std::move(job));
+            }
+            catch (std::exception const &e) {
+                spdlog::warn("Failed to get text of '{}' for scoring: {}",
+                             job.filename, e.what());
+                done.push_back(std::move(job.content_hash));
+            }
+        }
+
+        std::vector<double> scores;
+        auto const outcome =
+            texts.empty() ? Outcome::scored : request(texts, scores);
+        if (outcome == Outcome::retry) {
+            std::unique_lock guard{mutex_};
+            for (auto &job : sent | std::views::reverse) {
+                queue_.push_front(std::move(job));
+            }
+            std::ranges::for_each(done, [this](auto const &h) {
+                pending_.erase(h);
+            });
+            if (pending_.empty()) {
+                idle_.notify_all();
+            }
+            cv_.wait_for(guard, stop, options_.retry_delay,
+                         [] { return false; });
+            continue;
+        }
+
+        // Rejected ones are left unscored, as sending them again would be
+        // rejected again.
+        std::vector<Scored> results;
+        for (auto i = 0UZ; i != sent.size(); ++i) {
+            if (outcome == Outcome::scored) {
+                results.push_back({.content_hash{sent[i].content_hash},
+                                   .score = scores[i]});
+            }
+            done.push_back(std::move(sent[i].content_hash));
+        }
+        if (!results.empty()) {
+            try {
+                on_scored_(results);
+            }
+            catch (std::exception const &e) {
+                spdlog::error("Failed to take {} scores: {}", results.size(),
+                              e.what());
+            }
+        }
+
+        std::scoped_lock guard{mutex_};
+        for (auto const &h : done) {
+            pending_.erase(h);
+        }
+        if (pending_.empty()) {
+            idle_.notify_all();
+        }
+    }
+}
+
+Scorer::Outcome Scorer::request(std::vector<std::string> const &texts,
+                                std::vector<double> &scores)
+{
+    httplib::Client client{base_};
+    client.set_connection_timeout(options_.timeout);
+    client.set_read_timeout(options_.timeout);
+    auto const res = client.Post(path_, nlohmann::json{{"texts", texts}}.dump(),
+                                 "application/json");
+    if (!res) {
+        spdlog::warn("Scoring service {} is unreachable: {}",
+                     options_.endpoint, httplib::to_string(res.error()));
+        return Outcome::retry;
+    }
+    if (res->status >= httplib::StatusCode::InternalServerError_500) {
+        spdlog::warn("Scoring service responded {}: {}", res->status,
+                     res->body);
+        return Outcome::retry;
+    }
+    if (res->status != httplib::StatusCode::OK_200) {
+        spdlog::error("Scoring service rejected {} texts with {}: {}",
+                      texts.size(), res->status, res->body);
+        return Outcome::rejected;
+    }
+    try {
+        scores = nlohmann::json::parse(res->body)
+                     .at("scores")
+                     .get<std::vector<double>>();
+    }
+    catch (nlohmann::json::exception const &e) {
+        spdlog::error("Bad response of scoring service: {}", e.what());
+        return Outcome::rejected;
+    }
+    if (scores.size() != texts.size()) {
+        spdlog::error("Scoring service responded {} scores for {} texts",
+                      scores.size(), texts.size());
+        return Outcome::rejected;
+    }
+    for (auto &s : scores) {
+        s = std::clamp(s, 0.0, 1.0);
+    }
+    spdlog::debug("Scored {} texts", texts.size());
+    return Outcome::scored;
+}
+
+} // namespace hc::aigc
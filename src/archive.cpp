@@ -3,22 +3,82 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cerrno>
 #include <chrono>
+#include <cmath>
+#include <fcntl.h>
 #include <filesystem>
+#include <format>
 #include <fstream>
+#include <hc/io.h>
 #include <iostream>
+#include <locale.h>
 #include <spdlog/spdlog.h>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
 #include <utility>
 #include <vector>
 
 namespace hc::archive {
 
-// create_tar_zst: minimal implementationA
+CompressionProfile CompressionProfile::fast()
+{
+    return {.level = 1,
+            .threads = std::thread::hardware_concurrency(),
+            .long_window = 0};
+}
+
+CompressionProfile CompressionProfile::small()
+{
+    return {.level = 19,
+            .threads = std::thread::hardware_concurrency(),
+            .long_window = 27};
+}
+
+std::optional<CompressionProfile>
+CompressionProfile::from_name(std::string_view name)
+{
+    if (name == "default") {
+        return CompressionProfile{};
+    }
+    if (name == "fast") {
+        return fast();
+    }
+    if (name == "small") {
+        return small();
+    }
+    return std::nullopt;
+}
+
+void OArchive::set_compression(CompressionProfile const &profile)
+{
+    if (!set_filter_option("zstd", "compression-level",
+                           std::to_string(profile.level).c_str())) {
+        throw std::runtime_error{
+            std::format("Bad zstd compression level {}", profile.level)};
+    }
+    // The following are optimizations, depending on how libarchive and
+    // libzstd are built. So only warn if unsupported.
+    if (profile.threads > 0 &&
+        !set_filter_option("zstd", "threads",
+                           std::to_string(profile.threads).c_str())) {
+        spdlog::warn("zstd threads is unsupported, compressing with 1 thread");
+    }
+    if (profile.long_window > 0 &&
+        !set_filter_option("zstd", "long",
+                           std::to_string(profile.long_window).c_str())) {
+        spdlog::warn("zstd long distance matching is unsupported");
+    }
+}
+
+// create_tar_zst: minimal implementation
 // - supports only regular files, directories, and symlinks
 // - stores each input file under its filename (basename) in the archive
 // - does not attempt to preserve ownership/complex metadata
-void create_tar_zst(fs::path const &out_path, std::span<fs::path> const &paths)
+void create_tar_zst(fs::path const &out_path, std::span<fs::path> const &paths,
+                    CompressionProfile const &profile)
 {
     auto doesnt_exist = [](auto const &p) { return !fs::exists(p); };
     if (std::ranges::any_of(paths, doesnt_exist)) {
@@ -26,132 +86,372 @@ void create_tar_zst(fs::path const &out_path, std::span<fs::path> const &paths)
     }
 
     ArchiveWriter aw(out_path, ARCHIVE_FORMAT_TAR_PAX_RESTRICTED,
-                     {ARCHIVE_FILTER_ZSTD});
-    aw.imbue(std::locale("en_US.UTF-8"));
+                     std::vector{ARCHIVE_FILTER_ZSTD}, profile);
     for (auto const &p : paths) {
         // Add to root
         aw.add_path(p, p.filename().u8string());
     }
 }
 
-// extract_tar_zst: minimal implementation
-// - only extracts regular file entries
-// - writes files under dest_dir, preserving entry's pathname but sanitized
-// - does not restore ownership or complex metadata
-// bool extract_tar_zst(fs::path const &archive_path, fs::path const &dest_dir,
-//                      std::string &err)
-// {
-//     struct archive *a = archive_read_new();
-//     if (!a) {
-//         err = "archive_read_new failed";
-//         return false;
-//     }
-//
-//     // allow zstd filter and tar format
-//     archive_read_support_filter_by_name(a, "zstd");
-//     archive_read_support_format_tar(a);
-//
-//     std::string arc_s = path_to_u8string(archive_path);
-//     if (archive_read_open_filename(a, arc_s.c_str(), 10240) != ARCHIVE_OK) {
-//         err = archive_error_string(a);
-//         archive_read_free(a);
-//         return false;
-//     }
-//
-//     // ensure dest_dir exists
-//     std::error_code ec;
-//     if (!fs::exists(dest_dir, ec)) {
-//         if (!fs::create_directories(dest_dir, ec)) {
-//             err = "failed to create dest dir: " + ec.message();
-//             archive_read_close(a);
-//             archive_read_free(a);
-//             return false;
-//         }
-//     }
-//
-//     struct archive_entry *entry = nullptr;
-//     int r = ARCHIVE_OK;
-//     while ((r = archive_read_next_header(a, &entry)) == ARCHIVE_OK) {
-//         char const *pathname = archive_entry_pathname(entry);
-//         if (!pathname) {
-//             archive_read_data_skip(a);
-//             continue;
-//         }
-//
-//         // sanitize entry name
-//         std::string sanitized = sanitize_entry_name(pathname, err);
-//         if (sanitized.empty()) {
-//             // sanitize_entry_name sets err
-//             archive_read_close(a);
-//             archive_read_free(a);
-//             return false;
-//         }
-//
-//         // we only accept regular file entries
-//         int filetype = archive_entry_filetype(entry);
-//         if (filetype != AE_IFREG) {
-//             // skip non-regular entries
-//             archive_read_data_skip(a);
-//             continue;
-//         }
-//
-//         fs::path outp = dest_dir / fs::path(sanitized);
-//         // create parent directories
-//         std::error_code ec2;
-//         if (outp.has_parent_path())
-//             fs::create_directories(outp.parent_path(), ec2);
-//
-//         std::ofstream ofs(path_to_u8string(outp),
-//                           std::ios::binary | std::ios::trunc);
-//         if (!ofs) {
-//             err = "failed to create output file: " + path_to_u8string(outp);
-//             archive_read_close(a);
-//             archive_read_free(a);
-//             return false;
-//         }
-//
-//         // read data and write to file
-//         void const *buff;
-//         size_t size;
-//         la_int64_t offset;
-//         while ((r = archive_read_data_block(a, &buff, &size, &offset)) ==
-//                ARCHIVE_OK) {
-//             ofs.write(reinterpret_cast<char const *>(buff),
-//                       static_cast<std::streamsize>(size));
-//             if (!ofs) {
-//                 err = "write failed for output file: " +
-//                 path_to_u8string(outp); archive_read_close(a);
-//                 archive_read_free(a);
-//                 return false;
-//             }
-//         }
-//         if (r != ARCHIVE_EOF && r != ARCHIVE_OK) {
-//             err = archive_error_string(a);
-//             archive_read_close(a);
-//             archive_read_free(a);
-//             return false;
-//         }
-//         // finished entry; continue to next
-//     }
-//
-//     if (r != ARCHIVE_EOF) {
-//         err = archive_error_string(a);
-//         archive_read_close(a);
-//         archive_read_free(a);
-//         return false;
-//     }
-//
-//     archive_read_close(a);
-//     archive_read_free(a);
-//     return true;
-// }
+ArchiveStats create_tar_zst(fs::path const &out_path,
+                            std::span<ManifestEntry const> entries,
+                            CompressionProfile const &profile)
+{
+    ArchiveWriter aw(out_path, ARCHIVE_FORMAT_TAR_PAX_RESTRICTED,
+                     std::vector{ARCHIVE_FILTER_ZSTD}, profile);
+    aw.add_entries(entries);
+    aw.close();
+    return aw.stats();
+}
+
+ArchiveStats create_zip(fs::path const &out_path,
+                        std::span<ManifestEntry const> entries)
+{
+    ArchiveWriter aw(out_path, ARCHIVE_FORMAT_ZIP);
+    aw.add_entries(entries);
+    aw.close();
+    return aw.stats();
+}
+
+bool looks_incompressible(std::span<char const> head)
+{
+    using namespace std::string_view_literals;
+    static constexpr std::array magics{
+        "PK\x03\x04"sv,         // ZIP, DOCX, XLSX, PPTX, JAR
+        "%PDF"sv,               // PDF, whose streams are deflated
+        "\x1F\x8B"sv,           // gzip
+        "\x28\xB5\x2F\xFD"sv,   // zstd
+        "\xFD" "7zXZ"sv,        // xz
+        "BZh"sv,                // bzip2
+        "7z\xBC\xAF\x27\x1C"sv, // 7z
+        "Rar!"sv,               // RAR
+        "\x89PNG"sv,            // PNG
+        "\xFF\xD8\xFF"sv,       // JPEG
+        "GIF8"sv,               // GIF
+        "OggS"sv,               // Ogg
+    };
+    auto const sv = std::string_view{head.data(), head.size()};
+    auto const has_magic = [sv](auto magic) { return sv.starts_with(magic); };
+    if (std::ranges::any_of(magics, has_magic)) {
+        return true;
+    }
+
+    // Too little to judge, and cheap to compress anyway.
+    if (head.size() < 512) {
+        return false;
+    }
+
+    // Counting into interleaved tables keeps runs of equal bytes from
+    // serializing on one counter, and lets the loop vectorize.
+    std::array<std::array<std::uint32_t, 256>, 4> hist{};
+    auto const *p = reinterpret_cast<unsigned char const *>(head.data());
+    auto i = 0UZ;
+    for (; i + 4 <= head.size(); i += 4) {
+        ++hist[0][p[i]];
+        ++hist[1][p[i + 1]];
+        ++hist[2][p[i + 2]];
+        ++hist[3][p[i + 3]];
+    }
+    for (; i != head.size(); ++i) {
+        ++hist[0][p[i]];
+    }
+
+    auto const n = static_cast<double>(head.size());
+    auto entropy = 0.0;
+    for (auto b = 0UZ; b != 256; ++b) {
+        auto const count = hist[0][b] + hist[1][b] + hist[2][b] + hist[3][b];
+        if (count != 0) {
+            auto const prob = count / n;
+            entropy -= prob * std::log2(prob);
+        }
+    }
+    // Bits per byte. Random data is 8, while text is usually below 5.
+    return entropy > 7.5;
+}
+
+std::chrono::nanoseconds ArchiveStats::saved_time() const
+{
+    if (bytes_compressed == 0) {
+        return {};
+    }
+    auto const per_byte = static_cast<double>(compress_time.count()) /
+                          static_cast<double>(bytes_compressed);
+    auto const would_take = std::chrono::nanoseconds{static_cast<std::int64_t>(
+        per_byte * static_cast<double>(bytes_stored))};
+    return std::max(would_take - store_time, std::chrono::nanoseconds{});
+}
+
+namespace {
+
+// Switches the calling thread to a UTF-8 locale while alive. libarchive
+// converts names read from headers to the current locale, and fails for
+// non-ASCII ones under the C locale servers usually run with. Unlike
+// setlocale(), other threads are left alone.
+class Utf8ThreadLocale {
+  public:
+    Utf8ThreadLocale()
+    {
+        static locale_t const utf8 = [] {
+            auto *const loc = ::newlocale(LC_CTYPE_MASK, "C.UTF-8", locale_t{});
+            if (loc == locale_t{}) {
+                spdlog::warn("C.UTF-8 locale is unavailable, non-ASCII names "
+                             "in archives may be unreadable");
+            }
+            return loc;
+        }();
+        if (utf8 != locale_t{}) {
+            old_ = ::uselocale(utf8);
+        }
+    }
+
+    Utf8ThreadLocale(Utf8ThreadLocale const &) = delete;
+    Utf8ThreadLocale(Utf8ThreadLocale &&) = delete;
+    Utf8ThreadLocale &operator=(Utf8ThreadLocale const &) = delete;
+    Utf8ThreadLocale &operator=(Utf8ThreadLocale &&) = delete;
+
+    ~Utf8ThreadLocale()
+    {
+        if (old_ != locale_t{}) {
+            ::uselocale(old_);
+        }
+    }
+
+  private:
+    locale_t old_{};
+};
+
+// Holes of sparse entries are handed out from here.
+constexpr std::array<char, std::size_t{64} << 10> zeros{};
+
+} // namespace
+
+std::optional<std::u8string> sanitize_path(std::string_view name)
+{
+    std::u8string path;
+    auto first = true;
+    while (!name.empty()) {
+        auto const end = name.find_first_of("/\\");
+        auto const part = name.substr(0, end);
+        name.remove_prefix(end == std::string_view::npos ? name.size()
+                                                         : end + 1);
+        if (part.empty() || part == ".") {
+            continue;
+        }
+        // "C:" of Windows paths would be absolute when extracted there.
+        auto const drive = part.size() == 2 && part[1] == ':';
+        if (part == ".." || (first && drive)) {
+            return std::nullopt;
+        }
+        if (!first) {
+            path += u8'/';
+        }
+        path.append(part.begin(), part.end());
+        first = false;
+    }
+    if (path.empty()) {
+        return std::nullopt;
+    }
+    return path;
+}
+
+ArchiveReader::ArchiveReader(fs::path const &in, ReadLimits const &limits)
+    : limits_{limits}, fd_{in, O_RDONLY}, engine_{io::Engine::make()}
+{
+    struct stat st{};
+    if (::fstat(fd_.get(), &st) != 0) {
+        throw std::system_error{
+            errno, std::generic_category(),
+            std::format("Failed to stat '{}'", in.string())};
+    }
+    ::posix_fadvise(fd_.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+    source_ = std::make_unique<io::Reader>(
+        *engine_, fd_.get(), static_cast<std::uint64_t>(st.st_size));
+
+    archive_ = archive_read_new();
+    if (archive_ == nullptr) {
+        throw std::runtime_error{"Failed to create archive"};
+    }
+    archive_read_support_filter_all(archive_);
+    archive_read_support_format_tar(archive_);
+    archive_read_support_format_zip(archive_);
+    if (archive_read_open(archive_, this, nullptr, &ArchiveReader::read_source,
+                          nullptr) != ARCHIVE_OK) {
+        std::runtime_error const e{archive_error_string(archive_)};
+        archive_read_free(archive_);
+        throw e;
+    }
+}
+
+ArchiveReader::~ArchiveReader()
+{
+    archive_read_free(archive_);
+}
+
+la_ssize_t ArchiveReader::read_source(struct archive *a, void *self,
+                                      void const **buf)
+{
+    try {
+        auto const block = static_cast<ArchiveReader *>(self)->source_->next();
+        *buf = block.data();
+        return static_cast<la_ssize_t>(block.size());
+    }
+    catch (std::system_error const &e) {
+        archive_set_error(a, e.code().value(), "%s", e.what());
+        return -1;
+    }
+}
+
+std::optional<ReadEntry> ArchiveReader::next()
+{
+    block_ = {};
+    block_offset_ = 0;
+    entry_bytes_ = 0;
+    data_eof_ = false;
+
+    Utf8ThreadLocale const utf8;
+    struct archive_entry *e{};
+    auto const res = archive_read_next_header(archive_, &e);
+    if (res == ARCHIVE_EOF) {
+        return std::nullopt;
+    }
+    if (res < ARCHIVE_WARN) {
+        throw std::runtime_error{archive_error_string(archive_)};
+    }
+    if (++entries_ > limits_.max_entries) {
+        throw std::runtime_error{std::format(
+            "Archive has more than {} entries", limits_.max_entries)};
+    }
+
+    auto const *name = archive_entry_pathname(e);
+    if (name == nullptr) {
+        throw std::runtime_error{std::format(
+            "Entry {} has a name not in UTF-8: {}", entries_,
+            res == ARCHIVE_WARN ? archive_error_string(archive_) : "")};
+    }
+    auto path = sanitize_path(name);
+    if (!path) {
+        throw std::runtime_error{
+            std::format("Unsafe path in archive: '{}'", name)};
+    }
+
+    ReadEntry entry{.path = std::move(*path), .type = EntryType::other,
+                    .size = std::nullopt, .mtime = std::nullopt};
+    if (archive_entry_size_is_set(e) != 0) {
+        entry.size = static_cast<std::uint64_t>(archive_entry_size(e));
+        if (*entry.size > limits_.max_entry_size) {
+            throw std::runtime_error{
+                std::format("Entry '{}' is larger than {} bytes", name,
+                            limits_.max_entry_size)};
+        }
+    }
+    if (archive_entry_mtime_is_set(e) != 0) {
+        using namespace std::chrono;
+        entry.mtime = system_clock::time_point{
+            duration_cast<system_clock::duration>(
+                seconds{archive_entry_mtime(e)} +
+                nanoseconds{archive_entry_mtime_nsec(e)})};
+    }
+    // Hard links are only a name of another entry.
+    if (archive_entry_hardlink(e) == nullptr) {
+        switch (archive_entry_filetype(e)) {
+        case AE_IFREG:
+            entry.type = EntryType::regular;
+            break;
+        case AE_IFDIR:
+            entry.type = EntryType::directory;
+            break;
+        case AE_IFLNK:
+            entry.type = EntryType::symlink;
+            break;
+        default:
+            break;
+        }
+    }
+    return entry;
+}
+
+std::span<char const> ArchiveReader::read()
+{
+    if (block_.empty() && !data_eof_) {
+        void const *buf{};
+        std::size_t len{};
+        la_int64_t offset{};
+        auto const res = archive_read_data_block(archive_, &buf, &len, &offset);
+        if (res == ARCHIVE_EOF) {
+            data_eof_ = true;
+        }
+        else if (res != ARCHIVE_OK) {
+            throw std::runtime_error{archive_error_string(archive_)};
+        }
+        block_ = {static_cast<char const *>(buf), len};
+        block_offset_ = static_cast<std::uint64_t>(offset);
+    }
+
+    // Sparse entries skip holes, which read as zeros. A trailing hole shows
+    // up as the offset of the end.
+    if (block_offset_ > entry_bytes_) {
+        auto const hole = std::min<std::uint64_t>(block_offset_ - entry_bytes_,
+                                                  zeros.size());
+        return account(std::span{zeros}.first(hole));
+    }
+    block_offset_ += block_.size();
+    return account(std::exchange(block_, {}));
+}
+
+std::span<char const> ArchiveReader::account(std::span<char const> block)
+{
+    entry_bytes_ += block.size();
+    total_bytes_ += block.size();
+    if (entry_bytes_ > limits_.max_entry_size) {
+        throw std::runtime_error{std::format(
+            "Entry is larger than {} bytes", limits_.max_entry_size)};
+    }
+    if (total_bytes_ > limits_.max_total_size) {
+        throw std::runtime_error{std::format(
+            "Archive expands to more than {} bytes", limits_.max_total_size)};
+    }
+    return block;
+}
+
+std::size_t extract_tar_zst(fs::path const &archive_path,
+                            fs::path const &dest_dir, ReadLimits const &limits)
+{
+    ArchiveReader reader(archive_path, limits);
+    fs::create_directories(dest_dir);
+    auto &engine = io::Engine::local();
+    auto files = 0UZ;
+    while (auto const entry = reader.next()) {
+        auto const path = dest_dir / fs::path{entry->path};
+        switch (entry->type) {
+        case EntryType::directory:
+            fs::create_directories(path);
+            break;
+        case EntryType::regular: {
+            fs::create_directories(path.parent_path());
+            // Not following a symlink planted at the path beforehand.
+            io::UniqueFd const fd(path,
+                                  O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW);
+            io::Writer writer(engine, fd.get());
+            for (auto block = reader.read(); !block.empty();
+                 block = reader.read()) {
+                writer.write(block);
+            }
+            writer.finish();
+            ++files;
+            break;
+        }
+        default:
+            spdlog::debug(R"(Skipping entry "{}" of unsupported type)",
+                          reinterpret_cast<char const *>(entry->path.c_str()));
+            break;
+        }
+    }
+    return files;
+}
 
 void ArchiveWriter::add_path(fs::path const &disk_path,
                              std::u8string const &ar_path)
 {
-    // We should use C locale here because libarchive reads only from it.
-    auto *old = std::setlocale(LC_CTYPE, locale_.name().c_str());
-
     auto ftype = fs::symlink_status(disk_path).type();
     switch (ftype) {
     case std::filesystem::file_type::regular:
@@ -168,9 +468,107 @@ void ArchiveWriter::add_path(fs::path const &disk_path,
     default:
         throw std::runtime_error{"Unsupported file type"};
     }
+}
+
+void ArchiveWriter::add_entries(std::span<ManifestEntry const> entries,
+                                bool skip_missing)
+{
+    for (auto const &e : entries) {
+        if (write_manifest_entry(e)) {
+            continue;
+        }
+        if (!skip_missing) {
+            throw std::runtime_error{std::format(
+                "No such file or directory: '{}'", e.disk_path.string())};
+        }
+        spdlog::warn("Skipping missing file '{}'", e.disk_path.string());
+    }
+}
+
+bool ArchiveWriter::write_manifest_entry(ManifestEntry const &e)
+{
+    auto throw_errno = [&e](std::string_view what) {
+        throw std::system_error{
+            errno, std::generic_category(),
+            std::format("Failed to {} '{}'", what, e.disk_path.string())};
+    };
+
+    // One open and one fstat per file. Reading through the same descriptor
+    // also guarantees the metadata matches the content written.
+    auto const fd = ::open(e.disk_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return false;
+        }
+        throw_errno("open");
+    }
+    auto const closer = std::unique_ptr<int const, void (*)(int const *)>{
+        &fd, [](int const *p) { ::close(*p); }};
 
-    // Restore original locale as we just changed it.
-    std::setlocale(LC_CTYPE, old);
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        throw_errno("stat");
+    }
+    if (!S_ISREG(st.st_mode)) {
+        throw std::runtime_error{std::format("'{}' is not a regular file",
+                                             e.disk_path.string())};
+    }
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // Blocks are read ahead asynchronously while the current one is being
+    // compressed.
+    io::Reader reader(io::Engine::local(), fd,
+                      static_cast<std::uint64_t>(st.st_size));
+
+    // The first block decides how the entry is compressed, which must be
+    // known before its header is written.
+    auto const first = reader.next();
+    constexpr auto sample_size = std::size_t{64} << 10;
+    auto const store =
+        per_entry_compression_ &&
+        looks_incompressible(first.first(std::min(first.size(), sample_size)));
+    if (per_entry_compression_) {
+        auto *const a = oa_.get();
+        throw_on_error(store ? archive_write_zip_set_compression_store(a)
+                             : archive_write_zip_set_compression_deflate(a));
+    }
+
+    write_parent_directories(e.ar_path);
+    ArchiveEntry entry(st, e.ar_path);
+    spdlog::debug(R"(Writing entry "{}" as "{}"{})", e.disk_path.string(),
+                  entry.pathname(), store ? " (stored)" : "");
+    write_header(entry);
+
+    auto const start = std::chrono::steady_clock::now();
+    auto const total = write_data(reader, first);
+    auto const elapsed = std::chrono::steady_clock::now() - start;
+
+    ++stats_.entries;
+    if (store) {
+        ++stats_.stored_entries;
+        stats_.bytes_stored += total;
+        stats_.store_time += elapsed;
+    }
+    else {
+        stats_.bytes_compressed += total;
+        stats_.compress_time += elapsed;
+    }
+    return true;
+}
+
+void ArchiveWriter::write_parent_directories(std::u8string const &ar_path)
+{
+    for (auto pos = ar_path.find(u8'/'); pos != std::u8string::npos;
+         pos = ar_path.find(u8'/', pos + 1)) {
+        auto dir = ar_path.substr(0, pos);
+        if (dir.empty() || directories_.contains(dir)) {
+            continue;
+        }
+        auto entry = ArchiveEntry::directory(dir);
+        spdlog::debug(R"(Writing directory entry "{}")", entry.pathname());
+        write_header(entry);
+        directories_.insert(std::move(dir));
+    }
 }
 
 void ArchiveWriter::write_file(fs::path const &disk_path,
@@ -179,28 +577,28 @@ void ArchiveWriter::write_file(fs::path const &disk_path,
     ArchiveEntry entry(disk_path, ar_path);
     spdlog::debug(R"(Writing entry "{}" as "{}")", disk_path.string(),
                   entry.pathname());
-    throw_on_error(archive_write_header(oa_.get(), entry.get()));
+    write_header(entry);
     if (entry.size() > 0) {
-        std::ifstream ifs(disk_path, std::ios::binary);
-        if (!ifs.is_open()) {
-            throw std::runtime_error{
-                std::format("Failed to open '{}'", disk_path.string())};
-        }
-        constexpr auto buf_sz = 4U << 10;
-        std::array<char, buf_sz> buf{};
-        while (true) {
-            ifs.read(buf.data(), buf_sz);
-            auto const n = static_cast<std::size_t>(ifs.gcount());
-            if (n == 0) {
-                break;
-            }
-            auto const written = static_cast<std::size_t>(
-                archive_write_data(oa_.get(), buf.data(), n));
-            if (written != n) {
-                throw std::runtime_error{archive_error_string(oa_.get())};
-            }
+        io::UniqueFd const fd(disk_path, O_RDONLY);
+        io::Reader reader(io::Engine::local(), fd.get(),
+                          static_cast<std::uint64_t>(entry.size()));
+        write_data(reader, reader.next());
+    }
+}
+
+std::uint64_t ArchiveWriter::write_data(io::Reader &reader,
+                                        std::span<char const> first)
+{
+    auto total = std::uint64_t{};
+    for (auto block = first; !block.empty(); block = reader.next()) {
+        auto const written =
+            archive_write_data(oa_.get(), block.data(), block.size());
+        if (std::cmp_not_equal(written, block.size())) {
+            throw std::runtime_error{archive_error_string(oa_.get())};
         }
+        total += block.size();
     }
+    return total;
 }
 
 void ArchiveWriter::write_directory_recursive(fs::path disk_path,
@@ -214,7 +612,7 @@ void ArchiveWriter::write_directory_recursive(fs::path disk_path,
         ArchiveEntry entry(disk_path, ar_path);
         spdlog::debug(R"(Writing entry "{}" as "{}")", disk_path.string(),
                       entry.pathname());
-        throw_on_error(archive_write_header(oa_.get(), entry.get()));
+        write_header(entry);
     }
 
     auto const dir = fs::recursive_directory_iterator{disk_path};
@@ -229,7 +627,7 @@ void ArchiveWriter::write_directory_recursive(fs::path disk_path,
             ArchiveEntry entry(p, target_relative);
             spdlog::debug(R"(Writing entry "{}" as "{}")", p.string(),
                           entry.pathname());
-            throw_on_error(archive_write_header(oa_.get(), entry.get()));
+            write_header(entry);
         }
         else if (ent.is_symlink()) {
             write_symlink(p, target_relative);
@@ -243,10 +641,9 @@ void ArchiveWriter::write_symlink(fs::path const &disk_path,
     ArchiveEntry entry(disk_path, ar_path);
     spdlog::debug(R"(Writing entry "{}" as "{}")", disk_path.string(),
                   entry.pathname());
-    throw_on_error(archive_write_header(oa_.get(), entry.get()));
+    write_header(entry);
 }
 
-// version without utf8 doesn't corrupt. ??..
 ArchiveEntry::ArchiveEntry(fs::path const &disk_path,
                            std::u8string const &ar_path)
     : entry_{}
@@ -321,6 +718,45 @@ ArchiveEntry::ArchiveEntry(fs::path const &disk_path,
                             ns.count());
 }
 
+ArchiveEntry::ArchiveEntry() : entry_{archive_entry_new()}
+{
+    if (entry_ == nullptr) {
+        throw std::runtime_error{"Failed to create archive entry"};
+    }
+}
+
+ArchiveEntry::ArchiveEntry(struct stat const &st, std::u8string const &ar_path)
+    : ArchiveEntry()
+{
+    // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+    archive_entry_set_filetype(entry_, AE_IFREG);
+    archive_entry_set_pathname(entry_,
+                               reinterpret_cast<char const *>(ar_path.c_str()));
+    // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+    archive_entry_set_size(entry_, static_cast<la_int64_t>(st.st_size));
+    archive_entry_set_perm(entry_, static_cast<ModeType>(st.st_mode) & 07777U);
+    archive_entry_set_mtime(entry_, st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+}
+
+ArchiveEntry ArchiveEntry::directory(std::u8string const &ar_path)
+{
+    ArchiveEntry e;
+    auto p = ar_path;
+    if (!p.ends_with('/')) {
+        p += '/';
+    }
+    archive_entry_set_filetype(e.entry_, AE_IFDIR);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    archive_entry_set_pathname(e.entry_,
+                               reinterpret_cast<char const *>(p.c_str()));
+    archive_entry_set_size(e.entry_, 0);
+    archive_entry_set_perm(e.entry_, 0755);
+    auto const now = std::chrono::system_clock::to_time_t(
+        std::chrono::system_clock::now());
+    archive_entry_set_mtime(e.entry_, now, 0);
+    return e;
+}
+
 ArchiveEntry::ArchiveEntry(ArchiveEntry &&other) noexcept : entry_(other.entry_)
 {
     other.entry_ = nullptr;
@@ -368,12 +804,63 @@ void ArchiveWriter::throw_on_error(int res)
 
 [[nodiscard]] std::string_view ArchiveEntry::pathname() const
 {
-    return archive_entry_pathname(entry_);
+    // Whichever form is set is returned without conversion.
+    auto const *p = archive_entry_pathname(entry_);
+    if (p == nullptr) {
+        p = archive_entry_pathname_utf8(entry_);
+    }
+    return p == nullptr ? std::string_view{} : p;
+}
+
+void ArchiveEntry::mark_utf8()
+{
+    // Getting the raw forms set by constructors involves no conversion.
+    if (auto const *p = archive_entry_pathname(entry_); p != nullptr) {
+        std::string const pathname{p};
+        archive_entry_set_pathname_utf8(entry_, pathname.c_str());
+    }
+    if (auto const *symlink = archive_entry_symlink(entry_);
+        symlink != nullptr) {
+        std::string const target{symlink};
+        archive_entry_set_symlink_utf8(entry_, target.c_str());
+    }
+}
+
+void ArchiveWriter::set_charset(int format)
+{
+    // Names are handed to libarchive as UTF-8 bytes. Left alone, libarchive
+    // converts them with the global locale, which is process-wide state and
+    // fails for non-ASCII under C locale. Instead, they're written without
+    // conversion, so that exports can run in parallel regardless of locale.
+    switch (format) {
+    case ARCHIVE_FORMAT_TAR_PAX_INTERCHANGE:
+    case ARCHIVE_FORMAT_TAR_PAX_RESTRICTED:
+        // Raw bytes, the same as UTF-8 ones on extraction.
+        oa_.set_format_option("pax", "hdrcharset", "BINARY");
+        break;
+    case ARCHIVE_FORMAT_ZIP:
+        // ZIP flags UTF-8 names, which needs them given as UTF-8.
+        oa_.set_format_option("zip", "hdrcharset", "UTF-8");
+        utf8_names_ = true;
+        break;
+    default: // Others write raw bytes without being told
+        break;
+    }
 }
 
-std::locale ArchiveWriter::imbue(std::locale const &l)
+void ArchiveWriter::write_header(ArchiveEntry &entry)
 {
-    return std::exchange(locale_, l);
+    if (utf8_names_) {
+        entry.mark_utf8();
+    }
+    throw_on_error(archive_write_header(oa_.get(), entry.get()));
+}
+
+void ArchiveWriter::close()
+{
+    if (!oa_.close()) {
+        throw std::runtime_error{archive_error_string(oa_.get())};
+    }
 }
 
 } // namespace hc::archive
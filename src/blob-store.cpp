@@ -0,0 +1,139 @@
+#include <hc/blob-store.h>
+
+#include <boost/uuid.hpp>
+#include <fcntl.h>
+#include <spdlog/spdlog.h>
+
+namespace hc {
+
+namespace fs = std::filesystem;
+
+BlobStore::BlobStore(fs::path root) : root_{std::move(root)}
+{
+    fs::create_directories(root_ / "tmp");
+}
+
+BlobStore::Writer::Writer(BlobStore &store)
+    : store_{store},
+      tmp_{store.root_ / "tmp" /
+           boost::uuids::to_string(boost::uuids::random_generator{}())},
+      fd_{tmp_, O_WRONLY | O_CREAT | O_TRUNC},
+      writer_{io::Engine::local(), fd_.get()}
+{
+}
+
+BlobStore::Writer::~Writer()
+{
+    if (!committed_) {
+        std::error_code ec;
+        fs::remove(tmp_, ec);
+    }
+}
+
+void BlobStore::Writer::write(std::span<char const> data)
+{
+    // Hashing goes on while previous buffers are being written.
+    writer_.write(data);
+    sha_.update(data);
+}
+
+std::string BlobStore::Writer::commit()
+{
+    writer_.finish();
+    auto hash = store_.adopt(tmp_, sha_.hex_digest());
+    committed_ = true;
+    return hash;
+}
+
+std::string BlobStore::put(std::span<char const> data)
+{
+    Writer w(*this);
+    w.write(data);
+    return w.commit();
+}
+
+fs::path BlobStore::path(std::string_view hash) const
+{
+    return root_ / hash.substr(0, 2) / hash;
+}
+
+std::string BlobStore::adopt(fs::path const &tmp, std::string const &hash)
+{
+    auto const dest = path(hash);
+    std::scoped_lock guard{mutex_};
+    if (fs::exists(dest)) {
+        // Stored already. Touched so that `collect_garbage()` of another
+        // process doesn't take it as left over.
+        fs::remove(tmp);
+        fs::last_write_time(dest, fs::file_time_type::clock::now());
+        spdlog::debug("Deduplicated blob {}", hash);
+    }
+    else {
+        fs::create_directories(dest.parent_path());
+        fs::rename(tmp, dest);
+    }
+    ++references_[hash];
+    return hash;
+}
+
+void BlobStore::retain(std::string const &hash)
+{
+    std::scoped_lock guard{mutex_};
+    ++references_[hash];
+}
+
+void BlobStore::release(std::string const &hash)
+{
+    std::scoped_lock guard{mutex_};
+    auto const it = references_.find(hash);
+    if (it == references_.end()) {
+        spdlog::warn("Releasing blob {} without references", hash);
+        return;
+    }
+    if (--it->second != 0) {
+        return;
+    }
+    references_.erase(it);
+    std::error_code ec;
+    fs::remove(path(hash), ec);
+    if (ec) {
+        spdlog::warn("Failed to remove blob {}: {}", hash, ec.message());
+    }
+}
+
+std::size_t BlobStore::references(std::string const &hash) const
+{
+    std::scoped_lock guard{mutex_};
+    auto const it = references_.find(hash);
+    return it == references_.end() ? 0 : it->second;
+}
+
+std::size_t BlobStore::collect_garbage(std::chrono::seconds min_age)
+{
+    auto const deadline = fs::file_time_type::clock::now() - min_age;
+    auto removed = 0UZ;
+    std::scoped_lock guard{mutex_};
+    for (auto const &dir : fs::directory_iterator{root_}) {
+        if (!dir.is_directory()) {
+            continue;
+        }
+        auto const tmp = dir.path().filename() == "tmp";
+        for (auto const &file : fs::directory_iterator{dir.path()}) {
+            auto const name = file.path().filename().string();
+            if (file.last_write_time() >= deadline ||
+                (!tmp && references_.contains(name))) {
+                continue;
+            }
+            std::error_code ec;
+            if (fs::remove(file.path(), ec)) {
+                ++removed;
+            }
+        }
+    }
+    if (removed != 0) {
+        spdlog::info("Removed {} unreferenced blobs", removed);
+    }
+    return removed;
+}
+
+} // namespace hc
@@ -0,0 +1,156 @@
+#include <hc/connection-pool.h>
+
+#include <algorithm>
+#include <format>
+#include <spdlog/spdlog.h>
+
+namespace hc::db {
+
+using SteadyClock = std::chrono::steady_clock;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+ConnectionPool::ConnectionPool(Config config, std::size_t capacity,
+                               std::chrono::milliseconds acquire_timeout,
+                               std::chrono::milliseconds probe_after)
+    : config_{std::move(config)}, capacity_{std::max(capacity, 1UZ)},
+      acquire_timeout_{acquire_timeout}, probe_after_{probe_after}
+{
+    idle_.reserve(capacity_);
+    idle_.push_back({.conn = connect(), .since = SteadyClock::now()});
+    open_ = 1;
+}
+
+ConnectionPool::Handle ConnectionPool::acquire()
+{
+    auto const start = SteadyClock::now();
+    auto account = [&] {
+        auto const us = static_cast<std::uint64_t>(
+            duration_cast<microseconds>(SteadyClock::now() - start).count());
+        checkouts_.fetch_add(1, std::memory_order_relaxed);
+        total_checkout_us_.fetch_add(us, std::memory_order_relaxed);
+    };
+
+    std::unique_lock guard{mutex_};
+    if (idle_.empty() && open_ == capacity_) {
+        waits_.fetch_add(1, std::memory_order_relaxed);
+        auto const available = cv_.wait_for(guard, acquire_timeout_, [this] {
+            return !idle_.empty() || open_ < capacity_;
+        });
+        auto const us = static_cast<std::uint64_t>(
+            duration_cast<microseconds>(SteadyClock::now() - start).count());
+        total_wait_us_.fetch_add(us, std::memory_order_relaxed);
+        auto old = max_wait_us_.load(std::memory_order_relaxed);
+        while (old < us && !max_wait_us_.compare_exchange_weak(
+                               old, us, std::memory_order_relaxed)) {
+        }
+        if (!available) {
+            timeouts_.fetch_add(1, std::memory_order_relaxed);
+            throw std::runtime_error{std::format(
+                "Timed out after {} waiting for a database connection",
+                acquire_timeout_)};
+        }
+    }
+
+    // Health check. Broken connections are dropped, and their slots are
+    // refilled below. The most recently used one is taken first, as it's the
+    // least likely to need a probe.
+    while (!idle_.empty()) {
+        auto idle = std::move(idle_.back());
+        idle_.pop_back();
+        if (healthy(idle, guard)) {
+            account();
+            return Handle{this, std::move(idle.conn)};
+        }
+        spdlog::warn("Dropping broken database connection");
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        --open_;
+    }
+
+    // Connects without holding the lock, as it's a network round trip.
+    ++open_;
+    guard.unlock();
+    try {
+        auto conn = connect();
+        account();
+        return Handle{this, std::move(conn)};
+    }
+    catch (...) {
+        guard.lock();
+        --open_;
+        cv_.notify_one();
+        throw;
+    }
+}
+
+void ConnectionPool::release(std::unique_ptr<Connection> conn,
+                             bool failed) noexcept
+{
+    std::scoped_lock guard{mutex_};
+    // A statement failed while the handle was held. If that broke the
+    // connection, it's discarded so the next checkout reconnects.
+    if (failed && !conn->is_connected()) {
+        spdlog::warn("Database connection lost, will reconnect on demand");
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        --open_;
+    }
+    else {
+        idle_.push_back({.conn = std::move(conn), .since = SteadyClock::now()});
+    }
+    cv_.notify_one();
+}
+
+bool ConnectionPool::healthy(Idle const &idle,
+                             std::unique_lock<std::mutex> &guard)
+{
+    if (!idle.conn->is_connected()) {
+        return false;
+    }
+    if (SteadyClock::now() - idle.since < probe_after_) {
+        return true;
+    }
+    // Still counted in `open_`, so nobody takes its slot meanwhile.
+    guard.unlock();
+    probes_.fetch_add(1, std::memory_order_relaxed);
+    auto ok = true;
+    try {
+        idle.conn->execute("SELECT 1");
+    }
+    catch (std::exception const &e) {
+        spdlog::debug("Probing idle database connection failed: {}",
+                      e.what());
+        ok = false;
+    }
+    guard.lock();
+    return ok;
+}
+
+std::unique_ptr<ConnectionPool::Connection> ConnectionPool::connect()
+{
+    auto conn = std::make_unique<Connection>(config_);
+    if (!conn->is_connected()) {
+        throw std::runtime_error{"Failed to connect to server"};
+    }
+    return conn;
+}
+
+PoolStats ConnectionPool::stats() const
+{
+    std::scoped_lock guard{mutex_};
+    return PoolStats{
+        .capacity = capacity_,
+        .open = open_,
+        .idle = idle_.size(),
+        .checkouts = checkouts_.load(std::memory_order_relaxed),
+        .waits = waits_.load(std::memory_order_relaxed),
+        .timeouts = timeouts_.load(std::memory_order_relaxed),
+        .dropped = dropped_.load(std::memory_order_relaxed),
+        .probes = probes_.load(std::memory_order_relaxed),
+        .total_wait_us = total_wait_us_.load(std::memory_order_relaxed),
+        .max_wait_us = max_wait_us_.load(std::memory_order_relaxed),
+        .total_checkout_us =
+            total_checkout_us_.load(std::memory_order_relaxed),
+    };
+}
+
+} // namespace hc::db
@@ -0,0 +1,197 @@
+#include <hc/export-cache.h>
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+namespace hc {
+
+using namespace std::chrono_literals;
+
+namespace {
+
+bool is_ready(std::shared_future<std::filesystem::path> const &f)
+{
+    return f.wait_for(0s) == std::future_status::ready;
+}
+
+} // namespace
+
+ExportCache::ExportCache(std::size_t builders,
+                         std::function<void(Path)> on_evict)
+    : on_evict_{std::move(on_evict)}
+{
+    builders = std::max(builders, 1UZ);
+    builders_.reserve(builders);
+    for (auto i = 0UZ; i != builders; ++i) {
+        builders_.emplace_back(std::bind_front(&ExportCache::run, this));
+    }
+}
+
+ExportCache::~ExportCache()
+{
+    cancel_all();
+}
+
+ExportCache::Path ExportCache::get_or_build(std::string const &key,
+                                            std::uint64_t revision,
+                                            Build const &build,
+                                            Waiting const &waiting)
+{
+    std::shared_ptr<Flight> flight;
+    std::shared_ptr<Flight> old;
+    {
+        std::scoped_lock guard{mutex_};
+        auto &slot = slots_[key];
+        // A newer revision is as good, it's what the assignment is now. One
+        // being cancelled isn't, as it's going to fail.
+        if (slot != nullptr && slot->revision >= revision &&
+            (is_ready(slot->blob) || !slot->stop.stop_requested())) {
+            flight = slot;
+            ++flight->waiters;
+        }
+        else {
+            flight = std::make_shared<Flight>();
+            flight->revision = revision;
+            flight->waiters = 1;
+            Pending pending{.key = key, .flight = flight, .build = build};
+            flight->blob = pending.promise.get_future().share();
+            // Blobs of older revisions aren't useful anymore. One still
+            // building evicts its own once it's done, so that it isn't waited
+            // for here.
+            if (slot != nullptr && is_ready(slot->blob)) {
+                old = slot;
+            }
+            else if (slot != nullptr) {
+                slot->superseded = true;
+            }
+            slot = flight;
+            building_.insert(flight.get());
+            queue_.push_back(std::move(pending));
+            work_.notify_one();
+        }
+    }
+    if (old != nullptr) {
+        evict(*old);
+    }
+
+    auto path = wait(*flight, waiting);
+    if (std::filesystem::exists(path)) {
+        spdlog::debug("Export cache hit: {}@{}", key, flight->revision);
+        return path;
+    }
+
+    // Removed from disk behind our back, so it's built again.
+    {
+        std::scoped_lock guard{mutex_};
+        if (auto const it = slots_.find(key);
+            it != slots_.end() && it->second == flight) {
+            slots_.erase(it);
+        }
+    }
+    return get_or_build(key, revision, build, waiting);
+}
+
+void ExportCache::cancel_all()
+{
+    std::unique_lock guard{mutex_};
+    for (auto *flight : building_) {
+        flight->stop.request_stop();
+    }
+    idle_.wait(guard, [this] { return building_.empty(); });
+}
+
+void ExportCache::clear()
+{
+    std::scoped_lock guard{mutex_};
+    slots_.clear();
+}
+
+ExportCache::Path ExportCache::wait(Flight &flight, Waiting const &waiting)
+{
+    // However the waiter stops waiting. The last one leaving an unfinished
+    // build cancels it.
+    auto const leave = [&] {
+        std::scoped_lock guard{mutex_};
+        if (--flight.waiters == 0 && !is_ready(flight.blob)) {
+            flight.stop.request_stop();
+        }
+    };
+    try {
+        while (flight.blob.wait_for(100ms) != std::future_status::ready) {
+            waiting(flight.progress.load());
+        }
+    }
+    catch (...) {
+        leave();
+        throw;
+    }
+    leave();
+    return flight.blob.get();
+}
+
+void ExportCache::run(std::stop_token const &stop)
+{
+    while (true) {
+        Pending pending;
+        {
+            std::unique_lock guard{mutex_};
+            if (!work_.wait(guard, stop, [this] { return !queue_.empty(); })) {
+                return;
+            }
+            pending = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        build(pending);
+    }
+}
+
+void ExportCache::build(Pending &pending)
+{
+    auto const &flight = pending.flight;
+    std::unique_lock guard{mutex_, std::defer_lock};
+    try {
+        // Nobody waits for it anymore, since it was queued.
+        if (flight->stop.stop_requested()) {
+            throw hc::jobs::Cancelled{};
+        }
+        hc::jobs::Context context{flight->stop.get_token(), flight->progress};
+        auto path = pending.build(context);
+        spdlog::debug("Export cache filled: {}@{}", pending.key,
+                      flight->revision);
+        // Under the lock, so that either this or the request replacing it
+        // evicts it.
+        guard.lock();
+        pending.promise.set_value(std::move(path));
+    }
+    catch (...) {
+        // Forgotten before waiters see the exception, so that the next call
+        // builds again.
+        if (!guard.owns_lock()) {
+            guard.lock();
+        }
+        if (auto const it = slots_.find(pending.key);
+            it != slots_.end() && it->second == flight) {
+            slots_.erase(it);
+        }
+        pending.promise.set_exception(std::current_exception());
+    }
+
+    if (flight->superseded) {
+        guard.unlock();
+        evict(*flight);
+        guard.lock();
+    }
+    building_.erase(flight.get());
+    idle_.notify_all();
+}
+
+void ExportCache::evict(Flight const &flight)
+{
+    try {
+        on_evict_(flight.blob.get());
+    }
+    catch (std::exception const &) { // Its build failed, nothing to evict
+    }
+}
+
+} // namespace hc
@@ -0,0 +1,631 @@
+#include <hc/extract.h>
+
+#include <hc/io.h>
+
+#include <algorithm>
+#include <array>
+#include <boost/uuid.hpp>
+#include <cstdlib>
+#include <fcntl.h>
+#include <format>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <system_error>
+
+namespace hc::extract {
+
+namespace {
+
+constexpr char32_t replacement = 0xFFFD;
+
+std::string lower(std::string_view s)
+{
+    std::string r{s};
+    std::ranges::transform(r, r.begin(), [](unsigned char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a')
+                                    : static_cast<char>(c);
+    });
+    return r;
+}
+
+bool starts_with(std::span<char const> head, std::string_view magic)
+{
+    return head.size() >= magic.size() &&
+           std::string_view{head.data(), magic.size()} == magic;
+}
+
+// Decodes the code point at `i` of `s`, advancing `i`. Invalid sequences
+// decode as U+FFFD, one byte at a time.
+char32_t decode_utf8(std::string_view s, std::size_t &i) noexcept
+{
+    auto const c = static_cast<unsigned char>(s[i++]);
+    if (c < 0x80) {
+        return c;
+    }
+    auto len = 0UZ;
+    char32_t cp{};
+    if ((c & 0xE0) == 0xC0) {
+        len = 1;
+        cp = c & 0x1F;
+    }
+    else if ((c & 0xF0) == 0xE0) {
+        len = 2;
+        cp = c & 0x0F;
+    }
+    else if ((c & 0xF8) == 0xF0) {
+        len = 3;
+        cp = c & 0x07;
+    }
+    else {
+        return replacement;
+    }
+    if (i + len > s.size()) {
+        return replacement;
+    }
+    for (auto j = 0UZ; j != len; ++j) {
+        auto const cc = static_cast<unsigned char>(s[i + j]);
+        if ((cc & 0xC0) != 0x80) {
+            return replacement;
+        }
+        cp = (cp << 6) | (cc & 0x3F);
+    }
+    // Overlong forms, surrogates and beyond Unicode.
+    constexpr std::array<char32_t, 4> min{0, 0x80, 0x800, 0x10000};
+    if (cp < min[len] || (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) {
+        return replacement;
+    }
+    i += len;
+    return cp;
+}
+
+void append_utf8(std::string &out, char32_t cp)
+{
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    }
+    else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+bool is_blank(char32_t cp) noexcept
+{
+    // Besides ASCII ones, no-break, ideographic and typographic spaces.
+    return cp == U' ' || cp == U'\t' || cp == U'\v' || cp == U'\f' ||
+           cp == 0xA0 || cp == 0x3000 || (cp >= 0x2000 && cp <= 0x200A);
+}
+
+bool is_control(char32_t cp) noexcept
+{
+    // BOM and zero width no-break space included.
+    return cp < 0x20 || cp == 0x7F || (cp >= 0x80 && cp < 0xA0) ||
+           cp == 0xFEFF;
+}
+
+// Decodes the entity beginning at `s[i]`, which is '&', advancing `i` past
+// it. Unknown entities are kept verbatim.
+void append_entity(std::string_view s, std::size_t &i, std::string &out)
+{
+    auto const end = s.find(';', i);
+    if (end == std::string_view::npos || end - i > 10) {
+        out += s[i++];
+        return;
+    }
+    auto const name = s.substr(i + 1, end - i - 1);
+    i = end + 1;
+    if (name == "amp") {
+        out += '&';
+    }
+    else if (name == "lt") {
+        out += '<';
+    }
+    else if (name == "gt") {
+        out += '>';
+    }
+    else if (name == "quot") {
+        out += '"';
+    }
+    else if (name == "apos") {
+        out += '\'';
+    }
+    else if (name.starts_with("#x") || name.starts_with("#X")) {
+        append_utf8(out, static_cast<char32_t>(std::strtoul(
+                             std::string{name.substr(2)}.c_str(), nullptr, 16)));
+    }
+    else if (name.starts_with('#')) {
+        append_utf8(out, static_cast<char32_t>(std::strtoul(
+                             std::string{name.substr(1)}.c_str(), nullptr, 10)));
+    }
+    else {
+        out += std::format("&{};", name);
+    }
+}
+
+// Text of WordprocessingML: contents of elements, with paragraphs, breaks
+// and tabs kept as such.
+void wordprocessing_text(std::string_view xml, std::size_t max_size,
+                         std::string &out)
+{
+    auto i = 0UZ;
+    while (i < xml.size() && out.size() < max_size) {
+        if (xml[i] == '&') {
+            append_entity(xml, i, out);
+            continue;
+        }
+        if (xml[i] != '<') {
+            out += xml[i++];
+            continue;
+        }
+        auto const end = xml.find('>', i);
+        if (end == std::string_view::npos) {
+            break;
+        }
+        auto const tag = xml.substr(i + 1, end - i - 1);
+        auto const name = tag.substr(0, tag.find_first_of(" /", 1));
+        if (name == "/w:p" || name == "w:br" || name == "w:cr") {
+            out += '\n';
+        }
+        else if (name == "w:tab") {
+            out += '\t';
+        }
+        i = end + 1;
+    }
+}
+
+// Removes a directory tree when it goes out of scope.
+class TmpDir {
+  public:
+    explicit TmpDir(fs::path const &parent)
+        : path_{parent /
+                boost::uuids::to_string(boost::uuids::random_generator{}())}
+    {
+        fs::create_directories(path_);
+    }
+
+    TmpDir(TmpDir const &) = delete;
+    TmpDir(TmpDir &&) = delete;
+    TmpDir &operator=(TmpDir const &) = delete;
+    TmpDir &operator=(TmpDir &&) = delete;
+
+    ~TmpDir()
+    {
+        std::error_code ec;
+        fs::remove_all(path_, ec);
+    }
+
+    [[nodiscard]] fs::path const &path() const noexcept
+    {
+        return path_;
+    }
+
+  private:
+    fs::path path_;
+};
+
+class DocxExtractor final : public Extractor {
+  public:
+    [[nodiscard]] std::string_view name() const override
+    {
+        return "docx";
+    }
+
+    [[nodiscard]] bool accepts(std::string_view extension,
+                               std::span<char const> head) const override
+    {
+        return extension == ".docx" && starts_with(head, "PK");
+    }
+
+    void extract(fs::path const &path, Pipeline const &pipeline,
+                 std::size_t /*depth*/, std::string &out) const override
+    {
+        hc::archive::ArchiveReader reader{path, pipeline.limits().archive};
+        for (auto e = reader.next(); e; e = reader.next()) {
+            if (e->path != u8"word/document.xml") {
+                continue;
+            }
+            std::string xml;
+            for (auto b = reader.read(); !b.empty(); b = reader.read()) {
+                xml.append(b.data(), b.size());
+            }
+            wordprocessing_text(xml, pipeline.limits().max_text_size, out);
+            return;
+        }
+        throw std::runtime_error{"DOCX without word/document.xml"};
+    }
+};
+
+class ContainerExtractor final : public Extractor {
+  public:
+    [[nodiscard]] std::string_view name() const override
+    {
+        return "container";
+    }
+
+    [[nodiscard]] bool accepts(std::string_view extension,
+                               std::span<char const> head) const override
+    {
+        static constexpr std::array<std::string_view, 6> extensions{
+            ".zip", ".tar", ".zst", ".gz", ".tgz", ".xz"};
+        return std::ranges::find(extensions, extension) != extensions.end() ||
+               starts_with(head, "PK\x03\x04");
+    }
+
+    void extract(fs::path const &path, Pipeline const &pipeline,
+                 std::size_t depth, std::string &out) const override
+    {
+        if (depth >= pipeline.limits().max_depth) {
+            spdlog::debug("Skipped '{}' nested too deep", path.string());
+            return;
+        }
+        TmpDir const dir{pipeline.tmp_dir()};
+        hc::archive::extract_tar_zst(path, dir.path(),
+                                     pipeline.limits().archive);
+        std::vector<fs::path> files;
+        for (auto const &e : fs::recursive_directory_iterator{dir.path()}) {
+            if (e.is_regular_file()) {
+                files.push_back(e.path());
+            }
+        }
+        // In a stable order, whatever the archive's is.
+        std::ranges::sort(files);
+        for (auto const &file : files) {
+            if (out.size() >= pipeline.limits().max_text_size) {
+                break;
+            }
+            try {
+                out += "\n\n";
+                pipeline.extract_into(file, file.filename().string(),
+                                      depth + 1, out);
+            }
+            catch (UnsupportedFormat const &) {
+                // Images and such within, which have no text.
+            }
+        }
+    }
+};
+
+class PlainTextExtractor final : public Extractor {
+  public:
+    [[nodiscard]] std::string_view name() const override
+    {
+        return "text";
+    }
+
+    // Anything without NUL bytes and magic numbers of binary formats.
+    [[nodiscard]] bool accepts(std::string_view /*extension*/,
+                               std::span<char const> head) const override
+    {
+        static constexpr std::array<std::string_view, 5> binary{
+            "%PDF", "PK", "\x89PNG", "GIF8", "\xFF\xD8\xFF"};
+        return std::ranges::none_of(
+                   binary, [&](auto m) { return starts_with(head, m); }) &&
+               std::ranges::find(head, '\0') == head.end();
+    }
+
+    void extract(fs::path const &path, Pipeline const &pipeline,
+                 std::size_t /*depth*/, std::string &out) const override
+    {
+        auto const max_size = pipeline.limits().max_text_size;
+        hc::io::UniqueFd const fd(path, O_RDONLY);
+        hc::io::Reader reader(hc::io::Engine::local(), fd.get(),
+                              fs::file_size(path));
+        for (auto b = reader.next(); !b.empty() && out.size() < max_size;
+             b = reader.next()) {
+            out.append(b.data(), std::min(b.size(), max_size - out.size()));
+        }
+    }
+};
+
+} // namespace
+
+std::string normalize(std::string_view text)
+{
+    std::string out;
+    out.reserve(text.size());
+    auto space = false;
+    auto newlines = 0UZ;
+    for (auto i = 0UZ; i < text.size();) {
+        auto const cp = decode_utf8(text, i);
+        if (cp == U'\r' || cp == U'\n') {
+            if (cp == U'\r' && i < text.size() && text[i] == '\n') {
+                ++i;
+            }
+            ++newlines;
+            space = false;
+            continue;
+        }
+        if (is_blank(cp)) {
+            space = true;
+            continue;
+        }
+        if (is_control(cp)) {
+            continue;
+        }
+        // Separators are written before what they separate, so that
+        // neither trailing blanks nor leading ones are.
+        if (!out.empty()) {
+            if (newlines != 0) {
+                out.append(std::min(newlines, 2UZ), '\n');
+            }
+            else if (space) {
+                out += ' ';
+            }
+        }
+        space = false;
+        newlines = 0;
+        append_utf8(out, cp);
+    }
+    return out;
+}
+
+void truncate_utf8(std::string &s, std::size_t size)
+{
+    if (s.size() <= size) {
+        return;
+    }
+    while (size != 0 && (static_cast<unsigned char>(s[size]) & 0xC0) == 0x80) {
+        --size;
+    }
+    s.resize(size);
+}
+
+Pipeline::Pipeline(fs::path tmp_dir, Limits const &limits)
+    : tmp_dir_{std::move(tmp_dir)}, limits_{limits}
+{
+    fs::create_directories(tmp_dir_);
+}
+
+Pipeline Pipeline::with_defaults(fs::path tmp_dir, Limits const &limits)
+{
+    Pipeline p{std::move(tmp_dir), limits};
+    p.add(std::make_unique<DocxExtractor>());
+    p.add(std::make_unique<ContainerExtractor>());
+    p.add(std::make_unique<PlainTextExtractor>());
+    return p;
+}
+
+void Pipeline::add(std::unique_ptr<Extractor> extractor)
+{
+    extractors_.push_back(std::move(extractor));
+}
+
+std::string Pipeline::extract(fs::path const &path,
+                              std::string_view filename) const
+{
+    std::string raw;
+    extract_into(path, filename, 0, raw);
+    auto text = normalize(raw);
+    truncate_utf8(text, limits_.max_text_size);
+    return text;
+}
+
+void Pipeline::extract_into(fs::path const &path, std::string_view filename,
+                            std::size_t depth, std::string &out) const
+{
+    std::array<char, 512> buf{};
+    std::ifstream in{path, std::ios::binary};
+    if (!in) {
+        throw std::system_error{
+            errno, std::generic_category(),
+            std::format("Failed to open '{}'", path.string())};
+    }
+    in.read(buf.data(), buf.size());
+    auto const head = std::span{buf}.first(static_cast<std::size_t>(in.gcount()));
+    auto const extension = lower(fs::path{filename}.extension().string());
+
+    for (auto const &e : extractors_) {
+        if (e->accepts(extension, head)) {
+            spdlog::debug("Extracting '{}' as {}", filename, e->name());
+            e->extract(path, *this, depth, out);
+            return;
+        }
+    }
+    throw UnsupportedFormat{
+        std::format("No extractor accepts '{}'", filename)};
+}
+
+fs::path const &Pipeline::tmp_dir() const noexcept
+{
+    return tmp_dir_;
+}
+
+Limits const &Pipeline::limits() const noexcept
+{
+    return limits_;
+}
+
+TextCache::TextCache(fs::path root) : root_{std::move(root)}
+{
+    fs::create_directories(root_ / "tmp");
+}
+
+std::optional<std::string> TextCache::get(std::string_view hash) const
+{
+    std::ifstream in{path(hash), std::ios::binary};
+    if (!in) {
+        return std::nullopt;
+    }
+    return std::string{std::istreambuf_iterator<char>{in}, {}};
+}
+
+void TextCache::put(std::string_view hash, std::string_view text) const
+{
+    auto const tmp = root_ / "tmp" /
+                     boost::uuids::to_string(boost::uuids::random_generator{}());
+    {
+        std::ofstream out{tmp, std::ios::binary};
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        if (!out.flush()) {
+            std::error_code ec;
+            fs::remove(tmp, ec);
+            throw std::system_error{
+                errno, std::generic_category(),
+                std::format("Failed to write '{}'", tmp.string())};
+        }
+    }
+    auto const dest = path(hash);
+    fs::create_directories(dest.parent_path());
+    fs::rename(tmp, dest);
+}
+
+fs::path TextCache::path(std::string_view hash) const
+{
+    return root_ / hash.substr(0, 2) / std::format("{}.txt", hash);
+}
+
+Service::Service(Pipeline pipeline, TextCache cache, std::size_t threads,
+                 std::size_t max_queued)
+    : pipeline_{std::move(pipeline)}, cache_{std::move(cache)},
+      max_queued_{max_queued}
+{
+    for (auto i = 0UZ; i != std::max(threads, 1UZ); ++i) {
+        threads_.emplace_back(std::bind_front(&Service::run, this));
+    }
+}
+
+Service::~Service()
+{
+    {
+        std::scoped_lock guard{mutex_};
+        queue_.clear();
+    }
+    threads_.clear();
+}
+
+bool Service::post(std::string hash, fs::path path, std::string filename,
+                   OnText on_text)
+{
+    if (!on_text && fs::exists(cache_.path(hash))) {
+        return true;
+    }
+    {
+        std::scoped_lock guard{mutex_};
+        if (pending_.contains(hash)) {
+            if (!on_text) {
+                return true;
+            }
+            if (auto const it = std::ranges::find(queue_, hash, &Job::hash);
+                it != queue_.end()) {
+                it->on_text.push_back(std::move(on_text));
+                return true;
+            }
+            // Being extracted, and queued again to be called back.
+        }
+        if (queue_.size() >= max_queued_) {
+            return false;
+        }
+        pending_.insert(hash);
+        Job job{.hash{std::move(hash)},
+                .path{std::move(path)},
+                .filename{std::move(filename)},
+                .on_text{}};
+        if (on_text) {
+            job.on_text.push_back(std::move(on_text));
+        }
+        queue_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+    return true;
+}
+
+std::optional<std::string> Service::cached(std::string_view hash) const
+{
+    return cache_.get(hash);
+}
+
+std::string Service::text(std::string const &hash, fs::path const &path,
+                          std::string_view filename)
+{
+    if (auto text = cache_.get(hash)) {
+        return *std::move(text);
+    }
+    return extract_and_cache(
+        {.hash{hash}, .path{path}, .filename{std::string{filename}}});
+}
+
+void Service::drain()
+{
+    std::unique_lock guard{mutex_};
+    idle_.wait(guard, [this] { return pending_.empty(); });
+}
+
+void Service::run(std::stop_token const &stop)
+{
+    while (true) {
+        Job job;
+        {
+            std::unique_lock guard{mutex_};
+            cv_.wait(guard, stop, [this] { return !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        std::optional<std::string> text;
+        try {
+            // Cached meanwhile, if queued while being extracted.
+            text = cache_.get(job.hash);
+            if (!text) {
+                text = extract_and_cache(job);
+            }
+        }
+        catch (std::exception const &e) {
+            // The blob may be released meanwhile.
+            spdlog::warn("Failed to extract text of '{}': {}", job.filename,
+                         e.what());
+        }
+        if (text) {
+            for (auto const &on_text : job.on_text) {
+                try {
+                    on_text(*text);
+                }
+                catch (std::exception const &e) {
+                    spdlog::error("Failed to take text of '{}': {}",
+                                  job.filename, e.what());
+                }
+            }
+        }
+        std::scoped_lock guard{mutex_};
+        pending_.erase(pending_.find(job.hash));
+        if (pending_.empty()) {
+            idle_.notify_all();
+        }
+    }
+}
+
+std::string Service::extract_and_cache(Job const &job)
+{
+    std::string text;
+    try {
+        text = pipeline_.extract(job.path, job.filename);
+    }
+    catch (UnsupportedFormat const &e) {
+        spdlog::debug("{}", e.what());
+    }
+    catch (std::system_error const &) {
+        // Not the file's fault, which may be extracted later.
+        throw;
+    }
+    catch (std::runtime_error const &e) {
+        // Malformed, which is as malformed next time.
+        spdlog::warn("Failed to extract text of '{}': {}", job.filename,
+                     e.what());
+    }
+    cache_.put(job.hash, text);
+    return text;
+}
+
+} // namespace hc::extract
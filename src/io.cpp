@@ -0,0 +1,539 @@
+#include <hc/io.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <format>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+
+#ifdef HCRE_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+namespace hc::io {
+
+namespace {
+
+[[noreturn]] void throw_errno(int err, std::string_view what)
+{
+    throw std::system_error{err, std::generic_category(), std::string{what}};
+}
+
+// Transfers all `len` bytes unless the end of file is reached. Returns bytes
+// transferred, or -errno.
+std::int64_t pread_fully(int fd, char *buf, std::size_t len,
+                         std::uint64_t offset)
+{
+    auto done = 0UZ;
+    while (done != len) {
+        auto const n = ::pread(fd, buf + done, len - done,
+                               static_cast<off_t>(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    return static_cast<std::int64_t>(done);
+}
+
+std::int64_t pwrite_fully(int fd, char const *buf, std::size_t len,
+                          std::uint64_t offset)
+{
+    auto done = 0UZ;
+    while (done != len) {
+        auto const n = ::pwrite(fd, buf + done, len - done,
+                                static_cast<off_t>(offset + done));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    return static_cast<std::int64_t>(done);
+}
+
+// Threads doing blocking I/O for all `ThreadPoolEngine`s.
+class IoThreads {
+  public:
+    static IoThreads &instance()
+    {
+        static IoThreads threads{
+            std::max(2U, std::thread::hardware_concurrency() / 2)};
+        return threads;
+    }
+
+    void post(std::vector<std::function<void()>> jobs)
+    {
+        {
+            std::scoped_lock guard{mutex_};
+            std::ranges::move(jobs, std::back_inserter(jobs_));
+        }
+        cv_.notify_all();
+    }
+
+  private:
+    explicit IoThreads(unsigned n)
+    {
+        for (auto i = 0U; i != n; ++i) {
+            threads_.emplace_back(std::bind_front(&IoThreads::run, this));
+        }
+    }
+
+    void run(std::stop_token stop)
+    {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock guard{mutex_};
+                cv_.wait(guard, stop, [this] { return !jobs_.empty(); });
+                if (jobs_.empty()) {
+                    return;
+                }
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            job();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable_any cv_;
+    std::deque<std::function<void()>> jobs_;
+    std::vector<std::jthread> threads_; // Last, so joined first
+};
+
+class ThreadPoolEngine final : public Engine {
+  public:
+    ThreadPoolEngine(std::size_t depth, std::size_t block_size)
+        : Engine{depth, block_size}
+    {
+    }
+
+    ThreadPoolEngine(ThreadPoolEngine const &) = delete;
+    ThreadPoolEngine(ThreadPoolEngine &&) = delete;
+    ThreadPoolEngine &operator=(ThreadPoolEngine const &) = delete;
+    ThreadPoolEngine &operator=(ThreadPoolEngine &&) = delete;
+
+    ~ThreadPoolEngine() override
+    {
+        // Jobs reference this engine.
+        std::unique_lock guard{mutex_};
+        cv_.wait(guard, [this] { return outstanding_ == done_.size(); });
+    }
+
+    [[nodiscard]] std::string_view backend() const noexcept override
+    {
+        return "threads";
+    }
+
+    void prepare_read(int fd, std::size_t index, std::size_t len,
+                      std::uint64_t offset, std::uint64_t tag) override
+    {
+        prepared_.push_back([this, fd, buf = buffer(index).data(), len,
+                             offset, tag] {
+            complete({tag, pread_fully(fd, buf, len, offset)});
+        });
+    }
+
+    void prepare_write(int fd, std::size_t index, std::size_t len,
+                       std::uint64_t offset, std::uint64_t tag) override
+    {
+        prepared_.push_back([this, fd, buf = buffer(index).data(), len,
+                             offset, tag] {
+            complete({tag, pwrite_fully(fd, buf, len, offset)});
+        });
+    }
+
+    void submit() override
+    {
+        if (prepared_.empty()) {
+            return;
+        }
+        {
+            std::scoped_lock guard{mutex_};
+            outstanding_ += prepared_.size();
+        }
+        IoThreads::instance().post(std::exchange(prepared_, {}));
+    }
+
+    Completion wait() override
+    {
+        std::unique_lock guard{mutex_};
+        cv_.wait(guard, [this] { return !done_.empty(); });
+        auto const c = done_.front();
+        done_.pop_front();
+        --outstanding_;
+        return c;
+    }
+
+  private:
+    void complete(Completion c)
+    {
+        // Notified under the lock, as the engine may be destroyed right after
+        // it's released.
+        std::scoped_lock guard{mutex_};
+        done_.push_back(c);
+        cv_.notify_all();
+    }
+
+    std::vector<std::function<void()>> prepared_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Completion> done_;
+    std::size_t outstanding_{}; // Submitted but not waited
+};
+
+#ifdef HCRE_HAVE_LIBURING
+class UringEngine final : public Engine {
+  public:
+    UringEngine(std::size_t depth, std::size_t block_size)
+        : Engine{depth, block_size}
+    {
+        if (auto const res =
+                io_uring_queue_init(static_cast<unsigned>(depth), &ring_, 0);
+            res < 0) {
+            throw_errno(-res, "io_uring_queue_init");
+        }
+
+        // Registered buffers spare the kernel mapping pages on each request.
+        // It fails if RLIMIT_MEMLOCK is too low, which is fine.
+        std::vector<iovec> iovecs;
+        for (auto i = 0UZ; i != depth; ++i) {
+            iovecs.push_back({buffer(i).data(), buffer(i).size()});
+        }
+        registered_ =
+            io_uring_register_buffers(&ring_, iovecs.data(),
+                                      static_cast<unsigned>(depth)) == 0;
+    }
+
+    UringEngine(UringEngine const &) = delete;
+    UringEngine(UringEngine &&) = delete;
+    UringEngine &operator=(UringEngine const &) = delete;
+    UringEngine &operator=(UringEngine &&) = delete;
+
+    ~UringEngine() override
+    {
+        io_uring_queue_exit(&ring_);
+    }
+
+    [[nodiscard]] std::string_view backend() const noexcept override
+    {
+        return registered_ ? "io_uring (registered buffers)" : "io_uring";
+    }
+
+    void prepare_read(int fd, std::size_t index, std::size_t len,
+                      std::uint64_t offset, std::uint64_t tag) override
+    {
+        auto *const sqe = get_sqe();
+        auto *const buf = buffer(index).data();
+        auto const n = static_cast<unsigned>(len);
+        if (registered_) {
+            io_uring_prep_read_fixed(sqe, fd, buf, n, offset,
+                                     static_cast<int>(index));
+        }
+        else {
+            io_uring_prep_read(sqe, fd, buf, n, offset);
+        }
+        sqe->user_data = tag;
+    }
+
+    void prepare_write(int fd, std::size_t index, std::size_t len,
+                       std::uint64_t offset, std::uint64_t tag) override
+    {
+        auto *const sqe = get_sqe();
+        auto *const buf = buffer(index).data();
+        auto const n = static_cast<unsigned>(len);
+        if (registered_) {
+            io_uring_prep_write_fixed(sqe, fd, buf, n, offset,
+                                      static_cast<int>(index));
+        }
+        else {
+            io_uring_prep_write(sqe, fd, buf, n, offset);
+        }
+        sqe->user_data = tag;
+    }
+
+    void submit() override
+    {
+        if (auto const res = io_uring_submit(&ring_); res < 0) {
+            throw_errno(-res, "io_uring_submit");
+        }
+    }
+
+    Completion wait() override
+    {
+        io_uring_cqe *cqe{};
+        auto res = 0;
+        while ((res = io_uring_wait_cqe(&ring_, &cqe)) == -EINTR) {
+        }
+        if (res < 0) {
+            throw_errno(-res, "io_uring_wait_cqe");
+        }
+        auto const c = Completion{.tag = cqe->user_data, .result = cqe->res};
+        io_uring_cqe_seen(&ring_, cqe);
+        return c;
+    }
+
+  private:
+    io_uring_sqe *get_sqe()
+    {
+        auto *sqe = io_uring_get_sqe(&ring_);
+        if (sqe == nullptr) { // Submission queue is full
+            submit();
+            sqe = io_uring_get_sqe(&ring_);
+        }
+        return sqe;
+    }
+
+    io_uring ring_{};
+    bool registered_{};
+};
+#endif // HCRE_HAVE_LIBURING
+
+constexpr auto pending = std::numeric_limits<std::int64_t>::min();
+
+} // namespace
+
+UniqueFd::UniqueFd(std::filesystem::path const &path, int flags, mode_t mode)
+    : fd_{::open(path.c_str(), flags | O_CLOEXEC, mode)}
+{
+    if (fd_ < 0) {
+        throw_errno(errno, std::format("Failed to open '{}'", path.string()));
+    }
+}
+
+UniqueFd::~UniqueFd()
+{
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+Engine::Engine(std::size_t depth, std::size_t block_size)
+    : block_size_{block_size},
+      memory_{std::make_unique_for_overwrite<char[]>(depth * block_size)}
+{
+    for (auto i = 0UZ; i != depth; ++i) {
+        buffers_.emplace_back(memory_.get() + i * block_size, block_size);
+    }
+}
+
+std::unique_ptr<Engine> Engine::make(std::size_t depth, std::size_t block_size)
+{
+#ifdef HCRE_HAVE_LIBURING
+    try {
+        return std::make_unique<UringEngine>(depth, block_size);
+    }
+    catch (std::system_error const &e) {
+        // E.g. disabled by seccomp in containers.
+        static std::once_flag warned;
+        std::call_once(warned, [&e] {
+            spdlog::warn("io_uring is unavailable ({}), using threads for "
+                         "file I/O",
+                         e.what());
+        });
+    }
+#endif
+    return std::make_unique<ThreadPoolEngine>(depth, block_size);
+}
+
+Engine &Engine::local()
+{
+    thread_local auto const engine = make();
+    return *engine;
+}
+
+Reader::Reader(Engine &engine, int fd, std::uint64_t size)
+    : engine_{engine}, fd_{fd}, size_{size},
+      results_(engine.depth(), pending)
+{
+    // Fills the whole window at once.
+    while (requested_ != engine_.depth() &&
+           requested_ * engine_.block_size() < size_) {
+        request(requested_++);
+    }
+    engine_.submit();
+}
+
+Reader::~Reader()
+{
+    drain();
+}
+
+std::span<char const> Reader::next()
+{
+    auto const bs = engine_.block_size();
+
+    // The caller is done with the previous block, so its buffer is reused
+    // for the block right after the window.
+    if (current_ != 0 && !eof_ && requested_ * bs < size_) {
+        request(requested_++);
+        engine_.submit();
+    }
+
+    if (eof_ || current_ * bs >= size_) {
+        return {};
+    }
+    auto const index = current_ % engine_.depth();
+    while (results_[index] == pending) {
+        auto const c = engine_.wait();
+        --in_flight_;
+        results_[c.tag % engine_.depth()] = c.result;
+    }
+    if (results_[index] < 0) {
+        throw_errno(static_cast<int>(-results_[index]), "Failed to read");
+    }
+
+    // Short reads are rare for regular files. The rest of the block is read
+    // synchronously.
+    auto const offset = current_ * bs;
+    auto const want = std::min<std::uint64_t>(bs, size_ - offset);
+    auto *const buf = engine_.buffer(index).data();
+    auto got = static_cast<std::uint64_t>(results_[index]);
+    if (got < want) {
+        auto const rest = pread_fully(fd_, buf + got, want - got, offset + got);
+        if (rest < 0) {
+            throw_errno(static_cast<int>(-rest), "Failed to read");
+        }
+        got += static_cast<std::uint64_t>(rest);
+        eof_ = got < want; // Shrunk since its size was taken
+    }
+    ++current_;
+    return {buf, got};
+}
+
+void Reader::request(std::uint64_t block)
+{
+    auto const bs = engine_.block_size();
+    auto const index = block % engine_.depth();
+    auto const offset = block * bs;
+    results_[index] = pending;
+    engine_.prepare_read(fd_, index, std::min<std::uint64_t>(bs, size_ - offset),
+                         offset, block);
+    ++in_flight_;
+}
+
+void Reader::drain() noexcept
+{
+    try {
+        for (; in_flight_ != 0; --in_flight_) {
+            engine_.wait();
+        }
+    }
+    catch (std::exception const &e) {
+        spdlog::error("Failed to wait for reads: {}", e.what());
+    }
+}
+
+Writer::Writer(Engine &engine, int fd)
+    : engine_{engine}, fd_{fd}, pending_(engine.depth())
+{
+    for (auto i = engine.depth() - 1; i != 0; --i) {
+        free_.push_back(i);
+    }
+}
+
+Writer::~Writer()
+{
+    drain();
+}
+
+void Writer::write(std::span<char const> data)
+{
+    if (error_ != 0) {
+        throw_errno(error_, "Failed to write");
+    }
+    while (!data.empty()) {
+        auto const buf = engine_.buffer(current_);
+        auto const n = std::min(data.size(), buf.size() - filled_);
+        std::memcpy(buf.data() + filled_, data.data(), n);
+        filled_ += n;
+        data = data.subspan(n);
+        if (filled_ == buf.size()) {
+            flush_current();
+        }
+    }
+}
+
+void Writer::finish()
+{
+    if (filled_ != 0) {
+        // The buffer goes to the free list once reaped, which doesn't matter
+        // as nothing is written afterwards.
+        flush_current();
+    }
+    while (in_flight_ != 0) {
+        reap();
+    }
+    if (error_ != 0) {
+        throw_errno(error_, "Failed to write");
+    }
+}
+
+void Writer::flush_current()
+{
+    pending_[current_] = {.offset = offset_, .len = filled_};
+    engine_.prepare_write(fd_, current_, filled_, offset_, current_);
+    engine_.submit();
+    ++in_flight_;
+    offset_ += filled_;
+    filled_ = 0;
+
+    while (free_.empty()) {
+        reap();
+    }
+    current_ = free_.back();
+    free_.pop_back();
+}
+
+void Writer::reap()
+{
+    auto const c = engine_.wait();
+    --in_flight_;
+    auto const index = static_cast<std::size_t>(c.tag);
+    auto const &p = pending_[index];
+    auto result = c.result;
+    if (result >= 0 && static_cast<std::size_t>(result) < p.len) {
+        // Short write, the rest is written synchronously.
+        auto const done = static_cast<std::size_t>(result);
+        auto const rest =
+            pwrite_fully(fd_, engine_.buffer(index).data() + done,
+                         p.len - done, p.offset + done);
+        result = rest < 0 ? rest : result + rest;
+    }
+    if (result < 0 && error_ == 0) {
+        error_ = static_cast<int>(-result);
+    }
+    free_.push_back(index);
+}
+
+void Writer::drain() noexcept
+{
+    try {
+        for (; in_flight_ != 0; --in_flight_) {
+            engine_.wait();
+        }
+    }
+    catch (std::exception const &e) {
+        spdlog::error("Failed to wait for writes: {}", e.what());
+    }
+}
+
+} // namespace hc::io
@@ -0,0 +1,204 @@
+#include <hc/jobs.h>
+
+#include <algorithm>
+#include <boost/uuid.hpp>
+#include <functional>
+#include <spdlog/spdlog.h>
+
+namespace hc::jobs {
+
+namespace uuid = boost::uuids;
+
+Context::Context(std::stop_token stop, std::atomic<double> &progress)
+    : stop_{std::move(stop)}, progress_{&progress}
+{
+}
+
+void Context::progress(double fraction)
+{
+    progress_->store(std::clamp(fraction, 0.0, 1.0));
+    if (stop_.stop_requested()) {
+        throw Cancelled{};
+    }
+}
+
+bool Context::cancelled() const noexcept
+{
+    return stop_.stop_requested();
+}
+
+Scheduler::Scheduler(SchedulerOptions options) : options_{options}
+{
+    options_.workers = std::max(options_.workers, 1UZ);
+    workers_.reserve(options_.workers);
+    for (auto i = 0UZ; i != options_.workers; ++i) {
+        workers_.emplace_back(std::bind_front(&Scheduler::run, this));
+    }
+}
+
+Scheduler::~Scheduler()
+{
+    {
+        std::scoped_lock guard{mutex_};
+        for (auto const &[_, job] : jobs_) {
+            job->stop.request_stop();
+        }
+        queue_.clear();
+    }
+    for (auto &w : workers_) {
+        w.request_stop();
+    }
+}
+
+std::optional<std::string> Scheduler::submit(std::string kind,
+                                             Priority priority, Body body,
+                                             std::string owner)
+{
+    std::string id;
+    {
+        std::scoped_lock guard{mutex_};
+        prune();
+        if (queue_.size() >= options_.max_queued) {
+            return std::nullopt;
+        }
+        id = uuid::to_string(uuid::random_generator{}());
+        auto job = std::make_shared<Job>();
+        job->id = id;
+        job->kind = std::move(kind);
+        job->owner = std::move(owner);
+        job->key = {-static_cast<int>(priority), sequence_++};
+        job->body = std::move(body);
+        queue_.emplace(job->key, job);
+        jobs_.emplace(id, std::move(job));
+    }
+    cv_.notify_one();
+    return id;
+}
+
+std::optional<Status> Scheduler::status(std::string_view id)
+{
+    std::scoped_lock guard{mutex_};
+    auto const it = jobs_.find(id);
+    if (it == jobs_.end()) {
+        return std::nullopt;
+    }
+    auto const &job = *it->second;
+    return Status{.id{job.id},
+                  .kind{job.kind},
+                  .owner{job.owner},
+                  .state = job.state,
+                  .progress = job.progress.load(),
+                  .result{job.result},
+                  .error{job.error}};
+}
+
+bool Scheduler::cancel(std::string_view id)
+{
+    std::scoped_lock guard{mutex_};
+    auto const it = jobs_.find(id);
+    if (it == jobs_.end()) {
+        return false;
+    }
+    auto &job = *it->second;
+    switch (job.state) {
+    case State::queued:
+        queue_.erase(job.key);
+        finish(job, State::cancelled);
+        idle_.notify_all();
+        return true;
+    case State::running:
+        job.stop.request_stop();
+        return true;
+    default:
+        return false;
+    }
+}
+
+void Scheduler::cancel_all()
+{
+    std::unique_lock guard{mutex_};
+    for (auto const &[_, job] : queue_) {
+        finish(*job, State::cancelled);
+    }
+    queue_.clear();
+    for (auto const &[_, job] : jobs_) {
+        if (job->state == State::running) {
+            job->stop.request_stop();
+        }
+    }
+    idle_.wait(guard, [this] { return running_ == 0; });
+}
+
+void Scheduler::drain()
+{
+    std::unique_lock guard{mutex_};
+    idle_.wait(guard, [this] { return queue_.empty() && running_ == 0; });
+}
+
+void Scheduler::run(std::stop_token const &stop)
+{
+    while (true) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock guard{mutex_};
+            if (!cv_.wait(guard, stop, [this] { return !queue_.empty(); })) {
+                return;
+            }
+            job = std::move(queue_.begin()->second);
+            queue_.erase(queue_.begin());
+            job->state = State::running;
+            ++running_;
+        }
+
+        auto state = State::succeeded;
+        std::optional<std::string> result;
+        std::optional<std::string> error;
+        try {
+            Context context{job->stop.get_token(), job->progress};
+            result = job->body(context);
+            job->progress = 1.0;
+        }
+        catch (Cancelled const &) {
+            state = State::cancelled;
+        }
+        catch (std::exception const &e) {
+            // Some fail rather than notice cancellation, e.g. if a callback
+            // refused to go on.
+            state = job->stop.stop_requested() ? State::cancelled
+                                               : State::failed;
+            error = e.what();
+            if (state == State::failed) {
+                spdlog::error("Job {} ({}) failed: {}", job->id, job->kind,
+                              e.what());
+            }
+        }
+
+        std::scoped_lock guard{mutex_};
+        job->result = std::move(result);
+        job->error = std::move(error);
+        finish(*job, state);
+        --running_;
+        if (running_ == 0) {
+            idle_.notify_all();
+        }
+    }
+}
+
+void Scheduler::finish(Job &job, State state)
+{
+    job.state = state;
+    job.finished = std::chrono::steady_clock::now();
+    job.body = nullptr; // Releases what it captured, e.g. manifests
+}
+
+void Scheduler::prune()
+{
+    auto const now = std::chrono::steady_clock::now();
+    std::erase_if(jobs_, [&](auto const &kv) {
+        auto const &job = *kv.second;
+        return (job.state != State::queued && job.state != State::running) &&
+               job.finished + options_.retention <= now;
+    });
+}
+
+} // namespace hc::jobs
@@ -0,0 +1,239 @@
+#include <hc/minhash.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+
+namespace hc::minhash {
+
+namespace {
+
+constexpr std::uint64_t splitmix64(std::uint64_t &state) noexcept
+{
+    auto z = (state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+// (a, b) of hash functions (a * x + b) >> 32. Fingerprints are uniform
+// hashes already, so multiply-shift is enough to permute them.
+constexpr auto seeds = [] {
+    std::array<std::pair<std::uint64_t, std::uint64_t>, bands * rows> s{};
+    std::uint64_t state = 42;
+    for (auto &[a, b] : s) {
+        a = splitmix64(state) | 1;
+        b = splitmix64(state);
+    }
+    return s;
+}();
+
+constexpr auto empty_row = std::numeric_limits<std::uint32_t>::max();
+
+bool is_empty(Signature const &signature) noexcept
+{
+    return std::ranges::all_of(signature,
+                               [](auto r) { return r == empty_row; });
+}
+
+} // namespace
+
+Signature signature(hc::plagiarism::Fingerprints const &fingerprints)
+{
+    Signature sig;
+    sig.fill(empty_row);
+    for (auto const x : fingerprints) {
+        // Independent rows, which compilers vectorize.
+        for (auto i = 0UZ; i != sig.size(); ++i) {
+            auto const h = static_cast<std::uint32_t>(
+                ((seeds[i].first * x) + seeds[i].second) >> 32);
+            sig[i] = std::min(sig[i], h);
+        }
+    }
+    return sig;
+}
+
+double similarity(Signature const &a, Signature const &b) noexcept
+{
+    auto same = 0UZ;
+    for (auto i = 0UZ; i != a.size(); ++i) {
+        same += a[i] == b[i] ? 1 : 0;
+    }
+    return static_cast<double>(same) / static_cast<double>(a.size());
+}
+
+std::vector<std::uint8_t> pack(Signature const &signature)
+{
+    std::vector<std::uint8_t> bytes;
+    bytes.reserve(signature.size() * 4);
+    for (auto const r : signature) {
+        for (auto i = 0; i != 4; ++i) {
+            bytes.push_back(static_cast<std::uint8_t>(r >> (8 * i)));
+        }
+    }
+    return bytes;
+}
+
+Signature unpack(std::span<std::uint8_t const> bytes)
+{
+    Signature sig{};
+    if (bytes.size() != sig.size() * 4) {
+        throw std::invalid_argument{"Bad size of MinHash signature"};
+    }
+    for (auto i = 0UZ; i != sig.size(); ++i) {
+        for (auto j = 0UZ; j != 4; ++j) {
+            sig[i] |= std::uint32_t{bytes[(4 * i) + j]} << (8 * j);
+        }
+    }
+    return sig;
+}
+
+void LshIndex::put(std::string const &assignment_name,
+                   std::string const &student_id, Signature const &signature,
+                   std::uint64_t sequence)
+{
+    auto const it = ids_.find({assignment_name, student_id});
+    if (it != ids_.end()) {
+        if (documents_[it->second].sequence > sequence) {
+            return;
+        }
+        if (is_empty(signature)) {
+            erase(assignment_name, student_id);
+            return;
+        }
+        unlink(it->second);
+        documents_[it->second].signature = signature;
+        documents_[it->second].sequence = sequence;
+        link(it->second);
+        return;
+    }
+    if (is_empty(signature)) {
+        return;
+    }
+
+    DocId id{};
+    if (!free_.empty()) {
+        id = free_.back();
+        free_.pop_back();
+    }
+    else {
+        id = static_cast<DocId>(documents_.size());
+        documents_.emplace_back();
+    }
+    documents_[id] = {.assignment_name{assignment_name},
+                      .student_id{student_id},
+                      .signature = signature,
+                      .sequence = sequence,
+                      .next{}};
+    ids_.emplace(std::pair{assignment_name, student_id}, id);
+    link(id);
+}
+
+void LshIndex::erase(std::string const &assignment_name,
+                     std::string const &student_id)
+{
+    auto const it = ids_.find({assignment_name, student_id});
+    if (it == ids_.end()) {
+        return;
+    }
+    unlink(it->second);
+    documents_[it->second] = {};
+    free_.push_back(it->second);
+    ids_.erase(it);
+}
+
+Signature const *LshIndex::find(std::string const &assignment_name,
+                                std::string const &student_id) const
+{
+    auto const it = ids_.find({assignment_name, student_id});
+    return it == ids_.end() ? nullptr : &documents_[it->second].signature;
+}
+
+std::size_t LshIndex::size() const noexcept
+{
+    return ids_.size();
+}
+
+std::vector<Match> LshIndex::query(Signature const &signature,
+                                   std::size_t limit,
+                                   double min_similarity) const
+{
+    std::vector<DocId> candidates;
+    for (auto b = 0UZ; b != bands; ++b) {
+        auto const it = buckets_[b].find(band_key(signature, b));
+        if (it == buckets_[b].end()) {
+            continue;
+        }
+        for (auto id = it->second; id != none; id = documents_[id].next[b]) {
+            candidates.push_back(id);
+        }
+    }
+    std::ranges::sort(candidates);
+    auto const [first, last] = std::ranges::unique(candidates);
+    candidates.erase(first, last);
+
+    std::vector<Match> matches;
+    for (auto const id : candidates) {
+        auto const &d = documents_[id];
+        auto const s = similarity(signature, d.signature);
+        if (s >= min_similarity) {
+            matches.push_back({.assignment_name{d.assignment_name},
+                               .student_id{d.student_id},
+                               .similarity = s});
+        }
+    }
+    auto const more_similar = [](Match const &x, Match const &y) {
+        return std::tie(y.similarity, x.assignment_name, x.student_id) <
+               std::tie(x.similarity, y.assignment_name, y.student_id);
+    };
+    auto const middle = matches.begin() + static_cast<std::ptrdiff_t>(
+                                              std::min(limit, matches.size()));
+    std::ranges::partial_sort(matches, middle, more_similar);
+    matches.erase(middle, matches.end());
+    return matches;
+}
+
+std::uint64_t LshIndex::band_key(Signature const &signature,
+                                 std::size_t band) noexcept
+{
+    std::uint64_t h = 0xcbf29ce484222325; // FNV offset basis
+    for (auto i = band * rows; i != (band + 1) * rows; ++i) {
+        h = (h ^ signature[i]) * 0x100000001b3;
+    }
+    return h;
+}
+
+void LshIndex::link(DocId id)
+{
+    auto &d = documents_[id];
+    for (auto b = 0UZ; b != bands; ++b) {
+        auto const [it, inserted] =
+            buckets_[b].try_emplace(band_key(d.signature, b), id);
+        d.next[b] = inserted ? none : std::exchange(it->second, id);
+    }
+}
+
+void LshIndex::unlink(DocId id)
+{
+    auto &d = documents_[id];
+    for (auto b = 0UZ; b != bands; ++b) {
+        auto const it = buckets_[b].find(band_key(d.signature, b));
+        if (it->second == id) {
+            if (d.next[b] == none) {
+                buckets_[b].erase(it);
+            }
+            else {
+                it->second = d.next[b];
+            }
+            continue;
+        }
+        auto prev = it->second;
+        while (documents_[prev].next[b] != id) {
+            prev = documents_[prev].next[b];
+        }
+        documents_[prev].next[b] = d.next[b];
+    }
+}
+
+} // namespace hc::minhash
@@ -1,6 +1,10 @@
 #include <hc/mock/mock-client.h>
 
+#include <format>
 #include <gtest/gtest.h>
+#include <hc/api-admin.h>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
 
 using namespace httplib;
 
@@ -42,6 +46,17 @@ void successfully_add_student_ljf(Client &client)
     EXPECT_EQ(r->status, StatusCode::OK_200);
 }
 
+void successfully_add_student_lilei(Client &client)
+{
+    auto const *const body = R"({
+            "student_id": "202326202023",
+            "name": "Li Lei"
+        })";
+    auto r = client.Post("/api/students/add", body, "application/json");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::OK_200);
+}
+
 void ljf_successfully_submit_to_testassignmentinfinite(Client &client)
 {
     auto const *const normal_body = R"({
@@ -59,4 +74,59 @@ void ljf_successfully_submit_to_testassignmentinfinite(Client &client)
     EXPECT_EQ(r->status, StatusCode::OK_200);
 }
 
+void ljf_successfully_stream_submit_to_testassignmentinfinite(Client &client)
+{
+    // "刘家福", percent-encoded
+    Headers const headers{
+        {"X-Student-Id", "202326202022"},
+        {"X-Student-Name", "%E5%88%98%E5%AE%B6%E7%A6%8F"},
+        {"X-Assignment-Name", "Test%20Assignment%20Infinite"},
+        {"X-Filename", "ljf%20sb"},
+    };
+    auto const r = client.Post("/api/assignments/submit-stream", headers,
+                               "SB LJF", "application/octet-stream");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::OK_200);
+}
+
+void successfully_stream_submit_to_testassignmentinfinite(
+    Client &client, std::string const &student_id,
+    std::string const &student_name, std::string const &content)
+{
+    Headers const headers{
+        {"X-Student-Id", student_id},
+        {"X-Student-Name", student_name},
+        {"X-Assignment-Name", "Test%20Assignment%20Infinite"},
+        {"X-Filename", "report.txt"},
+    };
+    auto const r = client.Post("/api/assignments/submit-stream", headers,
+                               content, "application/octet-stream");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::OK_200);
+}
+
+std::string report_text(std::size_t paragraphs)
+{
+    std::string report;
+    for (auto i = 0UZ; i != paragraphs; ++i) {
+        report += std::format("Paragraph {} of the report says something "
+                              "different from every other paragraph. ",
+                              i);
+    }
+    return report;
+}
+
+Headers admin_authorization(Client &client)
+{
+    auto const r = client.Post("/api/admin/login",
+                               R"({"username":"xhw","password":"xhw"})",
+                               "application/json");
+    if (!r || r->status != StatusCode::OK_200) {
+        throw std::runtime_error{"Failed to log in as admin"};
+    }
+    auto const token =
+        nlohmann::json::parse(r->body).get<AdminLoginResult>().token;
+    return {{"Authorization", "Bearer " + token}};
+}
+
 } // namespace hc::mock
@@ -0,0 +1,262 @@
+#include <hc/plagiarism.h>
+
+#include <hc/io.h>
+
+#include <algorithm>
+#include <fcntl.h>
+#include <tuple>
+
+namespace hc::plagiarism {
+
+namespace {
+
+constexpr std::uint64_t base = 0x100000001b3; // FNV prime
+
+// Finalizer of MurmurHash3. Low bits of the polynomial hash depend on few
+// characters only, while winnowing compares whole hashes.
+std::uint64_t mix(std::uint64_t h) noexcept
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccd;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53;
+    h ^= h >> 33;
+    return h;
+}
+
+bool is_space(unsigned char c) noexcept
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' ||
+           c == '\f';
+}
+
+} // namespace
+
+Winnower::Winnower(WinnowOptions const &options)
+    : options_{options}, ring_(options.k)
+{
+    for (auto i = 1UZ; i < options_.k; ++i) {
+        power_ *= base;
+    }
+}
+
+void Winnower::update(std::span<char const> data)
+{
+    for (auto const ch : data) {
+        auto const c = static_cast<unsigned char>(ch);
+        if (is_space(c)) {
+            continue;
+        }
+        push(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+    }
+}
+
+void Winnower::push(unsigned char c)
+{
+    auto &slot = ring_[chars_ % options_.k];
+    if (chars_ >= options_.k) {
+        hash_ -= slot * power_;
+    }
+    slot = c;
+    hash_ = (hash_ * base) + c;
+    if (++chars_ >= options_.k) {
+        select(mix(hash_));
+    }
+}
+
+void Winnower::select(std::uint64_t hash)
+{
+    auto const pos = grams_++;
+    while (!minima_.empty() && minima_.back().first >= hash) {
+        minima_.pop_back();
+    }
+    minima_.emplace_back(hash, pos);
+    while (minima_.front().second + options_.window <= pos) {
+        minima_.pop_front();
+    }
+    if (pos + 1 >= options_.window &&
+        minima_.front().second != selected_at_) {
+        selected_.push_back(minima_.front().first);
+        selected_at_ = minima_.front().second;
+    }
+}
+
+Fingerprints Winnower::finish()
+{
+    // Shorter than a window, which still deserves a fingerprint.
+    if (grams_ != 0 && grams_ < options_.window) {
+        selected_.push_back(minima_.front().first);
+    }
+    std::ranges::sort(selected_);
+    auto const [first, last] = std::ranges::unique(selected_);
+    selected_.erase(first, last);
+    if (selected_.size() > options_.max_fingerprints) {
+        selected_.resize(options_.max_fingerprints);
+    }
+    return std::move(selected_);
+}
+
+Fingerprints fingerprint(std::span<char const> data,
+                         WinnowOptions const &options)
+{
+    Winnower w(options);
+    w.update(data);
+    return w.finish();
+}
+
+Fingerprints fingerprint_file(std::filesystem::path const &path,
+                              WinnowOptions const &options)
+{
+    hc::io::UniqueFd const fd(path, O_RDONLY);
+    hc::io::Reader reader(hc::io::Engine::local(), fd.get(),
+                          std::filesystem::file_size(path));
+    Winnower w(options);
+    for (auto block = reader.next(); !block.empty(); block = reader.next()) {
+        w.update(block);
+    }
+    return w.finish();
+}
+
+std::vector<std::uint8_t> pack(Fingerprints const &fingerprints)
+{
+    std::vector<std::uint8_t> bytes;
+    bytes.reserve(fingerprints.size() * 8);
+    for (auto const f : fingerprints) {
+        for (auto i = 0; i != 8; ++i) {
+            bytes.push_back(static_cast<std::uint8_t>(f >> (8 * i)));
+        }
+    }
+    return bytes;
+}
+
+Fingerprints unpack(std::span<std::uint8_t const> bytes)
+{
+    Fingerprints fingerprints;
+    fingerprints.reserve(bytes.size() / 8);
+    for (auto i = 0UZ; i + 8 <= bytes.size(); i += 8) {
+        std::uint64_t f{};
+        for (auto j = 0UZ; j != 8; ++j) {
+            f |= std::uint64_t{bytes[i + j]} << (8 * j);
+        }
+        fingerprints.push_back(f);
+    }
+    return fingerprints;
+}
+
+void Index::put(std::string const &student_id, Fingerprints fingerprints,
+                std::uint64_t sequence)
+{
+    DocId id{};
+    if (auto const it = ids_.find(student_id); it != ids_.end()) {
+        id = it->second;
+        if (documents_[id].sequence > sequence) {
+            return;
+        }
+        unlink(id);
+    }
+    else if (!free_.empty()) {
+        id = free_.back();
+        free_.pop_back();
+        ids_.emplace(student_id, id);
+    }
+    else {
+        id = static_cast<DocId>(documents_.size());
+        documents_.emplace_back();
+        ids_.emplace(student_id, id);
+    }
+
+    for (auto const f : fingerprints) {
+        auto &posting = postings_[f];
+        for (auto const other : posting) {
+            ++shared_[pair_key(id, other)];
+        }
+        posting.push_back(id);
+    }
+    documents_[id] = {.student_id{student_id},
+                      .fingerprints{std::move(fingerprints)},
+                      .sequence = sequence};
+}
+
+void Index::erase(std::string const &student_id)
+{
+    auto const it = ids_.find(student_id);
+    if (it == ids_.end()) {
+        return;
+    }
+    unlink(it->second);
+    documents_[it->second] = {};
+    free_.push_back(it->second);
+    ids_.erase(it);
+}
+
+std::size_t Index::size() const noexcept
+{
+    return ids_.size();
+}
+
+std::map<std::string, Fingerprints> Index::documents() const
+{
+    std::map<std::string, Fingerprints> docs;
+    for (auto const &[student_id, id] : ids_) {
+        docs.emplace(student_id, documents_[id].fingerprints);
+    }
+    return docs;
+}
+
+std::vector<SimilarPair> Index::top_pairs(std::size_t limit,
+                                          std::size_t min_shared) const
+{
+    std::vector<SimilarPair> pairs;
+    for (auto const &[key, shared] : shared_) {
+        if (shared < min_shared) {
+            continue;
+        }
+        auto const &a = documents_[key >> 32];
+        auto const &b = documents_[key & 0xFFFFFFFF];
+        auto const smaller =
+            std::min(a.fingerprints.size(), b.fingerprints.size());
+        auto const &[first, second] = std::minmax(a.student_id, b.student_id);
+        pairs.push_back({.first{first},
+                         .second{second},
+                         .shared = shared,
+                         .similarity = static_cast<double>(shared) /
+                                       static_cast<double>(smaller)});
+    }
+
+    auto const more_similar = [](SimilarPair const &x, SimilarPair const &y) {
+        return std::tie(y.similarity, y.shared, x.first, x.second) <
+               std::tie(x.similarity, x.shared, y.first, y.second);
+    };
+    auto const middle = pairs.begin() + static_cast<std::ptrdiff_t>(
+                                            std::min(limit, pairs.size()));
+    std::ranges::partial_sort(pairs, middle, more_similar);
+    pairs.erase(middle, pairs.end());
+    return pairs;
+}
+
+std::uint64_t Index::pair_key(DocId a, DocId b) noexcept
+{
+    auto const [lo, hi] = std::minmax(a, b);
+    return (std::uint64_t{lo} << 32) | hi;
+}
+
+void Index::unlink(DocId id)
+{
+    for (auto const f : documents_[id].fingerprints) {
+        auto const it = postings_.find(f);
+        auto &posting = it->second;
+        std::erase(posting, id);
+        for (auto const other : posting) {
+            auto const s = shared_.find(pair_key(id, other));
+            if (--s->second == 0) {
+                shared_.erase(s);
+            }
+        }
+        if (posting.empty()) {
+            postings_.erase(it);
+        }
+    }
+    documents_[id].fingerprints.clear();
+}
+
+} // namespace hc::plagiarism
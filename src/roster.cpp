@@ -0,0 +1,187 @@
+#include <hc/roster.h>
+
+#include <format>
+#include <nlohmann/json.hpp>
+#include <unordered_map>
+
+namespace hc::roster {
+
+namespace {
+
+// Rows of a CSV roster with `columns` fields each. A header row, whose first
+// field is `header`, is dropped.
+std::vector<std::vector<std::string>>
+csv_rows(std::string_view body, std::size_t columns, std::string_view header)
+{
+    auto rows = parse_csv(body);
+    if (!rows.empty() && rows.front().front() == header) {
+        rows.erase(rows.begin());
+    }
+    for (auto i = 0UZ; i != rows.size(); ++i) {
+        if (rows[i].size() != columns) {
+            throw ParseError{std::format("Row {}: expected {} fields, got {}",
+                                         i + 1, columns, rows[i].size())};
+        }
+    }
+    return rows;
+}
+
+template <typename T> std::vector<T> json_rows(std::string_view body)
+{
+    try {
+        return nlohmann::json::parse(body).get<std::vector<T>>();
+    }
+    catch (nlohmann::json::exception const &e) {
+        throw ParseError{e.what()};
+    }
+}
+
+// Reports IDs seen in earlier rows.
+class DuplicateFinder {
+  public:
+    void check(std::string const &id, std::size_t row,
+               std::vector<std::string> &problems)
+    {
+        auto const [it, inserted] = rows_.try_emplace(id, row);
+        if (!inserted) {
+            problems.push_back(std::format("Row {}: ID '{}' duplicates row {}",
+                                           row, id, it->second));
+        }
+    }
+
+  private:
+    std::unordered_map<std::string, std::size_t> rows_;
+};
+
+} // namespace
+
+std::vector<std::vector<std::string>> parse_csv(std::string_view text)
+{
+    if (text.starts_with("\xEF\xBB\xBF")) {
+        text.remove_prefix(3);
+    }
+
+    std::vector<std::vector<std::string>> rows;
+    std::vector<std::string> row;
+    std::string field;
+    auto quoted = false;      // Inside quotes
+    auto row_started = false; // Anything seen in current row
+    auto end_row = [&] {
+        if (row_started) {
+            row.push_back(std::move(field));
+            rows.push_back(std::move(row));
+        }
+        row = {};
+        field = {};
+        row_started = false;
+    };
+
+    for (auto i = 0UZ; i != text.size(); ++i) {
+        auto const c = text[i];
+        if (quoted) {
+            if (c != '"') {
+                field += c;
+            }
+            else if (i + 1 != text.size() && text[i + 1] == '"') {
+                field += '"';
+                ++i;
+            }
+            else {
+                quoted = false;
+            }
+            continue;
+        }
+        switch (c) {
+        case '"':
+            quoted = true;
+            row_started = true;
+            break;
+        case ',':
+            row.push_back(std::move(field));
+            field = {};
+            row_started = true;
+            break;
+        case '\r':
+            break;
+        case '\n':
+            end_row();
+            break;
+        default:
+            field += c;
+            row_started = true;
+            break;
+        }
+    }
+    if (quoted) {
+        throw ParseError{
+            std::format("Row {}: unterminated quote", rows.size() + 1)};
+    }
+    end_row();
+    return rows;
+}
+
+std::vector<Student> parse_students(std::string_view body, bool csv)
+{
+    if (!csv) {
+        return json_rows<Student>(body);
+    }
+    std::vector<Student> students;
+    for (auto &r : csv_rows(body, 2, "student_id")) {
+        students.push_back(
+            Student{.student_id{std::move(r[0])}, .name{std::move(r[1])}});
+    }
+    return students;
+}
+
+std::vector<Teacher> parse_teachers(std::string_view body, bool csv)
+{
+    if (!csv) {
+        return json_rows<Teacher>(body);
+    }
+    std::vector<Teacher> teachers;
+    for (auto &r : csv_rows(body, 3, "teacher_id")) {
+        teachers.push_back(Teacher{.teacher_id{std::move(r[0])},
+                                   .name{std::move(r[1])},
+                                   .password{std::move(r[2])}});
+    }
+    return teachers;
+}
+
+std::vector<std::string> validate(std::span<Student const> students)
+{
+    std::vector<std::string> problems;
+    DuplicateFinder duplicates;
+    for (auto i = 0UZ; i != students.size(); ++i) {
+        auto const &s = students[i];
+        if (s.student_id.size() != 12) { // See definition of struct Student
+            problems.push_back(
+                std::format("Row {}: student ID '{}' should have 12 characters",
+                            i + 1, s.student_id));
+        }
+        if (s.name.empty()) {
+            problems.push_back(std::format("Row {}: name is empty", i + 1));
+        }
+        duplicates.check(s.student_id, i + 1, problems);
+    }
+    return problems;
+}
+
+std::vector<std::string> validate(std::span<Teacher const> teachers)
+{
+    std::vector<std::string> problems;
+    DuplicateFinder duplicates;
+    for (auto i = 0UZ; i != teachers.size(); ++i) {
+        auto const &t = teachers[i];
+        if (t.teacher_id.empty()) {
+            problems.push_back(
+                std::format("Row {}: teacher ID is empty", i + 1));
+        }
+        if (t.password.empty()) {
+            problems.push_back(std::format("Row {}: password is empty", i + 1));
+        }
+        duplicates.check(t.teacher_id, i + 1, problems);
+    }
+    return problems;
+}
+
+} // namespace hc::roster
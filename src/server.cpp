@@ -6,11 +6,20 @@
 #include <hc/assignments-submit-param.h>
 #include <hc/config.h>
 #include <hc/debug.h>
+#include <hc/io.h>
+#include <hc/roster.h>
+#include <hc/task-queue.h>
 
 #include <archive.h>
 #include <boost/uuid.hpp>
+#include <array>
+#include <cctype>
+#include <charconv>
 #include <cppcodec/base64_rfc4648.hpp>
-#include <fstream>
+#include <cppcodec/base64_url_unpadded.hpp>
+#include <fcntl.h>
+#include <limits>
+#include <ranges>
 
 using namespace std::chrono_literals;
 
@@ -21,6 +30,203 @@ using httplib::Request;
 using httplib::Response;
 using httplib::StatusCode;
 
+namespace {
+
+// Decodes "%XX" sequences, so that non-ASCII metadata can travel in headers.
+std::string percent_decode(std::string_view s)
+{
+    auto hex = [](char c) -> int {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    };
+
+    std::string res;
+    res.reserve(s.size());
+    for (auto i = 0UZ; i != s.size(); ++i) {
+        if (s[i] == '%' && i + 2 < s.size() && hex(s[i + 1]) >= 0 &&
+            hex(s[i + 2]) >= 0) {
+            res.push_back(
+                static_cast<char>((hex(s[i + 1]) << 4) | hex(s[i + 2])));
+            i += 2;
+        }
+        else {
+            res.push_back(s[i]);
+        }
+    }
+    return res;
+}
+
+std::string percent_encode(std::string_view s)
+{
+    constexpr std::string_view digits = "0123456789ABCDEF";
+    std::string res;
+    res.reserve(s.size());
+    for (auto const c : s) {
+        auto const u = static_cast<unsigned char>(c);
+        if (std::isalnum(u) != 0 || c == '-' || c == '.' || c == '_' ||
+            c == '~') {
+            res.push_back(c);
+        }
+        else {
+            res.push_back('%');
+            res.push_back(digits[u >> 4]);
+            res.push_back(digits[u & 0xF]);
+        }
+    }
+    return res;
+}
+
+void log_export_stats(std::string_view assignment_name,
+                      hc::archive::ArchiveStats const &stats)
+{
+    using std::chrono::duration_cast;
+    using std::chrono::milliseconds;
+    spdlog::info("Exported {}: {} files, {} bytes compressed, {} bytes stored "
+                 "as is in {} files, saving ~{} ms of compression",
+                 assignment_name, stats.entries, stats.bytes_compressed,
+                 stats.bytes_stored, stats.stored_entries,
+                 duration_cast<milliseconds>(stats.saved_time()).count());
+}
+
+// Jobs are visible to whoever submitted them, and to admin. Others are told
+// there's no such job rather than whose it is.
+bool may_see(std::string_view principal, hc::jobs::Status const &status)
+{
+    return principal == "admin" || status.owner == principal;
+}
+
+// Archives `entries` into a new blob, a few files at a time, so that
+// progress is reported and cancellation is noticed as it goes.
+fs::path build_export(std::string_view assignment_name,
+                      std::span<hc::archive::ManifestEntry const> entries,
+                      std::string const &format,
+                      hc::archive::CompressionProfile const &profile,
+                      hc::jobs::Context &context)
+{
+    constexpr auto step = 16UZ;
+    auto const zip = format == "zip";
+    auto const blob_dir = config::cachehome() / "blob";
+    fs::create_directories(blob_dir);
+    auto const out =
+        blob_dir / std::format("{}.{}",
+                               uuid::to_string(uuid::random_generator{}()),
+                               format);
+    try {
+        hc::archive::ArchiveWriter aw(
+            out, zip ? ARCHIVE_FORMAT_ZIP : ARCHIVE_FORMAT_TAR_PAX_RESTRICTED,
+            zip ? std::vector<int>{} : std::vector{ARCHIVE_FILTER_ZSTD},
+            profile);
+        for (auto i = 0UZ; i < entries.size(); i += step) {
+            context.progress(static_cast<double>(i) /
+                             static_cast<double>(entries.size()));
+            // A file may be superseded by a resubmission after the snapshot
+            // was taken.
+            auto const n = std::min(step, entries.size() - i);
+            aw.add_entries(entries.subspan(i, n), /*skip_missing=*/true);
+        }
+        aw.close();
+        log_export_stats(assignment_name, aw.stats());
+    }
+    catch (...) {
+        fs::remove(out);
+        throw;
+    }
+    return out;
+}
+
+enum class Received : std::uint8_t { ok, too_large, failed };
+
+// Copies request body to `sink`, an `hc::io::Writer` or
+// `hc::BlobStore::Writer`, through the fixed buffers of the I/O engine, so
+// memory usage doesn't depend on the size of the upload. Filled buffers are
+// written asynchronously while receiving goes on. The caller finishes `sink`
+// if everything is received.
+template <typename Sink>
+Received receive_body(httplib::ContentReader const &read, Sink &sink,
+                      std::size_t max_size)
+{
+    auto received = std::size_t{};
+    auto too_large = false;
+    auto const ok = read([&](char const *data, std::size_t len) {
+        received += len;
+        if (received > max_size) {
+            too_large = true;
+            return false;
+        }
+        // Exceptions mustn't go through httplib.
+        try {
+            sink.write({data, len});
+        }
+        catch (std::system_error const &e) {
+            spdlog::error("Failed to write request body: {}", e.what());
+            return false;
+        }
+        return true;
+    });
+    if (!ok) {
+        return too_large ? Received::too_large : Received::failed;
+    }
+    return Received::ok;
+}
+
+// Sink of `receive_body()` writing to `blob` while fingerprinting.
+struct FingerprintingSink {
+    hc::BlobStore::Writer &blob;
+    hc::plagiarism::Winnower &winnower;
+
+    void write(std::span<char const> data)
+    {
+        blob.write(data);
+        winnower.update(data);
+    }
+};
+
+// Splits "assignment_name/student_id+student_name/filename", the layout of
+// exports, into the three parts.
+std::optional<std::array<std::string, 3>>
+split_export_path(std::string_view path)
+{
+    std::array<std::string, 3> parts;
+    auto n = 0UZ;
+    for (auto const part : std::views::split(path, '/')) {
+        if (n == parts.size()) {
+            return std::nullopt;
+        }
+        parts[n++] = std::string_view{part};
+    }
+    if (n != parts.size() || parts[1].size() < 12) { // ID, then name
+        return std::nullopt;
+    }
+    return parts;
+}
+
+bool is_csv(Request const &r)
+{
+    return r.get_header_value("Content-Type").starts_with("text/csv");
+}
+
+// One problem per line, so that a large roster doesn't make a huge response.
+std::string join_problems(std::vector<std::string> const &problems)
+{
+    constexpr auto max_lines = 100UZ;
+    std::string res;
+    for (auto i = 0UZ; i != std::min(problems.size(), max_lines); ++i) {
+        res += problems[i];
+        res += '\n';
+    }
+    if (problems.size() > max_lines) {
+        res += std::format("... and {} more\n", problems.size() - max_lines);
+    }
+    return res;
+}
+
+} // namespace
+
 std::map<std::string, Student> load_students(sqlpp::postgresql::connection &db)
 {
     constexpr auto s = schema::Student{};
@@ -43,7 +249,8 @@ load_assignments(sqlpp::postgresql::connection &db)
     // data with one time.
     auto res =
         db(sqlpp::select(a.name, a.start_time, a.end_time, s.student_id,
-                         s.submission_time, s.filepath, s.original_filename)
+                         s.submission_time, s.filepath, s.original_filename,
+                         s.content_hash)
                .from(a.left_outer_join(s).on(a.name == s.assignment_name)));
 
     std::map<std::string, Assignment> assignments;
@@ -65,7 +272,8 @@ load_assignments(sqlpp::postgresql::connection &db)
                          .student_id{r.student_id.value()},
                          .submission_time{r.submission_time.value()},
                          .filepath{r.filepath.value()},
-                         .original_filename{r.original_filename.value()}}});
+                         .original_filename{r.original_filename.value()},
+                         .content_hash{r.content_hash.value_or("")}}});
         }
     }
 
@@ -86,15 +294,140 @@ std::map<std::string, Teacher> load_teachers(sqlpp::postgresql::connection &db)
     return teachers;
 }
 
-Server::Server(Server::DatabaseConnection &&db) : db_(std::move(db))
+std::map<std::pair<std::string, std::string>, hc::plagiarism::Fingerprints>
+load_fingerprints(sqlpp::postgresql::connection &db)
+{
+    constexpr auto f = schema::SubmissionFingerprint{};
+    auto res = db(sqlpp::select(f.assignment_name, f.student_id, f.fingerprints)
+                      .from(f));
+    std::map<std::pair<std::string, std::string>, hc::plagiarism::Fingerprints>
+        fingerprints;
+    for (auto const &r : res) {
+        fingerprints.insert({{std::string{r.assignment_name},
+                              std::string{r.student_id}},
+                             hc::plagiarism::unpack(r.fingerprints)});
+    }
+    return fingerprints;
+}
+
+std::map<std::pair<std::string, std::string>, hc::minhash::Signature>
+load_signatures(sqlpp::postgresql::connection &db)
+{
+    constexpr auto s = schema::SubmissionSignature{};
+    auto res =
+        db(sqlpp::select(s.assignment_name, s.student_id, s.signature).from(s));
+    std::map<std::pair<std::string, std::string>, hc::minhash::Signature>
+        signatures;
+    for (auto const &r : res) {
+        signatures.insert(
+            {{std::string{r.assignment_name}, std::string{r.student_id}},
+             hc::minhash::unpack(r.signature)});
+    }
+    return signatures;
+}
+
+std::unordered_map<std::string, double>
+load_aigc_scores(sqlpp::postgresql::connection &db)
+{
+    constexpr auto a = schema::AigcScore{};
+    std::unordered_map<std::string, double> scores;
+    for (auto const &r : db(sqlpp::select(a.content_hash, a.score).from(a))) {
+        scores.emplace(std::string{r.content_hash}, r.score);
+    }
+    return scores;
+}
+
+Server::Server(DatabaseConfig const &db_config)
+    : instance_id_(uuid::to_string(uuid::random_generator{}()).substr(0, 8)),
+      db_(db_config, config::db_pool_size(), config::db_acquire_timeout(),
+          config::db_probe_after()),
+      writer_(db_, config::ack_after_commit() ? hc::db::Durability::commit
+                                              : hc::db::Durability::enqueue),
+      blob_store_(config::datahome() / "blobs"),
+      extraction_(
+          hc::extract::Pipeline::with_defaults(config::cachehome() / "extract"),
+          hc::extract::TextCache{config::cachehome() / "text"},
+          config::extract_threads()),
+      export_cache_(config::export_builders(),
+                    [this](fs::path p) { remove_later(std::move(p)); }),
+      sessions_({.absolute_ttl = config::session_ttl(),
+                 .idle_ttl = config::session_idle_ttl()}),
+      jobs_({.workers = config::job_workers(),
+             .max_queued = config::max_queued_jobs()})
 {
-    if (!db_.is_connected()) {
-        throw std::runtime_error{"Failed to connect to server"};
+    auto [fingerprints, signatures] = [&] {
+        auto db = db_.acquire();
+        students_ = load_students(*db);
+        assignments_ = load_assignments(*db);
+        teachers_ = load_teachers(*db);
+        aigc_scores_ = load_aigc_scores(*db);
+        return std::pair{load_fingerprints(*db), load_signatures(*db)};
+    }();
+
+    // References to blobs are kept by submissions only.
+    for (auto const &[_, a] : assignments_) {
+        for (auto const &[_, s] : a.submissions) {
+            if (!s.content_hash.empty()) {
+                blob_store_.retain(s.content_hash);
+            }
+        }
+    }
+    // Those a crash left before the database got them. Young ones may be
+    // being committed by another instance, e.g. an ingest of CLI.
+    blob_store_.collect_garbage(1h);
+
+    // Submissions stored before plagiarism checking are left to a
+    // background job, so that start doesn't wait for reading all of them.
+    std::vector<BackfillItem> backfill;
+    for (auto const &[name, a] : assignments_) {
+        auto &index = plagiarism_[name];
+        for (auto const &[student_id, s] : a.submissions) {
+            auto const fp = fingerprints.find({name, student_id});
+            auto const sig = signatures.find({name, student_id});
+            if (fp != fingerprints.end() && sig != signatures.end()) {
+                index.put(student_id, std::move(fp->second));
+                near_duplicates_.put(name, student_id, sig->second);
+                continue;
+            }
+            backfill.push_back({
+                .assignment_name{name},
+                .student_id{student_id},
+                .filepath{s.filepath.is_absolute()
+                              ? s.filepath
+                              : xdg::data_home() / s.filepath},
+                .content_hash{s.content_hash},
+                .original_filename{s.original_filename},
+                .fingerprints{fp == fingerprints.end()
+                                  ? std::nullopt
+                                  : std::optional{std::move(fp->second)}},
+            });
+        }
+    }
+    if (!backfill.empty()) {
+        backfill_thread_ = std::jthread{
+            [this, items = std::move(backfill)](std::stop_token stop) mutable {
+                this->backfill(stop, std::move(items));
+            }};
     }
 
-    students_ = load_students(db_);
-    assignments_ = load_assignments(db_);
-    teachers_ = load_teachers(db_);
+    if (!config::aigc_endpoint().empty()) {
+        scorer_ = std::make_unique<hc::aigc::Scorer>(
+            hc::aigc::ScorerOptions{.endpoint = config::aigc_endpoint(),
+                                    .max_batch = config::aigc_batch_size()},
+            [this](hc::aigc::Scorer::Job const &job) {
+                return extraction_.text(job.content_hash, job.path,
+                                        job.filename);
+            },
+            [this](std::span<hc::aigc::Scored const> scored) {
+                take_aigc_scores(scored);
+            });
+        // Those submitted while scoring was off or down.
+        for (auto const &[_, a] : assignments_) {
+            for (auto const &[_, s] : a.submissions) {
+                score_later(s);
+            }
+        }
+    }
 
     for (auto const &[_, v] : students_)
         spdlog::debug("student=> student_id: {}, name: {}", v.student_id,
@@ -137,9 +470,13 @@ Server::Server(Server::DatabaseConnection &&db) : db_(std::move(db))
             }
         });
 
+    // Legacy submit sends files in base64, which is 4/3 of the original size.
+    auto const max_body =
+        config::max_submission_size() / 3 * 4 + (std::size_t{1} << 20);
+
     // === 全局 CORS 中间件 ===
     http_server_.set_pre_routing_handler(
-        [](httplib::Request const &req, httplib::Response &res) {
+        [max_body](httplib::Request const &req, httplib::Response &res) {
             res.set_header("Access-Control-Allow-Origin", "*");
             res.set_header("Access-Control-Allow-Methods",
                            "GET, POST, PUT, DELETE, OPTIONS");
@@ -152,9 +489,38 @@ Server::Server(Server::DatabaseConnection &&db) : db_(std::move(db))
                 return httplib::Server::HandlerResponse::Handled;
             }
 
+            // Checked before the body is read. Only ingest takes more, and
+            // bounds it as it's streamed. Others must tell their length, as
+            // a chunked body would be buffered up to the payload limit.
+            if (req.path != "/api/assignments/ingest") {
+                if (!req.has_header("Content-Length") &&
+                    req.has_header("Transfer-Encoding")) {
+                    res.status = StatusCode::LengthRequired_411;
+                    return httplib::Server::HandlerResponse::Handled;
+                }
+                if (req.get_header_value_u64("Content-Length") > max_body) {
+                    res.status = StatusCode::PayloadTooLarge_413;
+                    return httplib::Server::HandlerResponse::Handled;
+                }
+            }
+
             return httplib::Server::HandlerResponse::Unhandled;
         });
 
+    // httplib applies this limit to streamed bodies too, so it's only
+    // raised as far as ingest needs. `receive_body()` bounds the archive by
+    // `max_ingest_size()` as it's read, and the pre-routing handler bounds
+    // all other bodies by `max_body`, rejecting those without a length.
+    http_server_.set_payload_max_length(
+        std::max(max_body, config::max_ingest_size()));
+
+    // Connections are spread over queues of workers instead of one shared
+    // by all. Created on each `start()`.
+    http_server_.new_task_queue = [] {
+        return new hc::WorkStealingQueue(config::http_threads(),
+                                         config::http_max_queued());
+    };
+
     fs::create_directories(config::cachehome() / "blob");
     auto const blob_dir = (config::cachehome() / "blob").string();
     if (!http_server_.set_mount_point("/api/blob/", blob_dir)) {
@@ -167,19 +533,37 @@ Server::Server(Server::DatabaseConnection &&db) : db_(std::move(db))
     get("/api/assignments", &Server::api_assignments);
     post("/api/assignments/add", &Server::api_assignments_add);
     post("/api/assignments/submit", &Server::api_assignments_submit);
+    post("/api/assignments/submit-stream",
+         &Server::api_assignments_submit_stream);
     post("/api/assignments/export", &Server::api_assignments_export);
+    post("/api/assignments/ingest", &Server::api_assignments_ingest);
+    get("/api/assignments/duplicates", &Server::api_assignments_duplicates);
+    get("/api/assignments/plagiarism", &Server::api_assignments_plagiarism);
+    get("/api/assignments/near-duplicates",
+        &Server::api_assignments_near_duplicates);
+    get("/api/assignments/similarity-matrix",
+        &Server::api_assignments_similarity_matrix);
+    get("/api/assignments/submission-text",
+        &Server::api_assignments_submission_text);
+    get("/api/assignments/aigc", &Server::api_assignments_aigc);
 
     get("/api/students", &Server::api_students);
     post("/api/students/add", &Server::api_students_add);
+    post("/api/students/import", &Server::api_students_import);
 
     post("/api/admin/login", &Server::api_admin_login);
     post("/api/admin/verify-token", &Server::api_admin_verify_token);
+    get("/api/admin/db-pool", &Server::api_admin_db_pool);
 
     // Teacher endpoints
     post("/api/teacher/login", &Server::api_teacher_login);
     post("/api/teacher/add", &Server::api_teacher_add);
+    post("/api/teacher/import", &Server::api_teacher_import);
     post("/api/teacher/verify-token", &Server::api_teacher_verify_token);
 
+    get("/api/jobs/:id", &Server::api_jobs);
+    post("/api/jobs/:id/cancel", &Server::api_jobs_cancel);
+
     post("/api/stop", &Server::api_stop);
 }
 
@@ -218,12 +602,30 @@ void Server::stop() noexcept
         return;
     }
 
+    // Nothing may write blobs while they're removed.
+    jobs_.cancel_all();
+    export_cache_.cancel_all();
+    // A cleanup may have been cancelled before it ran.
+    cleanup_pending_ = false;
     clean_all_files();
+    export_cache_.clear();
     http_server_.stop();
     spdlog::info("Waiting for the internal server to stop gracefully");
     // Wait for the server to stop gracefully
     wait_until_stopped();
     server_thread_.reset();
+
+    if (backfill_thread_.joinable()) {
+        backfill_thread_.request_stop();
+        backfill_thread_.join();
+    }
+
+    // No handler is running now, so nothing can be enqueued after this but
+    // fingerprints of text being extracted, which the writer commits as it's
+    // destroyed.
+    spdlog::info("Flushing pending database writes");
+    writer_.flush();
+    spdlog::info("Database pool: {}", nlohmann::json(db_.stats()).dump());
 }
 
 bool Server::is_running() const noexcept
@@ -293,6 +695,11 @@ bool Server::verify_student_not_exists(std::string_view student_id,
     return true;
 }
 
+void Server::bump_data_version() noexcept
+{
+    data_version_.fetch_add(1);
+}
+
 void Server::clean_all_files()
 {
     spdlog::info("Cleaning temporary directory");
@@ -300,9 +707,16 @@ void Server::clean_all_files()
     fs::remove_all(fs::temp_directory_path() / "hc");
 }
 
+void Server::remove_later(fs::path path)
+{
+    std::scoped_lock guard{tmp_files_lock_};
+    tmp_files_.push({SystemClock::now() + 1h, std::move(path)});
+}
+
 void Server::clean_expired_files()
 {
     spdlog::info("Cleaning expired files");
+    std::scoped_lock guard{tmp_files_lock_};
     auto const now = SystemClock::now();
     while (!tmp_files_.empty() && tmp_files_.front().first <= now) {
         fs::remove(tmp_files_.front().second);
@@ -334,6 +748,11 @@ void Server::post(std::string const &path, Handler h)
     http_server_.Post(path, std::bind_front(h, this));
 }
 
+void Server::post(std::string const &path, StreamHandler h)
+{
+    http_server_.Post(path, std::bind_front(h, this));
+}
+
 void Server::api_stop(Request const & /*unused*/, Response & /*unused*/)
 {
     // 在单独线程中执行真正的 stop()，避免在 server 的 handler 线程中调用
@@ -350,9 +769,7 @@ void Server::api_admin_login(Request const &r, Response &w)
         return;
     }
 
-    boost::uuids::random_generator gen;
-    auto const token = to_string(gen());
-    tokens_.insert({token, "admin"});
+    auto const token = sessions_.create("admin");
     spdlog::info("Generated token: {}", token);
     AdminLoginResult result{.token{token}};
     w.set_content(nlohmann::json(result).dump(), "application/json");
@@ -362,263 +779,1634 @@ void Server::api_admin_verify_token(Request const &r, Response &w)
     auto const j = nlohmann::json::parse(r.body);
     auto params = j.get<AdminVerifyTokenParams>();
 
-    spdlog::debug("params.token: {}, Tokens: {}", params.token, tokens_);
+    spdlog::debug("params.token: {}", params.token);
 
-    AdminVerifyTokenResult result{.ok = tokens_.contains(params.token)};
+    AdminVerifyTokenResult result{.ok = sessions_.find(params.token)
+                                            .has_value()};
     w.set_content(nlohmann::json(result).dump(), "application/json");
 };
-void Server::api_assignments(Request const &_, Response &w)
-{
-    std::shared_lock guard{lock_};
-    auto ass =
-        assignments_ | std::views::values | std::ranges::to<std::vector>();
-    std::ranges::sort(ass, {}, [](Assignment const &a) {
-        return std::tie(a.start_time, a.end_time, a.name);
-    });
-    auto const j = nlohmann::json(ass);
-    guard.unlock();
-    w.set_content(j.dump(), "application/json");
-    spdlog::debug("Responded: assignments: {}", j.dump());
-}
-
-void Server::api_assignments_add(Request const &r, Response &w)
+void Server::api_admin_db_pool(Request const &r, Response &w)
 {
-    auto const j = nlohmann::json::parse(r.body);
-    spdlog::info("Assignment Add Request: {}", j.dump());
-    auto a = j.get<Assignment>();
-    spdlog::debug("Time parsed as from {} to {}", a.start_time, a.end_time);
-    std::unique_lock guard{lock_};
-    if (!verify_assignment_not_exists(a.name, w)) {
+    auto principal = authenticate_request(r, w);
+    if (!principal) {
         return;
     }
-    assignments_.insert({a.name, a});
-    constexpr auto ta = schema::Assignment{};
-    auto insert = sqlpp::insert_into(ta).set(ta.name = a.name,
-                                             ta.start_time = a.start_time,
-                                             ta.end_time = a.end_time);
-    db_(insert);
+    if (*principal != "admin") {
+        w.status = StatusCode::Unauthorized_401;
+        w.set_content("Only admin can inspect the server", "text/plain");
+        return;
+    }
+    w.set_content(nlohmann::json(db_.stats()).dump(), "application/json");
 }
 
-void Server::api_assignments_submit(Request const &r, Response &w)
+void Server::api_assignments(Request const &r, Response &w)
 {
-    auto const j = nlohmann::json::parse(r.body);
-    auto params = j.get<AssignmentsSubmitParams>();
-
-    spdlog::info("Assignment Submit Request: assignment: {}, name: {}, "
-                 "school_id: {}",
-                 params.assignment_name, params.student_name,
-                 params.student_id);
-
-    std::unique_lock guard{lock_};
-    if (!verify_student_exists(params.student_id, params.student_name, w)) {
+    // Plain listing, which is what dashboards poll, is served from cache.
+    if (!r.has_param("view") && !r.has_param("name") &&
+        !r.has_param("limit") && !r.has_param("cursor")) {
+        serve_cached(r, w,
+                     cached(assignments_cache_, &Server::render_assignments));
         return;
     }
 
-    if (!verify_assignment_exists(params.assignment_name, w)) {
+    auto bad_request = [&w](std::string const &err) {
+        w.status = StatusCode::BadRequest_400;
+        w.set_content(err, "text/plain");
+        spdlog::warn("{} Ignoring request.", err);
+    };
+
+    auto const view =
+        r.has_param("view") ? r.get_param_value("view") : std::string{"full"};
+    if (view != "full" && view != "summary") {
+        bad_request("Query 'view' should be 'full' or 'summary'.");
         return;
     }
 
-    auto &a = assignments_.at(params.assignment_name);
-
-    // Removes old submission
-    constexpr auto ts = schema::Submission{};
-    if (a.submissions.contains(params.student_id)) {
-        fs::remove(a.submissions.at(params.student_id).filepath);
-        db_(sqlpp::delete_from(ts).where(ts.assignment_name ==
-                                             params.assignment_name &&
-                                         ts.student_id == params.student_id));
+    auto limit = std::numeric_limits<std::size_t>::max();
+    if (r.has_param("limit")) {
+        auto const str = r.get_param_value("limit");
+        auto const [_, ec] =
+            std::from_chars(str.data(), str.data() + str.size(), limit);
+        if (ec != std::errc{} || limit == 0) {
+            bad_request("Query 'limit' should be a positive integer.");
+            return;
+        }
     }
 
-    uuid::random_generator gen;
-    auto const filename = uuid::to_string(gen());
-    auto const filedir = config::datahome() / "files";
-    fs::create_directories(filedir);
-    auto const filepath = filedir / filename;
-
-    using base64 = cppcodec::base64_rfc4648;
-    auto file = base64::decode(params.file.content);
-
-    std::ofstream ofs(filepath, std::ios::binary);
-    // NOLINTNEXTLINE
-    ofs.write(reinterpret_cast<char const *>(file.data()), file.size());
-
-    auto const s = Submission{
-        .assignment_name{params.assignment_name},
-        .student_id{params.student_id},
-        .submission_time{TimePoint{UtcClock::now().time_since_epoch()}},
-        .filepath{filepath},
-        .original_filename{params.file.filename},
+    using SortKey = std::tuple<TimePoint, TimePoint, std::string>;
+    auto key_of = [](Assignment const &a) {
+        return SortKey{a.start_time, a.end_time, a.name};
     };
 
-    // Inserts new submission
-    a.submissions[params.student_id] = s;
-    db_(sqlpp::insert_into(ts).set(ts.student_id = s.student_id,
-                                   ts.submission_time = s.submission_time,
-                                   ts.assignment_name = s.assignment_name,
-                                   ts.original_filename = s.original_filename,
-                                   ts.filepath = s.filepath.string()));
-}
-
-void Server::api_assignments_export(Request const &r, Response &w)
-{
-    auto const j = nlohmann::json::parse(r.body);
-    auto param = j.get<ApiAssignmentsExportParam>();
-    std::shared_lock guard{lock_};
-    if (!verify_assignment_exists(param.assignment_name, w)) {
-        return;
+    // Cursor is the sort key of the last item of previous page, so pages stay
+    // consistent when assignments are added in between.
+    using base64url = cppcodec::base64_url_unpadded;
+    std::optional<SortKey> after;
+    if (r.has_param("cursor")) {
+        try {
+            auto const j = nlohmann::json::parse(
+                base64url::decode<std::string>(r.get_param_value("cursor")));
+            after = SortKey{j.at(0).get<TimePoint>(), j.at(1).get<TimePoint>(),
+                            j.at(2).get<std::string>()};
+        }
+        catch (std::exception const &) {
+            bad_request("Bad cursor.");
+            return;
+        }
     }
-    auto &a = assignments_.at(param.assignment_name);
-
-    // ARCHIVE
-    // assignment_name
-    // |- student_id+student_name
-    // |  |- filename
-    // |-...
-    uuid::random_generator gen;
+    auto const name = r.get_param_value("name");
 
-    auto const tmpdir = fs::temp_directory_path() / "hc" / to_string(gen());
-    auto const adir = tmpdir / a.name;
-    fs::create_directories(adir);
-    for (auto const &[_, sub] : a.submissions) {
-        auto const &stu = students_.at(sub.student_id);
-        auto const studir = adir / (stu.student_id + stu.name);
-        fs::create_directory(studir);
-        // If file not presents, fallback to use old behavior.
-        if (fs::exists(sub.filepath)) { // NEW API
-            fs::copy_file(sub.filepath, studir / sub.original_filename);
+    AssignmentsPage page{.items = nlohmann::json::array(), .next_cursor{}};
+    {
+        std::shared_lock guard{lock_};
+        std::vector<Assignment const *> ass;
+        for (auto const &[_, a] : assignments_) {
+            if ((name.empty() || a.name.contains(name)) &&
+                (!after || key_of(a) > *after)) {
+                ass.push_back(&a);
+            }
         }
-        else if (fs::exists(xdg::data_home() / sub.filepath)) { // OLD API
-            fs::copy_file(xdg::data_home() / sub.filepath,
-                          studir / sub.original_filename);
+
+        auto const n = std::min(ass.size(), limit);
+        std::ranges::partial_sort(ass, ass.begin() + static_cast<long>(n),
+                                  std::less{},
+                                  [&](auto const *a) { return key_of(*a); });
+        for (auto const *a : ass | std::views::take(n)) {
+            if (view == "summary") {
+                page.items.push_back(AssignmentSummary{
+                    .name{a->name},
+                    .start_time{a->start_time},
+                    .end_time{a->end_time},
+                    .submission_count = a->submissions.size(),
+                });
+            }
+            else {
+                page.items.push_back(*a);
+            }
         }
-        else {
-            throw std::runtime_error{"Cannot find submission file in " +
-                                     sub.filepath.string() + ", nor in " +
-                                     (xdg::home() / sub.filepath).string()};
+        if (n < ass.size()) {
+            auto const &last = *ass[n - 1];
+            page.next_cursor = base64url::encode(
+                nlohmann::json::array(
+                    {last.start_time, last.end_time, last.name})
+                    .dump());
         }
     }
-    auto const blob_dir = config::cachehome() / "blob";
-    fs::create_directories(blob_dir);
-    auto const genfile = (to_string(gen()) + ".tar.zst");
-    auto const exported_local_filepath = blob_dir / genfile;
-    auto const exported_uri = "/api/blob/" + genfile;
-    std::vector dirs{adir};
-    hc::archive::create_tar_zst(exported_local_filepath, dirs);
-    fs::remove_all(adir);
-
-    auto const ret = AssignmentsExportResult{.exported_uri{exported_uri}};
-    w.set_content(nlohmann::json(ret).dump(), "application/json");
 
-    // w.set_file_content(exported_filepath.string(),
-    //                    "application/x-zstd-compressed-tar");
-    // w.set_header(
-    //     "Content-Disposition",
-    //     std::format("attachment; filename=\"{}\"",
-    //                 std::string(std::from_range,
-    //                             exported_filepath.filename().u8string())));
-
-    // Cleanups
-    tmp_files_.push({SystemClock::now() + 1h, exported_local_filepath});
-    clean_expired_files(); // Clean files on request
+    w.set_content(nlohmann::json(page).dump(), "application/json");
 }
 
-void Server::api_students(Request const &_, Response &w)
+std::string Server::render_assignments() const
 {
-    spdlog::info("Student List Request");
-
-    std::shared_lock guard{lock_};
-    auto const j = nlohmann::json(students_ | std::views::values |
-                                  std::ranges::to<std::vector>());
-    guard.unlock();
-
-    w.set_content(j.dump(), "application/json");
-    spdlog::debug("Responded: students: {}", j.dump());
+    auto ass = assignments_ | std::views::transform([](auto const &kv) {
+                   return &kv.second;
+               }) |
+               std::ranges::to<std::vector>();
+    std::ranges::sort(ass, {}, [](Assignment const *a) {
+        return std::tie(a->start_time, a->end_time, a->name);
+    });
+    auto j = nlohmann::json::array();
+    for (auto const *a : ass) {
+        j.push_back(*a);
+    }
+    auto body = j.dump();
+    spdlog::debug("Rendered assignments: {}", body);
+    return body;
 }
 
-void Server::api_students_add(Request const &r, Response &w)
+void Server::api_assignments_add(Request const &r, Response &w)
 {
     auto const j = nlohmann::json::parse(r.body);
-    spdlog::info("Student Add Request: {}", j.dump());
-    auto const s = j.get<Student>();
-
-    if (s.student_id.size() != 12) { // See definition of struct Assignment
-        w.status = StatusCode::BadRequest_400;
-        w.set_content("Bad assignment name length, should be 12", "text/plain");
-        spdlog::warn("Bad assignment name length, ignoring");
-        return;
-    }
+    spdlog::info("Assignment Add Request: {}", j.dump());
+    auto a = j.get<Assignment>();
+    spdlog::debug("Time parsed as from {} to {}", a.start_time, a.end_time);
     std::unique_lock guard{lock_};
-    if (students_.contains(s.student_id)) {
-        auto const err = std::format("Student '{}' already exists.", s.name);
-        w.status = StatusCode::BadRequest_400;
-        w.set_content(err, "text/plain");
-        spdlog::warn("{} Ignoring request.", err);
+    if (!verify_assignment_not_exists(a.name, w)) {
         return;
     }
+    assignments_.insert({a.name, a});
+    bump_data_version();
+    auto const persisted = writer_.enqueue(hc::db::InsertAssignment{
+        .name{a.name}, .start_time{a.start_time}, .end_time{a.end_time}});
+    guard.unlock();
 
-    students_.insert({s.student_id, s});
-    constexpr auto ts = schema::Student{};
-    db_(sqlpp::insert_into(ts).set(ts.student_id = s.student_id,
-                                   ts.name = s.name));
+    // The name is taken in memory above, so the INSERT can run without
+    // blocking others. It's rolled back if persisting fails.
+    try {
+        writer_.wait_ack(persisted);
+    }
+    catch (...) {
+        guard.lock();
+        assignments_.erase(a.name);
+        bump_data_version();
+        throw;
+    }
 }
-// NOLINTNEXTLINE(readability-convert-member-functions-to-static)
-void Server::hi(Request const &_, Response &w)
-{
-    w.set_content("Hello World!", "text/plain");
-};
 
-void Server::api_teacher_login(Request const &r, Response &w)
+void Server::api_assignments_submit(Request const &r, Response &w)
 {
-    using httplib::StatusCode;
     auto const j = nlohmann::json::parse(r.body);
-    auto params = j.get<TeacherLoginParams>();
+    auto params = j.get<AssignmentsSubmitParams>();
 
-    spdlog::info("Teacher Login: {} {}", params.teacher_id, params.password);
+    spdlog::info("Assignment Submit Request: assignment: {}, name: {}, "
+                 "school_id: {}",
+                 params.assignment_name, params.student_name,
+                 params.student_id);
 
+    // Stage 1: validation, under shared lock only.
     {
         std::shared_lock guard{lock_};
-        if (!teachers_.contains(params.teacher_id) ||
-            teachers_.at(params.teacher_id).password != params.password) {
-            w.status = StatusCode::BadRequest_400;
-            w.set_content("Invalid teacher id or password", "text/plain");
+        if (!verify_student_exists(params.student_id, params.student_name,
+                                   w) ||
+            !verify_assignment_exists(params.assignment_name, w)) {
             return;
         }
     }
 
-    boost::uuids::random_generator gen;
-    auto const token = to_string(gen());
+    // Stage 2: decoding and storing, without lock. The blob store writes
+    // under a temporary name and renames when complete, so that no
+    // half-written file is ever referenced.
+    std::string hash;
+    hc::plagiarism::Fingerprints fingerprints;
     {
-        std::unique_lock guard{lock_};
-        tokens_.insert({token, params.teacher_id});
+        using base64 = cppcodec::base64_rfc4648;
+        auto const file = base64::decode(params.file.content);
+        params.file.content = {}; // Not needed anymore
+        // NOLINTNEXTLINE
+        std::span const data{reinterpret_cast<char const *>(file.data()),
+                             file.size()};
+        hash = blob_store_.put(data);
+        fingerprints = hc::plagiarism::fingerprint(data);
     }
 
-    TeacherLoginResult result{.token{token}};
-    w.set_content(nlohmann::json(result).dump(), "application/json");
+    // Stage 3: short exclusive section.
+    commit_submission(
+        Submission{
+            .assignment_name{params.assignment_name},
+            .student_id{params.student_id},
+            .submission_time{TimePoint{UtcClock::now().time_since_epoch()}},
+            .filepath{blob_store_.path(hash)},
+            .original_filename{params.file.filename},
+            .content_hash{hash},
+        },
+        params.student_name, std::move(fingerprints), w);
 }
 
-void Server::api_teacher_verify_token(Request const &r, Response &w)
+void Server::api_assignments_submit_stream(Request const &r, Response &w,
+                                           httplib::ContentReader const &read)
 {
-    auto const j = nlohmann::json::parse(r.body);
-    auto params = j.get<TeacherVerifyTokenParams>();
+    auto const student_id = percent_decode(r.get_header_value("X-Student-Id"));
+    auto const student_name =
+        percent_decode(r.get_header_value("X-Student-Name"));
+    auto const assignment_name =
+        percent_decode(r.get_header_value("X-Assignment-Name"));
+    auto const original_filename =
+        percent_decode(r.get_header_value("X-Filename"));
+
+    spdlog::info("Assignment Stream Submit Request: assignment: {}, name: {}, "
+                 "school_id: {}",
+                 assignment_name, student_name, student_id);
 
-    std::shared_lock guard{lock_};
-    auto it = tokens_.find(params.token);
-    TeacherVerifyTokenResult result{.ok = false, .principal = ""};
-    if (it != tokens_.end()) {
-        result.ok = true;
-        result.principal = it->second; // "admin" 或 teacher_id
+    if (original_filename.empty()) {
+        w.status = StatusCode::BadRequest_400;
+        w.set_content("Missing X-Filename header", "text/plain");
+        return;
     }
-    w.set_content(nlohmann::json(result).dump(), "application/json");
-};
 
-void Server::api_teacher_add(Request const &r, Response &w)
-{
-    using httplib::StatusCode;
-    auto principal = authenticate_request(r, w);
-    if (!principal)
+    {
+        std::shared_lock guard{lock_};
+        if (!verify_student_exists(student_id, student_name, w) ||
+            !verify_assignment_exists(assignment_name, w)) {
+            return;
+        }
+    }
+
+    auto const max_size = config::max_submission_size();
+    if (r.get_header_value_u64("Content-Length") > max_size) {
+        w.status = StatusCode::PayloadTooLarge_413;
+        w.set_content(std::format("File exceeds {} bytes", max_size),
+                      "text/plain");
         return;
+    }
 
-    if (*principal != "admin") {
+    // Hashed and fingerprinted as received, so the file is written once and
+    // never read back. It's indexed by its bytes until its text is
+    // extracted.
+    std::string hash;
+    hc::plagiarism::Winnower winnower;
+    {
+        hc::BlobStore::Writer blob(blob_store_);
+        FingerprintingSink sink{.blob = blob, .winnower = winnower};
+        switch (receive_body(read, sink, max_size)) {
+        case Received::ok:
+            break;
+        case Received::too_large:
+            w.status = StatusCode::PayloadTooLarge_413;
+            w.set_content(std::format("File exceeds {} bytes", max_size),
+                          "text/plain");
+            return;
+        case Received::failed:
+            throw std::runtime_error{"Failed to receive submission body"};
+        }
+        hash = blob.commit();
+    }
+
+    commit_submission(
+        Submission{
+            .assignment_name{assignment_name},
+            .student_id{student_id},
+            .submission_time{TimePoint{UtcClock::now().time_since_epoch()}},
+            .filepath{blob_store_.path(hash)},
+            .original_filename{original_filename},
+            .content_hash{hash},
+        },
+        student_name, winnower.finish(), w);
+}
+
+void Server::api_assignments_ingest(Request const &r, Response &w,
+                                    httplib::ContentReader const &read)
+{
+    auto principal = authenticate_request(r, w);
+    if (!principal) {
+        return;
+    }
+    if (*principal != "admin") {
+        w.status = StatusCode::Unauthorized_401;
+        w.set_content("Only admin can ingest submissions", "text/plain");
+        return;
+    }
+
+    auto const max_size = config::max_ingest_size();
+    if (r.get_header_value_u64("Content-Length") > max_size) {
+        w.status = StatusCode::PayloadTooLarge_413;
+        w.set_content(std::format("Archive exceeds {} bytes", max_size),
+                      "text/plain");
+        return;
+    }
+
+    auto const dir = fs::temp_directory_path() / "hc";
+    fs::create_directories(dir);
+    auto const upload =
+        dir / ("ingest-" + uuid::to_string(uuid::random_generator{}()));
+    auto const remover =
+        std::unique_ptr<fs::path const, void (*)(fs::path const *)>{
+            &upload, [](fs::path const *p) { fs::remove(*p); }};
+    {
+        hc::io::UniqueFd const fd(upload, O_WRONLY | O_CREAT | O_TRUNC);
+        hc::io::Writer writer(hc::io::Engine::local(), fd.get());
+        switch (receive_body(read, writer, max_size)) {
+        case Received::ok:
+            break;
+        case Received::too_large:
+            w.status = StatusCode::PayloadTooLarge_413;
+            w.set_content(std::format("Archive exceeds {} bytes", max_size),
+                          "text/plain");
+            return;
+        case Received::failed:
+            throw std::runtime_error{"Failed to receive archive"};
+        }
+        writer.finish();
+    }
+
+    IngestResult result;
+    try {
+        result = ingest_submissions(upload);
+    }
+    catch (std::system_error const &) {
+        throw; // Our fault, not the archive's
+    }
+    catch (PersistError const &e) {
+        w.status = StatusCode::InternalServerError_500;
+        w.set_content(e.what(), "text/plain");
+        return;
+    }
+    catch (std::runtime_error const &e) {
+        w.status = StatusCode::BadRequest_400;
+        w.set_content(e.what(), "text/plain");
+        spdlog::warn("Bad archive to ingest: {}", e.what());
+        return;
+    }
+    w.set_content(nlohmann::json(result).dump(), "application/json");
+}
+
+IngestResult Server::ingest_submissions(fs::path const &archive)
+{
+    spdlog::info("Ingesting submissions from '{}'", archive.string());
+    hc::archive::ArchiveReader reader(
+        archive, {.max_entry_size = config::max_submission_size()});
+    IngestResult result;
+    auto skip = [&result](std::string_view path, std::string_view reason) {
+        spdlog::warn("Skipping '{}' in ingested archive: {}", path, reason);
+        result.skipped.push_back(std::format("{}: {}", path, reason));
+    };
+
+    // Stage 1: extraction, without lock. libarchive decompresses in this
+    // thread while the I/O engine writes previous blocks in background.
+    // Later entries of the same student replace earlier ones.
+    std::map<std::pair<std::string, std::string>, Submission> found;
+    std::map<std::pair<std::string, std::string>, hc::plagiarism::Fingerprints>
+        fingerprints;
+    auto release_found = [this, &found] {
+        for (auto const &[_, s] : found) {
+            release_file(s);
+        }
+    };
+    try {
+        while (auto const entry = reader.next()) {
+            auto const path =
+                std::string(entry->path.begin(), entry->path.end());
+            if (entry->type == hc::archive::EntryType::directory) {
+                continue;
+            }
+            if (entry->type != hc::archive::EntryType::regular) {
+                skip(path, "not a regular file");
+                continue;
+            }
+            auto const parts = split_export_path(path);
+            if (!parts) {
+                skip(path, "not in assignment/student_id+name/filename");
+                continue;
+            }
+            auto const &[assignment_name, student, filename] = *parts;
+            auto const student_id = student.substr(0, 12);
+            {
+                std::shared_lock guard{lock_};
+                if (!assignments_.contains(assignment_name)) {
+                    skip(path, "no such assignment");
+                    continue;
+                }
+                if (!students_.contains(student_id)) {
+                    skip(path, "no such student");
+                    continue;
+                }
+            }
+
+            std::string hash;
+            hc::plagiarism::Winnower winnower;
+            {
+                hc::BlobStore::Writer blob(blob_store_);
+                for (auto block = reader.read(); !block.empty();
+                     block = reader.read()) {
+                    blob.write(block);
+                    winnower.update(block);
+                }
+                hash = blob.commit();
+            }
+
+            Submission s{
+                .assignment_name{assignment_name},
+                .student_id{student_id},
+                .submission_time{entry->mtime.value_or(SystemClock::now())},
+                .filepath{blob_store_.path(hash)},
+                .original_filename{filename},
+                .content_hash{hash},
+            };
+            if (auto const [it, inserted] = found.try_emplace(
+                    {assignment_name, student_id}, s);
+                !inserted) {
+                skip(std::format("{}/{}", assignment_name, student),
+                     std::format("'{}' is replaced by '{}'",
+                                 it->second.original_filename, filename));
+                release_file(it->second);
+                it->second = std::move(s);
+            }
+            fingerprints[{assignment_name, student_id}] = winnower.finish();
+        }
+    }
+    catch (...) {
+        release_found();
+        throw;
+    }
+
+    std::vector<hc::db::Mutation> mutations;
+    mutations.reserve(found.size() * 3);
+    // Grouped by kind, so that each becomes multi-row statements.
+    for (auto const &[_, s] : found) {
+        mutations.emplace_back(hc::db::UpsertSubmission{.submission{s}});
+    }
+    for (auto const &[key, fp] : fingerprints) {
+        mutations.emplace_back(hc::db::UpsertFingerprints{
+            .assignment_name{key.first},
+            .student_id{key.second},
+            .fingerprints{fp},
+        });
+    }
+    std::map<std::pair<std::string, std::string>, hc::minhash::Signature>
+        signatures;
+    for (auto const &[key, fp] : fingerprints) {
+        auto const &sig = signatures[key] = hc::minhash::signature(fp);
+        mutations.emplace_back(hc::db::UpsertSignature{
+            .assignment_name{key.first},
+            .student_id{key.second},
+            .signature = sig,
+        });
+    }
+
+    // Stage 2: one exclusive section for all submissions.
+    std::map<std::pair<std::string, std::string>, Submission> superseded;
+    std::shared_future<void> persisted;
+    std::uint64_t sequence{};
+    {
+        std::unique_lock guard{lock_};
+        // Verifies again since the lock was released while extracting.
+        for (auto const &[key, _] : found) {
+            if (!assignments_.contains(key.first) ||
+                !students_.contains(key.second)) {
+                guard.unlock();
+                release_found();
+                throw std::runtime_error{std::format(
+                    "Assignment '{}' or student '{}' is gone while ingesting",
+                    key.first, key.second)};
+            }
+        }
+        for (auto const &[key, s] : found) {
+            auto &a = assignments_.at(key.first);
+            if (auto it = a.submissions.find(key.second);
+                it != a.submissions.end()) {
+                superseded.emplace(key, std::exchange(it->second, s));
+            }
+            else {
+                a.submissions.emplace(key.second, s);
+            }
+            ++a.revision;
+        }
+        bump_data_version();
+        sequence = data_version_.load();
+        persisted = writer_.enqueue(std::move(mutations));
+    }
+
+    // The superseded files are kept until the new rows are committed, so that
+    // they can be put back if that fails.
+    try {
+        writer_.wait_ack(persisted);
+    }
+    catch (std::exception const &e) {
+        spdlog::error("Failed to persist ingested submissions: {}", e.what());
+        std::vector<Submission const *> unreachable;
+        {
+            std::unique_lock guard{lock_};
+            for (auto const &[key, s] : found) {
+                auto const a = assignments_.find(key.first);
+                if (a == assignments_.end()) {
+                    continue;
+                }
+                auto const old = superseded.find(key);
+                // Unless a later submission took its place already, which
+                // then releases the file of `s` itself.
+                auto &subs = a->second.submissions;
+                if (auto const it = subs.find(key.second);
+                    it != subs.end() && it->second.filepath == s.filepath &&
+                    it->second.submission_time == s.submission_time) {
+                    if (old != superseded.end()) {
+                        it->second = old->second;
+                    }
+                    else {
+                        subs.erase(it);
+                    }
+                    ++a->second.revision;
+                    unreachable.push_back(&s);
+                }
+                else if (old != superseded.end()) {
+                    unreachable.push_back(&old->second);
+                }
+            }
+            bump_data_version();
+        }
+        for (auto const *s : unreachable) {
+            release_file(*s);
+        }
+        throw PersistError{"Failed to persist ingested submissions"};
+    }
+
+    // Nobody can reach the superseded files now.
+    for (auto const &[_, s] : superseded) {
+        release_file(s);
+    }
+    for (auto const &[key, fp] : fingerprints) {
+        index_submission(key.first, key.second, fp, signatures.at(key),
+                         sequence);
+    }
+    for (auto const &[key, s] : found) {
+        extract_text_later(s, sequence, std::move(fingerprints.at(key)));
+        score_later(s);
+    }
+
+    result.ingested = found.size();
+    spdlog::info("Ingested {} submissions, skipped {} entries",
+                 result.ingested, result.skipped.size());
+    return result;
+}
+
+void Server::api_assignments_duplicates(Request const &r, Response &w)
+{
+    if (!authenticate_request(r, w)) {
+        return;
+    }
+    auto const assignment_name = r.get_param_value("assignment_name");
+
+    std::map<std::string, std::vector<std::string>> by_hash;
+    {
+        std::shared_lock guard{lock_};
+        if (!verify_assignment_exists(assignment_name, w)) {
+            return;
+        }
+        for (auto const &[student_id, s] :
+             assignments_.at(assignment_name).submissions) {
+            if (!s.content_hash.empty()) {
+                by_hash[s.content_hash].push_back(student_id);
+            }
+        }
+    }
+
+    std::vector<DuplicateGroup> groups;
+    for (auto &[hash, student_ids] : by_hash) {
+        if (student_ids.size() < 2) {
+            continue;
+        }
+        std::ranges::sort(student_ids);
+        groups.push_back({.content_hash{hash},
+                          .student_ids{std::move(student_ids)}});
+    }
+    // Largest groups first, which are most likely a shared template.
+    std::ranges::stable_sort(
+        groups, std::greater{},
+        [](DuplicateGroup const &g) { return g.student_ids.size(); });
+    w.set_content(nlohmann::json(groups).dump(), "application/json");
+}
+
+void Server::index_submission(std::string const &assignment_name,
+                              std::string const &student_id,
+                              hc::plagiarism::Fingerprints fingerprints,
+                              hc::minhash::Signature const &signature,
+                              std::uint64_t sequence)
+{
+    std::scoped_lock guard{plagiarism_lock_};
+    plagiarism_[assignment_name].put(student_id, std::move(fingerprints),
+                                     sequence);
+    near_duplicates_.put(assignment_name, student_id, signature, sequence);
+}
+
+void Server::extract_text_later(Submission const &s, std::uint64_t sequence,
+                                hc::plagiarism::Fingerprints raw)
+{
+    if (s.content_hash.empty()) {
+        return;
+    }
+    if (!extraction_.post(
+            s.content_hash, blob_store_.path(s.content_hash),
+            s.original_filename,
+            [this, s, sequence, raw = std::move(raw)](std::string const &text) {
+                index_text(s, sequence, raw, text);
+            })) {
+        // Extracted when first asked for instead, but indexed by its bytes
+        // until resubmitted.
+        spdlog::warn("Text extraction queue is full, skipped {}",
+                     s.content_hash);
+    }
+}
+
+void Server::index_text(Submission const &s, std::uint64_t sequence,
+                        hc::plagiarism::Fingerprints const &raw,
+                        std::string const &text)
+{
+    // Without text, e.g. a PDF, its bytes still tell identical copies.
+    if (text.empty()) {
+        return;
+    }
+    auto fingerprints = hc::plagiarism::fingerprint(text);
+    if (fingerprints == raw) {
+        return;
+    }
+    auto const signature = hc::minhash::signature(fingerprints);
+
+    // Enqueued under `lock_` for the same reason as in `backfill()`.
+    {
+        std::shared_lock guard{lock_};
+        auto const a = assignments_.find(s.assignment_name);
+        if (a == assignments_.end()) {
+            return;
+        }
+        auto const it = a->second.submissions.find(s.student_id);
+        // Resubmitted meanwhile, which indexes itself.
+        if (it == a->second.submissions.end() ||
+            it->second.filepath != s.filepath ||
+            it->second.submission_time != s.submission_time) {
+            return;
+        }
+        std::vector<hc::db::Mutation> mutations;
+        mutations.emplace_back(hc::db::UpsertFingerprints{
+            .assignment_name{s.assignment_name},
+            .student_id{s.student_id},
+            .fingerprints{fingerprints},
+        });
+        mutations.emplace_back(hc::db::UpsertSignature{
+            .assignment_name{s.assignment_name},
+            .student_id{s.student_id},
+            .signature = signature,
+        });
+        writer_.enqueue(std::move(mutations));
+    }
+    // Same sequence as fingerprints of its bytes, which it replaces, but
+    // loses to a resubmission.
+    index_submission(s.assignment_name, s.student_id, std::move(fingerprints),
+                     signature, sequence);
+}
+
+void Server::score_later(Submission const &s)
+{
+    if (!scorer_ || s.content_hash.empty()) {
+        return;
+    }
+    {
+        std::scoped_lock guard{aigc_lock_};
+        if (aigc_scores_.contains(s.content_hash)) {
+            return;
+        }
+    }
+    if (!scorer_->post({.content_hash{s.content_hash},
+                        .path{blob_store_.path(s.content_hash)},
+                        .filename{s.original_filename}})) {
+        // Scored at next start instead.
+        spdlog::warn("Scoring queue is full, skipped {}", s.content_hash);
+    }
+}
+
+void Server::take_aigc_scores(std::span<hc::aigc::Scored const> scored)
+{
+    std::vector<hc::db::Mutation> mutations;
+    {
+        std::scoped_lock guard{aigc_lock_};
+        for (auto const &s : scored) {
+            aigc_scores_.insert_or_assign(s.content_hash, s.score);
+            mutations.emplace_back(hc::db::UpsertAigcScore{
+                .content_hash{s.content_hash},
+                .score = s.score,
+            });
+        }
+    }
+    // Keyed by content only, so needn't be ordered with submissions.
+    writer_.enqueue(std::move(mutations));
+}
+
+void Server::backfill(std::stop_token const &stop,
+                      std::vector<BackfillItem> items)
+{
+    spdlog::info("Backfilling fingerprints and signatures of {} submissions",
+                 items.size());
+    // Of text, as submitted ones are once extracted. Only files without
+    // text, or stored before content addressing, are of their bytes.
+    auto const fingerprint_of = [this](BackfillItem const &item) {
+        if (!item.content_hash.empty()) {
+            auto const text = extraction_.text(
+                item.content_hash, item.filepath, item.original_filename);
+            if (!text.empty()) {
+                return hc::plagiarism::fingerprint(text);
+            }
+        }
+        return hc::plagiarism::fingerprint_file(item.filepath);
+    };
+    constexpr auto batch_size = 64UZ;
+    auto done = 0UZ;
+    for (auto first = 0UZ; first < items.size() && !stop.stop_requested();
+         first += batch_size) {
+        auto const batch = std::span{items}.subspan(
+            first, std::min(batch_size, items.size() - first));
+
+        // Reading and hashing, without lock.
+        struct Computed {
+            BackfillItem *item;
+            bool fingerprinted; // Fingerprints weren't persisted
+            hc::minhash::Signature signature;
+        };
+        std::vector<Computed> computed;
+        for (auto &item : batch) {
+            auto const fingerprinted = !item.fingerprints.has_value();
+            if (fingerprinted) {
+                try {
+                    item.fingerprints = fingerprint_of(item);
+                }
+                catch (std::system_error const &e) {
+                    spdlog::warn("Failed to fingerprint '{}': {}",
+                                 item.filepath.string(), e.what());
+                    continue;
+                }
+            }
+            computed.push_back({
+                .item = &item,
+                .fingerprinted = fingerprinted,
+                .signature = hc::minhash::signature(*item.fingerprints),
+            });
+        }
+
+        // Enqueued under `lock_`, so that rows of a resubmission, which are
+        // enqueued under exclusive `lock_`, are never overwritten by these.
+        {
+            std::shared_lock guard{lock_};
+            std::erase_if(computed, [this](Computed const &c) {
+                auto const a = assignments_.find(c.item->assignment_name);
+                if (a == assignments_.end()) {
+                    return true;
+                }
+                auto const s = a->second.submissions.find(c.item->student_id);
+                // Resubmitted meanwhile, which indexes itself.
+                return s == a->second.submissions.end() ||
+                       (s->second.filepath.is_absolute()
+                            ? s->second.filepath
+                            : xdg::data_home() / s->second.filepath) !=
+                           c.item->filepath;
+            });
+            std::vector<hc::db::Mutation> mutations;
+            for (auto const &c : computed) {
+                if (c.fingerprinted) {
+                    mutations.emplace_back(hc::db::UpsertFingerprints{
+                        .assignment_name{c.item->assignment_name},
+                        .student_id{c.item->student_id},
+                        .fingerprints{*c.item->fingerprints},
+                    });
+                }
+            }
+            for (auto const &c : computed) {
+                mutations.emplace_back(hc::db::UpsertSignature{
+                    .assignment_name{c.item->assignment_name},
+                    .student_id{c.item->student_id},
+                    .signature = c.signature,
+                });
+            }
+            if (!mutations.empty()) {
+                writer_.enqueue(std::move(mutations));
+            }
+        }
+
+        // Sequence 0 loses to any resubmission committed after the check.
+        for (auto const &c : computed) {
+            index_submission(c.item->assignment_name, c.item->student_id,
+                             std::move(*c.item->fingerprints), c.signature, 0);
+        }
+        done += batch.size();
+        spdlog::debug("Backfilled {}/{} submissions", done, items.size());
+    }
+    spdlog::info("Backfilled {} of {} submissions", done, items.size());
+}
+
+void Server::api_assignments_plagiarism(Request const &r, Response &w)
+{
+    if (!authenticate_request(r, w)) {
+        return;
+    }
+    auto const assignment_name = r.get_param_value("assignment_name");
+
+    auto limit = 20UZ;
+    if (r.has_param("limit")) {
+        auto const str = r.get_param_value("limit");
+        auto const [_, ec] =
+            std::from_chars(str.data(), str.data() + str.size(), limit);
+        if (ec != std::errc{} || limit == 0) {
+            w.status = StatusCode::BadRequest_400;
+            w.set_content("Query 'limit' should be a positive integer.",
+                          "text/plain");
+            return;
+        }
+    }
+
+    {
+        std::shared_lock guard{lock_};
+        if (!verify_assignment_exists(assignment_name, w)) {
+            return;
+        }
+    }
+
+    std::vector<hc::plagiarism::SimilarPair> pairs;
+    {
+        std::scoped_lock guard{plagiarism_lock_};
+        if (auto const it = plagiarism_.find(assignment_name);
+            it != plagiarism_.end()) {
+            pairs = it->second.top_pairs(limit);
+        }
+    }
+    w.set_content(nlohmann::json(pairs).dump(), "application/json");
+}
+
+void Server::api_assignments_near_duplicates(Request const &r, Response &w)
+{
+    if (!authenticate_request(r, w)) {
+        return;
+    }
+    auto const assignment_name = r.get_param_value("assignment_name");
+    auto const student_id = r.get_param_value("student_id");
+
+    auto limit = 20UZ;
+    if (r.has_param("limit")) {
+        auto const str = r.get_param_value("limit");
+        auto const [_, ec] =
+            std::from_chars(str.data(), str.data() + str.size(), limit);
+        if (ec != std::errc{} || limit == 0) {
+            w.status = StatusCode::BadRequest_400;
+            w.set_content("Query 'limit' should be a positive integer.",
+                          "text/plain");
+            return;
+        }
+    }
+    auto min_similarity = 0.5;
+    if (r.has_param("min_similarity")) {
+        auto const str = r.get_param_value("min_similarity");
+        auto const [_, ec] = std::from_chars(
+            str.data(), str.data() + str.size(), min_similarity);
+        if (ec != std::errc{} ||
+            !(min_similarity >= 0 && min_similarity <= 1)) {
+            w.status = StatusCode::BadRequest_400;
+            w.set_content("Query 'min_similarity' should be within [0, 1].",
+                          "text/plain");
+            return;
+        }
+    }
+
+    {
+        std::shared_lock guard{lock_};
+        if (!verify_assignment_exists(assignment_name, w)) {
+            return;
+        }
+    }
+
+    std::vector<hc::minhash::Match> matches;
+    {
+        std::scoped_lock guard{plagiarism_lock_};
+        auto const *signature =
+            near_duplicates_.find(assignment_name, student_id);
+        if (signature == nullptr) {
+            w.status = StatusCode::NotFound_404;
+            w.set_content("Submission not found or not indexed yet.",
+                          "text/plain");
+            return;
+        }
+        // One more, as the submission itself matches.
+        matches = near_duplicates_.query(*signature, limit + 1, min_similarity);
+    }
+    std::erase_if(matches, [&](hc::minhash::Match const &m) {
+        return m.assignment_name == assignment_name &&
+               m.student_id == student_id;
+    });
+    if (matches.size() > limit) {
+        matches.resize(limit);
+    }
+    w.set_content(nlohmann::json(matches).dump(), "application/json");
+}
+
+void Server::api_assignments_aigc(Request const &r, Response &w)
+{
+    if (!authenticate_request(r, w)) {
+        return;
+    }
+    auto const assignment_name = r.get_param_value("assignment_name");
+
+    std::vector<hc::aigc::SubmissionScore> scores;
+    {
+        std::shared_lock guard{lock_};
+        if (!verify_assignment_exists(assignment_name, w)) {
+            return;
+        }
+        for (auto const &[student_id, s] :
+             assignments_.at(assignment_name).submissions) {
+            scores.push_back({.student_id{student_id},
+                              .content_hash{s.content_hash},
+                              .score{}});
+        }
+    }
+    {
+        std::scoped_lock guard{aigc_lock_};
+        for (auto &s : scores) {
+            if (auto const it = aigc_scores_.find(s.content_hash);
+                it != aigc_scores_.end()) {
+                s.score = it->second;
+            }
+        }
+    }
+    w.set_content(nlohmann::json(scores).dump(), "application/json");
+}
+
+void Server::api_assignments_submission_text(Request const &r, Response &w)
+{
+    if (!authenticate_request(r, w)) {
+        return;
+    }
+    auto const assignment_name = r.get_param_value("assignment_name");
+    auto const student_id = r.get_param_value("student_id");
+
+    Submission s;
+    {
+        std::shared_lock guard{lock_};
+        if (!verify_assignment_exists(assignment_name, w)) {
+            return;
+        }
+        auto const &subs = assignments_.at(assignment_name).submissions;
+        auto const it = subs.find(student_id);
+        if (it == subs.end()) {
+            w.status = StatusCode::NotFound_404;
+            w.set_content("Submission not found.", "text/plain");
+            return;
+        }
+        s = it->second;
+    }
+    if (s.content_hash.empty()) {
+        w.status = StatusCode::NotFound_404;
+        w.set_content("Submission is stored before content addressing, "
+                      "whose text isn't extracted.",
+                      "text/plain");
+        return;
+    }
+    if (auto text = extraction_.cached(s.content_hash)) {
+        w.set_content(*std::move(text), "text/plain; charset=utf-8");
+        return;
+    }
+    // Never extracted on this thread, as a large archive takes long.
+    if (!extraction_.post(s.content_hash, blob_store_.path(s.content_hash),
+                          s.original_filename)) {
+        w.status = StatusCode::ServiceUnavailable_503;
+        w.set_header("Retry-After", "5");
+        w.set_content("Too many files are being extracted.", "text/plain");
+        return;
+    }
+    w.status = StatusCode::Accepted_202;
+    w.set_header("Retry-After", "1");
+    w.set_content("Text is being extracted.", "text/plain");
+}
+
+void Server::api_assignments_similarity_matrix(Request const &r, Response &w)
+{
+    if (!authenticate_request(r, w)) {
+        return;
+    }
+    auto const assignment_name = r.get_param_value("assignment_name");
+    auto const measure_name =
+        r.has_param("measure") ? r.get_param_value("measure") : "jaccard";
+    auto const measure = hc::similarity::measure_from_name(measure_name);
+    if (!measure) {
+        w.status = StatusCode::BadRequest_400;
+        w.set_content("Query 'measure' should be 'jaccard' or 'containment'.",
+                      "text/plain");
+        return;
+    }
+
+    {
+        std::shared_lock guard{lock_};
+        if (!verify_assignment_exists(assignment_name, w)) {
+            return;
+        }
+    }
+
+    std::map<std::string, hc::plagiarism::Fingerprints> documents;
+    {
+        std::scoped_lock guard{plagiarism_lock_};
+        if (auto const it = plagiarism_.find(assignment_name);
+            it != plagiarism_.end()) {
+            documents = it->second.documents();
+        }
+    }
+
+    SimilarityMatrix result{.measure{measure_name}};
+    std::vector<hc::plagiarism::Fingerprints> sets;
+    for (auto &[student_id, fp] : documents) {
+        result.student_ids.push_back(student_id);
+        sets.push_back(std::move(fp));
+    }
+    auto const n = sets.size();
+    auto const m = hc::similarity::matrix(hc::similarity::Sketches{sets},
+                                          {.measure = *measure});
+    for (auto i = 0UZ; i != n; ++i) {
+        auto const row = m.begin() + static_cast<std::ptrdiff_t>(i * n);
+        result.matrix.emplace_back(row, row + static_cast<std::ptrdiff_t>(n));
+    }
+    w.set_content(nlohmann::json(result).dump(), "application/json");
+}
+
+void Server::release_file(Submission const &s) noexcept
+{
+    if (!s.content_hash.empty()) {
+        blob_store_.release(s.content_hash);
+        return;
+    }
+    std::error_code ec;
+    fs::remove(s.filepath, ec);
+    if (ec) {
+        spdlog::warn("Failed to remove submission '{}': {}",
+                     s.filepath.string(), ec.message());
+    }
+}
+
+bool Server::commit_submission(Submission const &s,
+                               std::string_view student_name,
+                               hc::plagiarism::Fingerprints fingerprints,
+                               Response &w)
+{
+    auto const signature = hc::minhash::signature(fingerprints);
+    std::optional<Submission> superseded;
+    std::shared_future<void> persisted;
+    std::uint64_t sequence{};
+    {
+        std::unique_lock guard{lock_};
+        // Verifies again since the lock was released while writing the file.
+        if (!verify_student_exists(s.student_id, student_name, w) ||
+            !verify_assignment_exists(s.assignment_name, w)) {
+            guard.unlock();
+            release_file(s);
+            return false;
+        }
+
+        auto &subs = assignments_.at(s.assignment_name).submissions;
+        if (auto it = subs.find(s.student_id); it != subs.end()) {
+            superseded = std::exchange(it->second, s);
+        }
+        else {
+            subs.insert({s.student_id, s});
+        }
+        ++assignments_.at(s.assignment_name).revision;
+        bump_data_version();
+        sequence = data_version_.load();
+        std::vector<hc::db::Mutation> mutations;
+        mutations.emplace_back(hc::db::UpsertSubmission{.submission{s}});
+        mutations.emplace_back(hc::db::UpsertFingerprints{
+            .assignment_name{s.assignment_name},
+            .student_id{s.student_id},
+            .fingerprints{fingerprints},
+        });
+        mutations.emplace_back(hc::db::UpsertSignature{
+            .assignment_name{s.assignment_name},
+            .student_id{s.student_id},
+            .signature = signature,
+        });
+        persisted = writer_.enqueue(std::move(mutations));
+    }
+
+    // The superseded file is kept until the new row is committed, so that
+    // it can be put back if that fails.
+    try {
+        writer_.wait_ack(persisted);
+    }
+    catch (std::exception const &e) {
+        spdlog::error("Failed to persist submission: {}", e.what());
+        auto restored = false;
+        {
+            std::unique_lock guard{lock_};
+            // Unless a later submission took its place already, which then
+            // releases the file of `s` itself.
+            if (auto const a = assignments_.find(s.assignment_name);
+                a != assignments_.end()) {
+                auto &subs = a->second.submissions;
+                if (auto const it = subs.find(s.student_id);
+                    it != subs.end() && it->second.filepath == s.filepath &&
+                    it->second.submission_time == s.submission_time) {
+                    if (superseded.has_value()) {
+                        it->second = *superseded;
+                    }
+                    else {
+                        subs.erase(it);
+                    }
+                    ++a->second.revision;
+                    bump_data_version();
+                    restored = true;
+                }
+            }
+        }
+        if (restored) {
+            release_file(s);
+        }
+        else if (superseded.has_value()) {
+            release_file(*superseded);
+        }
+        w.status = StatusCode::InternalServerError_500;
+        w.set_content("Failed to persist submission", "text/plain");
+        return false;
+    }
+
+    // Nobody can reach the superseded file now.
+    if (superseded.has_value()) {
+        release_file(*superseded);
+    }
+    index_submission(s.assignment_name, s.student_id, fingerprints, signature,
+                     sequence);
+    extract_text_later(s, sequence, std::move(fingerprints));
+    score_later(s);
+    return true;
+}
+
+void Server::api_assignments_export(Request const &r, Response &w)
+{
+    auto const principal = authenticate_request(r, w);
+    if (!principal) {
+        return;
+    }
+    auto const j = nlohmann::json::parse(r.body);
+    auto param = j.get<ApiAssignmentsExportParam>();
+    auto const profile =
+        hc::archive::CompressionProfile::from_name(param.profile);
+    if (!profile) {
+        w.status = httplib::StatusCode::BadRequest_400;
+        w.set_content(std::format("Unknown profile: {}", param.profile),
+                      "text/plain");
+        return;
+    }
+    if (param.format != "tar.zst" && param.format != "zip") {
+        w.status = httplib::StatusCode::BadRequest_400;
+        w.set_content(std::format("Unknown format: {}", param.format),
+                      "text/plain");
+        return;
+    }
+    if (param.mode != "blob" && param.mode != "stream") {
+        w.status = httplib::StatusCode::BadRequest_400;
+        w.set_content(std::format("Unknown mode: {}", param.mode),
+                      "text/plain");
+        return;
+    }
+    std::shared_lock guard{lock_};
+    if (!verify_assignment_exists(param.assignment_name, w)) {
+        return;
+    }
+    auto &a = assignments_.at(param.assignment_name);
+
+    if (param.mode == "stream") {
+        auto entries = export_entries(a);
+        guard.unlock();
+        stream_export(param.assignment_name, std::move(entries), param.format,
+                      *profile, w);
+        return;
+    }
+
+    // Requests of the same submissions, format and profile share one
+    // archive. Files are archived straight from where they're stored, under
+    // paths described in `export_entries()`. They're listed now, so that the
+    // job needn't hold `lock_`. A shared build isn't run by any of the jobs,
+    // which wait for it instead, so that cancelling one of them leaves it to
+    // the others.
+    auto const key =
+        std::format("{}:{}:{}", param.format, param.profile, a.name);
+    auto job = [this, key, revision = a.revision,
+                build = [name = a.name, entries = export_entries(a),
+                         format = param.format, profile = *profile](
+                            hc::jobs::Context &context) {
+                    return build_export(name, entries, format, profile,
+                                        context);
+                }](hc::jobs::Context &context) {
+        auto const blob = export_cache_.get_or_build(
+            key, revision, build,
+            [&context](double progress) { context.progress(progress); });
+        return "/api/blob/" + blob.filename().string();
+    };
+    guard.unlock();
+
+    auto const id =
+        jobs_.submit("export", hc::jobs::Priority::normal, std::move(job),
+                     *principal);
+    if (!id) {
+        w.status = httplib::StatusCode::ServiceUnavailable_503;
+        w.set_content("Too many jobs queued", "text/plain");
+        return;
+    }
+    auto const ret =
+        JobSubmitted{.job_id{*id}, .status_uri{"/api/jobs/" + *id}};
+    w.status = httplib::StatusCode::Accepted_202;
+    w.set_content(nlohmann::json(ret).dump(), "application/json");
+
+    clean_later();
+}
+
+void Server::clean_later()
+{
+    // One pending is enough, as it cleans whatever has expired by the time
+    // it runs.
+    if (cleanup_pending_.exchange(true)) {
+        return;
+    }
+    auto const id = jobs_.submit("cleanup", hc::jobs::Priority::low,
+                                 [this](hc::jobs::Context & /*unused*/) {
+                                     cleanup_pending_ = false;
+                                     clean_expired_files();
+                                     return std::string{};
+                                 });
+    if (!id) {
+        cleanup_pending_ = false;
+    }
+}
+
+void Server::api_jobs(Request const &r, Response &w)
+{
+    auto const principal = authenticate_request(r, w);
+    if (!principal) {
+        return;
+    }
+    auto const status = jobs_.status(r.path_params.at("id"));
+    if (!status || !may_see(*principal, *status)) {
+        w.status = httplib::StatusCode::NotFound_404;
+        w.set_content("No such job", "text/plain");
+        return;
+    }
+    w.set_content(nlohmann::json(*status).dump(), "application/json");
+}
+
+void Server::api_jobs_cancel(Request const &r, Response &w)
+{
+    auto const principal = authenticate_request(r, w);
+    if (!principal) {
+        return;
+    }
+    auto const &id = r.path_params.at("id");
+    if (auto const before = jobs_.status(id);
+        !before || !may_see(*principal, *before)) {
+        w.status = httplib::StatusCode::NotFound_404;
+        w.set_content("No such job", "text/plain");
+        return;
+    }
+    auto const cancelled = jobs_.cancel(id);
+    auto const status = jobs_.status(id);
+    if (!status) {
+        w.status = httplib::StatusCode::NotFound_404;
+        w.set_content("No such job", "text/plain");
+        return;
+    }
+    if (!cancelled) {
+        w.status = httplib::StatusCode::Conflict_409;
+    }
+    w.set_content(nlohmann::json(*status).dump(), "application/json");
+}
+
+std::vector<hc::archive::ManifestEntry>
+Server::export_entries(Assignment const &a) const
+{
+    // ARCHIVE
+    // assignment_name
+    // |- student_id+student_name
+    // |  |- filename
+    // |-...
+    std::vector<hc::archive::ManifestEntry> entries;
+    entries.reserve(a.submissions.size());
+    for (auto const &[_, sub] : a.submissions) {
+        auto const &stu = students_.at(sub.student_id);
+        auto ar_path = fs::path{a.name} / (stu.student_id + stu.name) /
+                       fs::path{sub.original_filename}.filename();
+        // NEW API stores absolute paths, while OLD API stores them relative
+        // to data home. Existence is checked when the file is opened.
+        entries.push_back({sub.filepath.is_absolute()
+                               ? sub.filepath
+                               : xdg::data_home() / sub.filepath,
+                           ar_path.u8string()});
+    }
+    return entries;
+}
+
+void Server::stream_export(std::string const &assignment_name,
+                           std::vector<hc::archive::ManifestEntry> entries,
+                           std::string const &format,
+                           hc::archive::CompressionProfile const &profile,
+                           Response &w)
+{
+    auto const zip = format == "zip";
+    w.set_header("Content-Disposition",
+                 std::format("attachment; filename*=UTF-8''{}.{}",
+                             percent_encode(assignment_name), format));
+
+    // The archive is produced while being sent: libarchive hands out each
+    // compressed block to the sink, which writes it to the socket.
+    w.set_chunked_content_provider(
+        zip ? "application/zip" : "application/x-zstd-compressed-tar",
+        [assignment_name, entries = std::move(entries), zip,
+         profile](std::size_t /*offset*/, httplib::DataSink &sink) {
+            // Exceptions must not escape from a content provider.
+            try {
+                hc::archive::ArchiveWriter aw(
+                    [&sink](std::span<char const> data) {
+                        return sink.write(data.data(), data.size());
+                    },
+                    zip ? ARCHIVE_FORMAT_ZIP
+                        : ARCHIVE_FORMAT_TAR_PAX_RESTRICTED,
+                    zip ? std::vector<int>{} : std::vector{ARCHIVE_FILTER_ZSTD},
+                    profile);
+                // A file may be superseded by a resubmission after the
+                // snapshot was taken.
+                aw.add_entries(entries, /*skip_missing=*/true);
+                aw.close();
+                log_export_stats(assignment_name, aw.stats());
+                sink.done();
+                return true;
+            }
+            catch (std::exception const &e) {
+                spdlog::error("Failed to stream export: {}", e.what());
+                return false;
+            }
+        });
+}
+
+void Server::api_students(Request const &r, Response &w)
+{
+    spdlog::info("Student List Request");
+    serve_cached(r, w, cached(students_cache_, &Server::render_students));
+}
+
+std::string Server::render_students() const
+{
+    auto j = nlohmann::json::array();
+    for (auto const &[_, s] : students_) {
+        j.push_back(s);
+    }
+    auto body = j.dump();
+    spdlog::debug("Rendered students: {}", body);
+    return body;
+}
+
+std::shared_ptr<Server::CachedBody const>
+Server::cached(std::atomic<std::shared_ptr<CachedBody const>> &cache,
+               std::string (Server::*render)() const)
+{
+    auto current = cache.load();
+    if (current && current->version == data_version_.load()) {
+        return current;
+    }
+
+    // Version is read under the same lock as rendering, so they agree.
+    std::shared_lock guard{lock_};
+    auto const version = data_version_.load();
+    auto fresh = std::make_shared<CachedBody const>(CachedBody{
+        .version = version,
+        .body = std::make_shared<std::string const>((this->*render)()),
+    });
+    guard.unlock();
+
+    // Publishes, unless another request has published a newer one meanwhile.
+    while (!current || current->version < version) {
+        if (cache.compare_exchange_weak(current, fresh)) {
+            return fresh;
+        }
+    }
+    return current;
+}
+
+void Server::serve_cached(Request const &r, Response &w,
+                          std::shared_ptr<CachedBody const> const &cached)
+{
+    auto const etag = std::format("\"{}-{}\"", instance_id_, cached->version);
+    w.set_header("ETag", etag);
+    auto const if_none_match = r.get_header_value("If-None-Match");
+    if (if_none_match == "*" || if_none_match.find(etag) != std::string::npos) {
+        w.status = StatusCode::NotModified_304;
+        return;
+    }
+
+    // Shares the body instead of copying it into the response.
+    auto body = cached->body;
+    w.set_content_provider(body->size(), "application/json",
+                           [body](std::size_t offset, std::size_t length,
+                                  httplib::DataSink &sink) {
+                               return sink.write(body->data() + offset, length);
+                           });
+}
+
+void Server::api_students_add(Request const &r, Response &w)
+{
+    auto const j = nlohmann::json::parse(r.body);
+    spdlog::info("Student Add Request: {}", j.dump());
+    auto const s = j.get<Student>();
+
+    if (s.student_id.size() != 12) { // See definition of struct Assignment
+        w.status = StatusCode::BadRequest_400;
+        w.set_content("Bad assignment name length, should be 12", "text/plain");
+        spdlog::warn("Bad assignment name length, ignoring");
+        return;
+    }
+    std::unique_lock guard{lock_};
+    if (students_.contains(s.student_id)) {
+        auto const err = std::format("Student '{}' already exists.", s.name);
+        w.status = StatusCode::BadRequest_400;
+        w.set_content(err, "text/plain");
+        spdlog::warn("{} Ignoring request.", err);
+        return;
+    }
+
+    students_.insert({s.student_id, s});
+    bump_data_version();
+    auto const persisted = writer_.enqueue(hc::db::InsertStudent{.student{s}});
+    guard.unlock();
+
+    try {
+        writer_.wait_ack(persisted);
+    }
+    catch (...) {
+        guard.lock();
+        students_.erase(s.student_id);
+        bump_data_version();
+        throw;
+    }
+}
+
+void Server::api_students_import(Request const &r, Response &w)
+{
+    if (!authenticate_request(r, w)) {
+        return;
+    }
+    std::vector<Student> students;
+    try {
+        students = hc::roster::parse_students(r.body, is_csv(r));
+    }
+    catch (hc::roster::ParseError const &e) {
+        w.status = StatusCode::BadRequest_400;
+        w.set_content(e.what(), "text/plain");
+        spdlog::warn("Bad student roster: {}", e.what());
+        return;
+    }
+    spdlog::info("Student Import Request: {} students", students.size());
+    import_roster(
+        std::move(students), &Student::student_id, students_,
+        [](Student const &s) { return hc::db::InsertStudent{.student{s}}; },
+        w);
+}
+
+void Server::api_teacher_import(Request const &r, Response &w)
+{
+    auto principal = authenticate_request(r, w);
+    if (!principal) {
+        return;
+    }
+    if (*principal != "admin") {
+        w.status = StatusCode::Unauthorized_401;
+        w.set_content("Only admin can add teachers", "text/plain");
+        return;
+    }
+    std::vector<Teacher> teachers;
+    try {
+        teachers = hc::roster::parse_teachers(r.body, is_csv(r));
+    }
+    catch (hc::roster::ParseError const &e) {
+        w.status = StatusCode::BadRequest_400;
+        w.set_content(e.what(), "text/plain");
+        spdlog::warn("Bad teacher roster: {}", e.what());
+        return;
+    }
+    spdlog::info("Teacher Import Request: {} teachers", teachers.size());
+    import_roster(
+        std::move(teachers), &Teacher::teacher_id, teachers_,
+        [](Teacher const &t) { return hc::db::InsertTeacher{.teacher{t}}; },
+        w);
+}
+
+template <typename T, typename MakeMutation>
+void Server::import_roster(std::vector<T> rows, std::string T::*id,
+                           std::map<std::string, T> &into,
+                           MakeMutation make_mutation, Response &w)
+{
+    auto reject = [&w](std::vector<std::string> const &problems) {
+        w.status = StatusCode::BadRequest_400;
+        w.set_content(join_problems(problems), "text/plain");
+        spdlog::warn("Rejecting roster with {} problems, first: {}",
+                     problems.size(), problems.front());
+    };
+    if (rows.empty()) {
+        reject({"Roster is empty"});
+        return;
+    }
+    if (auto const problems = hc::roster::validate(rows); !problems.empty()) {
+        reject(problems);
+        return;
+    }
+
+    // Everything but the merge is prepared out of the exclusive section.
+    std::vector<hc::db::Mutation> mutations;
+    mutations.reserve(rows.size());
+    std::vector<std::string> keys;
+    keys.reserve(rows.size());
+    std::map<std::string, T> batch;
+    for (auto &row : rows) {
+        mutations.emplace_back(make_mutation(row));
+        keys.push_back(row.*id);
+        batch.emplace(keys.back(), std::move(row));
+    }
+
+    std::unique_lock guard{lock_};
+    std::vector<std::string> problems;
+    for (auto const &[key, _] : batch) {
+        if (into.contains(key)) {
+            problems.push_back(std::format("ID '{}' already exists", key));
+        }
+    }
+    if (!problems.empty()) {
+        guard.unlock();
+        reject(problems);
+        return;
+    }
+    // Splices nodes over, without copying or allocating.
+    into.merge(batch);
+    bump_data_version();
+    auto const persisted = writer_.enqueue(std::move(mutations));
+    guard.unlock();
+
+    try {
+        writer_.wait_ack(persisted);
+    }
+    catch (std::exception const &e) {
+        spdlog::error("Failed to persist roster: {}", e.what());
+        guard.lock();
+        for (auto const &key : keys) {
+            into.erase(key);
+        }
+        bump_data_version();
+        w.status = StatusCode::InternalServerError_500;
+        w.set_content("Failed to persist roster", "text/plain");
+        return;
+    }
+
+    spdlog::info("Imported {} rows", keys.size());
+    w.set_content(
+        nlohmann::json(RosterImportResult{.imported = keys.size()}).dump(),
+        "application/json");
+}
+
+// NOLINTNEXTLINE(readability-convert-member-functions-to-static)
+void Server::hi(Request const &_, Response &w)
+{
+    w.set_content("Hello World!", "text/plain");
+};
+
+void Server::api_teacher_login(Request const &r, Response &w)
+{
+    using httplib::StatusCode;
+    auto const j = nlohmann::json::parse(r.body);
+    auto params = j.get<TeacherLoginParams>();
+
+    spdlog::info("Teacher Login: {} {}", params.teacher_id, params.password);
+
+    {
+        std::shared_lock guard{lock_};
+        if (!teachers_.contains(params.teacher_id) ||
+            teachers_.at(params.teacher_id).password != params.password) {
+            w.status = StatusCode::BadRequest_400;
+            w.set_content("Invalid teacher id or password", "text/plain");
+            return;
+        }
+    }
+
+    auto const token = sessions_.create(params.teacher_id);
+
+    TeacherLoginResult result{.token{token}};
+    w.set_content(nlohmann::json(result).dump(), "application/json");
+}
+
+void Server::api_teacher_verify_token(Request const &r, Response &w)
+{
+    auto const j = nlohmann::json::parse(r.body);
+    auto params = j.get<TeacherVerifyTokenParams>();
+
+    auto principal = sessions_.find(params.token);
+    TeacherVerifyTokenResult result{.ok = false, .principal = ""};
+    if (principal) {
+        result.ok = true;
+        result.principal = std::move(*principal); // "admin" 或 teacher_id
+    }
+    w.set_content(nlohmann::json(result).dump(), "application/json");
+};
+
+void Server::api_teacher_add(Request const &r, Response &w)
+{
+    using httplib::StatusCode;
+    auto principal = authenticate_request(r, w);
+    if (!principal)
+        return;
+
+    if (*principal != "admin") {
         w.status = StatusCode::Unauthorized_401;
         w.set_content("Only admin can add teachers", "text/plain");
         return;
@@ -633,23 +2421,25 @@ void Server::api_teacher_add(Request const &r, Response &w)
         w.set_content("Teacher already exists", "text/plain");
         return;
     }
+    teachers_.insert({t.teacher_id, t});
+    bump_data_version();
+    auto const persisted = writer_.enqueue(hc::db::InsertTeacher{.teacher{t}});
+    guard.unlock();
 
     // 持久化到 DB
     try {
-        constexpr auto tt = schema::Teacher{};
-        auto insert = sqlpp::insert_into(tt).set(tt.teacher_id = t.teacher_id,
-                                                 tt.name = t.name,
-                                                 tt.password = t.password);
-        db_(insert);
+        writer_.wait_ack(persisted);
     }
     catch (std::exception &e) {
         spdlog::error("Failed to insert teacher to DB: {}", e.what());
+        guard.lock();
+        teachers_.erase(t.teacher_id);
+        bump_data_version();
         w.status = StatusCode::InternalServerError_500;
         w.set_content("Failed to persist teacher", "text/plain");
         return;
     }
 
-    teachers_.insert({t.teacher_id, std::move(t)});
     w.set_content("OK", "text/plain");
 }
 
@@ -672,12 +2462,11 @@ std::optional<std::string> Server::authenticate_request(Request const &req,
     }
     auto token = val.substr(prefix.size());
 
-    std::shared_lock guard{lock_};
-    auto it2 = tokens_.find(token);
-    if (it2 == tokens_.end()) {
+    auto principal = sessions_.find(token);
+    if (!principal) {
         w.status = StatusCode::Unauthorized_401;
         w.set_content("Invalid token", "text/plain");
         return std::nullopt;
     }
-    return it2->second; // "admin" 或 teacher_id
+    return principal; // "admin" 或 teacher_id
 }
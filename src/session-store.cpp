@@ -0,0 +1,124 @@
+#include <hc/session-store.h>
+
+#include <algorithm>
+#include <boost/uuid.hpp>
+#include <mutex>
+
+namespace hc {
+
+namespace uuid = boost::uuids;
+
+SessionStore::SessionStore(SessionOptions options) : options_{options}
+{
+    options_.shards = std::max(options_.shards, 1UZ);
+    options_.tick = std::max(options_.tick, std::chrono::milliseconds{1});
+    shards_.reserve(options_.shards);
+    for (auto i = 0UZ; i != options_.shards; ++i) {
+        shards_.push_back(std::make_unique<Shard>(options_.tick));
+    }
+    sweeper_ = std::jthread{std::bind_front(&SessionStore::run, this)};
+}
+
+std::string SessionStore::create(std::string principal)
+{
+    auto token = uuid::to_string(uuid::random_generator{}());
+    auto const now = Clock::now();
+    auto session = std::make_unique<Session>();
+    session->principal = std::move(principal);
+    session->expires = now + options_.absolute_ttl;
+    session->last_used = now.time_since_epoch().count();
+    auto const when = deadline(*session);
+
+    auto &shard = shard_of(token);
+    std::scoped_lock guard{shard.mutex};
+    shard.sessions.emplace(token, std::move(session));
+    shard.timers.schedule(token, when);
+    return token;
+}
+
+std::optional<std::string> SessionStore::find(std::string_view token)
+{
+    auto &shard = shard_of(token);
+    std::shared_lock guard{shard.mutex};
+    auto const it = shard.sessions.find(token);
+    if (it == shard.sessions.end()) {
+        return std::nullopt;
+    }
+    auto &s = *it->second;
+    auto const now = Clock::now();
+    // Expired but not swept yet.
+    if (deadline(s) <= now) {
+        return std::nullopt;
+    }
+    // Its timer isn't moved: when it fires, the session is checked again.
+    s.last_used.store(now.time_since_epoch().count(),
+                      std::memory_order_relaxed);
+    return s.principal;
+}
+
+void SessionStore::revoke(std::string_view token)
+{
+    auto &shard = shard_of(token);
+    std::scoped_lock guard{shard.mutex};
+    // Its timer fires for nothing.
+    if (auto const it = shard.sessions.find(token);
+        it != shard.sessions.end()) {
+        shard.sessions.erase(it);
+    }
+}
+
+std::size_t SessionStore::size() const
+{
+    auto n = 0UZ;
+    for (auto const &shard : shards_) {
+        std::shared_lock guard{shard->mutex};
+        n += shard->sessions.size();
+    }
+    return n;
+}
+
+void SessionStore::sweep()
+{
+    for (auto const &shard : shards_) {
+        std::scoped_lock guard{shard->mutex};
+        auto const now = Clock::now();
+        for (auto &token : shard->timers.advance(now)) {
+            auto const it = shard->sessions.find(token);
+            if (it == shard->sessions.end()) {
+                continue; // Revoked
+            }
+            auto const when = deadline(*it->second);
+            if (when <= now) {
+                shard->sessions.erase(it);
+            }
+            else {
+                // Used since it was scheduled.
+                shard->timers.schedule(std::move(token), when);
+            }
+        }
+    }
+}
+
+SessionStore::Clock::time_point
+SessionStore::deadline(Session const &s) const
+{
+    auto const last_used = Clock::time_point{
+        Clock::duration{s.last_used.load(std::memory_order_relaxed)}};
+    return std::min(s.expires, last_used + options_.idle_ttl);
+}
+
+SessionStore::Shard &SessionStore::shard_of(std::string_view token)
+{
+    return *shards_[Hash{}(token) % shards_.size()];
+}
+
+void SessionStore::run(std::stop_token const &stop)
+{
+    std::unique_lock guard{sweep_mutex_};
+    while (!sweep_cv_.wait_for(guard, stop, options_.tick,
+                               [&stop] { return stop.stop_requested(); })) {
+        sweep();
+    }
+}
+
+} // namespace hc
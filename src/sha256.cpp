@@ -0,0 +1,149 @@
+#include <hc/sha256.h>
+
+#include <bit>
+#include <cstring>
+
+namespace hc {
+
+namespace {
+
+constexpr std::array<std::uint32_t, 64> k{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+constexpr std::array<std::uint32_t, 8> initial_state{
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+std::uint32_t load_be32(std::uint8_t const *p) noexcept
+{
+    return (std::uint32_t{p[0]} << 24) | (std::uint32_t{p[1]} << 16) |
+           (std::uint32_t{p[2]} << 8) | std::uint32_t{p[3]};
+}
+
+} // namespace
+
+Sha256::Sha256() noexcept : state_{initial_state} {}
+
+void Sha256::update(std::span<char const> data) noexcept
+{
+    auto const *p = reinterpret_cast<std::uint8_t const *>(data.data());
+    auto n = data.size();
+    length_ += n;
+
+    if (buffered_ != 0) {
+        auto const take = std::min(n, buffer_.size() - buffered_);
+        std::memcpy(buffer_.data() + buffered_, p, take);
+        buffered_ += take;
+        p += take;
+        n -= take;
+        if (buffered_ != buffer_.size()) {
+            return;
+        }
+        compress(buffer_.data());
+        buffered_ = 0;
+    }
+    // Whole blocks are compressed in place, without copying.
+    for (; n >= buffer_.size(); p += buffer_.size(), n -= buffer_.size()) {
+        compress(p);
+    }
+    std::memcpy(buffer_.data(), p, n);
+    buffered_ = n;
+}
+
+Sha256::Digest Sha256::finish() noexcept
+{
+    auto const bits = length_ * 8;
+    buffer_[buffered_++] = 0x80;
+    if (buffered_ > buffer_.size() - 8) {
+        std::memset(buffer_.data() + buffered_, 0, buffer_.size() - buffered_);
+        compress(buffer_.data());
+        buffered_ = 0;
+    }
+    std::memset(buffer_.data() + buffered_, 0, buffer_.size() - 8 - buffered_);
+    for (auto i = 0; i != 8; ++i) {
+        buffer_[buffer_.size() - 1 - i] =
+            static_cast<std::uint8_t>(bits >> (8 * i));
+    }
+    compress(buffer_.data());
+
+    Digest digest{};
+    for (auto i = 0UZ; i != state_.size(); ++i) {
+        for (auto j = 0UZ; j != 4; ++j) {
+            digest[(4 * i) + j] =
+                static_cast<std::uint8_t>(state_[i] >> (24 - (8 * j)));
+        }
+    }
+    return digest;
+}
+
+std::string Sha256::hex_digest()
+{
+    return hex(finish());
+}
+
+std::string Sha256::hex(Digest const &digest)
+{
+    constexpr std::string_view digits = "0123456789abcdef";
+    std::string res;
+    res.reserve(digest.size() * 2);
+    for (auto const b : digest) {
+        res.push_back(digits[b >> 4]);
+        res.push_back(digits[b & 0xF]);
+    }
+    return res;
+}
+
+void Sha256::compress(std::uint8_t const *block) noexcept
+{
+    std::array<std::uint32_t, 64> w{};
+    for (auto i = 0UZ; i != 16; ++i) {
+        w[i] = load_be32(block + (4 * i));
+    }
+    for (auto i = 16UZ; i != 64; ++i) {
+        auto const s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^
+                        (w[i - 15] >> 3);
+        auto const s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^
+                        (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    auto [a, b, c, d, e, f, g, h] = state_;
+    for (auto i = 0UZ; i != 64; ++i) {
+        auto const s1 = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+        auto const ch = (e & f) ^ (~e & g);
+        auto const t1 = h + s1 + ch + k[i] + w[i];
+        auto const s0 = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+        auto const maj = (a & b) ^ (a & c) ^ (b & c);
+        auto const t2 = s0 + maj;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+    state_[4] += e;
+    state_[5] += f;
+    state_[6] += g;
+    state_[7] += h;
+}
+
+} // namespace hc
@@ -0,0 +1,319 @@
+#include <hc/similarity.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <format>
+#include <semaphore>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define HC_SIMILARITY_X86 1
+#include <immintrin.h>
+#endif
+
+namespace hc::similarity {
+
+namespace {
+
+std::uint64_t and_count_scalar(std::uint64_t const *a, std::uint64_t const *b,
+                               std::size_t n) noexcept
+{
+    std::uint64_t total{};
+    for (auto i = 0UZ; i != n; ++i) {
+        total += static_cast<std::uint64_t>(std::popcount(a[i] & b[i]));
+    }
+    return total;
+}
+
+#ifdef HC_SIMILARITY_X86
+// Mula's popcount: bytes are counted by looking up both nibbles with
+// pshufb, then summed into 64-bit lanes by psadbw.
+__attribute__((target("avx2"))) std::uint64_t
+and_count_avx2(std::uint64_t const *a, std::uint64_t const *b,
+               std::size_t n) noexcept
+{
+    auto const lookup =
+        _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, //
+                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    auto const low = _mm256_set1_epi8(0x0f);
+    auto acc = _mm256_setzero_si256();
+    auto i = 0UZ;
+    for (; i + 4 <= n; i += 4) {
+        auto const v = _mm256_and_si256(
+            _mm256_loadu_si256(reinterpret_cast<__m256i const *>(a + i)),
+            _mm256_loadu_si256(reinterpret_cast<__m256i const *>(b + i)));
+        auto const lo = _mm256_and_si256(v, low);
+        auto const hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+        auto const bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                           _mm256_shuffle_epi8(lookup, hi));
+        acc = _mm256_add_epi64(
+            acc, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+    }
+    auto total = static_cast<std::uint64_t>(_mm256_extract_epi64(acc, 0)) +
+                 static_cast<std::uint64_t>(_mm256_extract_epi64(acc, 1)) +
+                 static_cast<std::uint64_t>(_mm256_extract_epi64(acc, 2)) +
+                 static_cast<std::uint64_t>(_mm256_extract_epi64(acc, 3));
+    return total + and_count_scalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx512f,avx512vpopcntdq"))) std::uint64_t
+and_count_avx512(std::uint64_t const *a, std::uint64_t const *b,
+                 std::size_t n) noexcept
+{
+    auto acc = _mm512_setzero_si512();
+    auto i = 0UZ;
+    for (; i + 8 <= n; i += 8) {
+        auto const v = _mm512_and_si512(_mm512_loadu_si512(a + i),
+                                        _mm512_loadu_si512(b + i));
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+    }
+    auto const total =
+        static_cast<std::uint64_t>(_mm512_reduce_add_epi64(acc));
+    return total + and_count_scalar(a + i, b + i, n - i);
+}
+#endif
+
+// Widest bitset, 64 KiB, which a set hits only when near the cap of
+// fingerprints of a document.
+constexpr auto max_bits = std::size_t{1} << 19;
+constexpr auto min_bits = 512UZ;
+
+// Rows of both blocks of a tile stay within this.
+constexpr auto tile_bytes = std::size_t{256} << 10;
+
+// Threads helping callers of `matrix()`, shared by concurrent calls.
+std::counting_semaphore<> &helpers()
+{
+    static std::counting_semaphore<> helpers{static_cast<std::ptrdiff_t>(
+        std::max(1U, std::thread::hardware_concurrency()) - 1)};
+    return helpers;
+}
+
+// Helpers taken by a call, given back when it returns.
+class Lease {
+  public:
+    explicit Lease(std::size_t wanted)
+    {
+        while (taken_ != wanted && helpers().try_acquire()) {
+            ++taken_;
+        }
+    }
+
+    Lease(Lease const &) = delete;
+    Lease(Lease &&) = delete;
+    Lease &operator=(Lease const &) = delete;
+    Lease &operator=(Lease &&) = delete;
+
+    ~Lease()
+    {
+        helpers().release(static_cast<std::ptrdiff_t>(taken_));
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return taken_;
+    }
+
+  private:
+    std::size_t taken_{};
+};
+
+float similarity(Measure measure, std::uint64_t both, std::uint64_t a,
+                 std::uint64_t b) noexcept
+{
+    auto const denominator =
+        measure == Measure::jaccard ? a + b - both : std::min(a, b);
+    return denominator == 0 ? 0.0F
+                            : static_cast<float>(both) /
+                                  static_cast<float>(denominator);
+}
+
+} // namespace
+
+std::string_view to_string(Kernel kernel) noexcept
+{
+    switch (kernel) {
+    case Kernel::scalar:
+        return "scalar";
+    case Kernel::avx2:
+        return "avx2";
+    case Kernel::avx512:
+        return "avx512";
+    }
+    std::unreachable();
+}
+
+std::optional<Kernel> kernel_from_name(std::string_view name)
+{
+    for (auto const k : {Kernel::scalar, Kernel::avx2, Kernel::avx512}) {
+        if (to_string(k) == name) {
+            return k;
+        }
+    }
+    return std::nullopt;
+}
+
+bool supported(Kernel kernel) noexcept
+{
+#ifdef HC_SIMILARITY_X86
+    switch (kernel) {
+    case Kernel::scalar:
+        return true;
+    case Kernel::avx2:
+        return __builtin_cpu_supports("avx2") != 0;
+    case Kernel::avx512:
+        return __builtin_cpu_supports("avx512f") != 0 &&
+               __builtin_cpu_supports("avx512vpopcntdq") != 0;
+    }
+#endif
+    return kernel == Kernel::scalar;
+}
+
+Kernel best_kernel() noexcept
+{
+    static auto const best = [] {
+        for (auto const k : {Kernel::avx512, Kernel::avx2}) {
+            if (supported(k)) {
+                return k;
+            }
+        }
+        return Kernel::scalar;
+    }();
+    return best;
+}
+
+std::uint64_t and_count(std::span<std::uint64_t const> a,
+                        std::span<std::uint64_t const> b, Kernel kernel)
+{
+    auto const n = std::min(a.size(), b.size());
+    switch (kernel) {
+#ifdef HC_SIMILARITY_X86
+    case Kernel::avx2:
+        return and_count_avx2(a.data(), b.data(), n);
+    case Kernel::avx512:
+        return and_count_avx512(a.data(), b.data(), n);
+#endif
+    default:
+        return and_count_scalar(a.data(), b.data(), n);
+    }
+}
+
+Sketches::Sketches(std::span<hc::plagiarism::Fingerprints const> sets)
+{
+    auto largest = 0UZ;
+    for (auto const &s : sets) {
+        largest = std::max(largest, s.size());
+    }
+    auto const bits =
+        std::clamp(std::bit_ceil(largest * 16), min_bits, max_bits);
+    words_ = bits / 64;
+
+    bits_.resize(sets.size() * words_);
+    counts_.reserve(sets.size());
+    for (auto i = 0UZ; i != sets.size(); ++i) {
+        auto *const row = bits_.data() + (i * words_);
+        // Fingerprints are mixed hashes already, so low bits do as an index.
+        for (auto const f : sets[i]) {
+            auto const bit = f & (bits - 1);
+            row[bit / 64] |= std::uint64_t{1} << (bit % 64);
+        }
+        counts_.push_back(and_count_scalar(row, row, words_));
+    }
+}
+
+std::size_t Sketches::size() const noexcept
+{
+    return counts_.size();
+}
+
+std::size_t Sketches::words() const noexcept
+{
+    return words_;
+}
+
+std::span<std::uint64_t const>
+Sketches::operator[](std::size_t i) const noexcept
+{
+    return {bits_.data() + (i * words_), words_};
+}
+
+std::uint64_t Sketches::count(std::size_t i) const noexcept
+{
+    return counts_[i];
+}
+
+std::optional<Measure> measure_from_name(std::string_view name)
+{
+    if (name == "jaccard") {
+        return Measure::jaccard;
+    }
+    if (name == "containment") {
+        return Measure::containment;
+    }
+    return std::nullopt;
+}
+
+std::vector<float> matrix(Sketches const &sketches,
+                          MatrixOptions const &options)
+{
+    if (!supported(options.kernel)) {
+        throw std::invalid_argument{std::format(
+            "Kernel {} isn't supported by the CPU", to_string(options.kernel))};
+    }
+    auto const n = sketches.size();
+    std::vector<float> m(n * n);
+    if (n == 0) {
+        return m;
+    }
+
+    auto const tile = std::clamp<std::size_t>(
+        tile_bytes / (2 * sketches.words() * sizeof(std::uint64_t)), 1, 128);
+    auto const blocks = (n + tile - 1) / tile;
+    std::vector<std::pair<std::size_t, std::size_t>> tiles;
+    for (auto bi = 0UZ; bi != blocks; ++bi) {
+        for (auto bj = bi; bj != blocks; ++bj) {
+            tiles.emplace_back(bi, bj);
+        }
+    }
+
+    std::atomic<std::size_t> next{};
+    auto const work = [&] {
+        for (auto t = next++; t < tiles.size(); t = next++) {
+            auto const [bi, bj] = tiles[t];
+            for (auto i = bi * tile; i != std::min(n, (bi + 1) * tile); ++i) {
+                // Within a diagonal tile, only its upper triangle.
+                auto const first = bi == bj ? i + 1 : bj * tile;
+                for (auto j = first; j < std::min(n, (bj + 1) * tile); ++j) {
+                    auto const both =
+                        and_count(sketches[i], sketches[j], options.kernel);
+                    m[(i * n) + j] = m[(j * n) + i] =
+                        similarity(options.measure, both, sketches.count(i),
+                                   sketches.count(j));
+                }
+            }
+        }
+    };
+    auto threads = options.threads != 0
+                       ? options.threads
+                       : std::max(1U, std::thread::hardware_concurrency());
+    threads = std::min(threads, tiles.size());
+    {
+        // Joined before the lease is given back.
+        Lease const lease{threads - 1};
+        std::vector<std::jthread> workers;
+        for (auto i = 0UZ; i != lease.size(); ++i) {
+            workers.emplace_back(work);
+        }
+        work();
+    }
+
+    for (auto i = 0UZ; i != n; ++i) {
+        m[(i * n) + i] = sketches.count(i) == 0 ? 0.0F : 1.0F;
+    }
+    return m;
+}
+
+} // namespace hc::similarity
@@ -0,0 +1,156 @@
+#include <hc/task-queue.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+namespace hc {
+
+WorkStealingQueue::Ring::Ring(std::size_t capacity)
+    : cells_{std::make_unique<Cell[]>(capacity)}, mask_{capacity - 1}
+{
+    for (auto i = 0UZ; i != capacity; ++i) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool WorkStealingQueue::Ring::push(std::function<void()> &task)
+{
+    auto pos = tail_.load(std::memory_order_relaxed);
+    while (true) {
+        auto &cell = cells_[pos & mask_];
+        auto const seq = cell.sequence.load(std::memory_order_acquire);
+        auto const diff =
+            static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+        if (diff == 0) {
+            if (tail_.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed)) {
+                cell.task = std::move(task);
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0) {
+            return false; // Full
+        }
+        else {
+            pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool WorkStealingQueue::Ring::pop(std::function<void()> &task)
+{
+    auto pos = head_.load(std::memory_order_relaxed);
+    while (true) {
+        auto &cell = cells_[pos & mask_];
+        auto const seq = cell.sequence.load(std::memory_order_acquire);
+        auto const diff = static_cast<std::intptr_t>(seq) -
+                          static_cast<std::intptr_t>(pos + 1);
+        if (diff == 0) {
+            if (head_.compare_exchange_weak(pos, pos + 1,
+                                            std::memory_order_relaxed)) {
+                task = std::move(cell.task);
+                cell.task = nullptr;
+                cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0) {
+            return false; // Empty
+        }
+        else {
+            pos = head_.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+WorkStealingQueue::WorkStealingQueue(std::size_t workers,
+                                     std::size_t max_queued)
+{
+    workers = std::max(workers, 1UZ);
+    auto const capacity =
+        std::bit_ceil(std::max((max_queued + workers - 1) / workers, 2UZ));
+    rings_.reserve(workers);
+    for (auto i = 0UZ; i != workers; ++i) {
+        rings_.push_back(std::make_unique<Ring>(capacity));
+    }
+    workers_.reserve(workers);
+    for (auto i = 0UZ; i != workers; ++i) {
+        workers_.emplace_back([this, i] { run(i); });
+    }
+}
+
+WorkStealingQueue::~WorkStealingQueue()
+{
+    shutdown();
+}
+
+bool WorkStealingQueue::enqueue(std::function<void()> fn)
+{
+    if (stopping_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    auto const n = rings_.size();
+    auto const first = next_.fetch_add(1, std::memory_order_relaxed);
+    // Another ring takes it if the chosen one is full.
+    for (auto i = 0UZ; i != n; ++i) {
+        if (rings_[(first + i) % n]->push(fn)) {
+            epoch_.fetch_add(1, std::memory_order_release);
+            epoch_.notify_one();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingQueue::shutdown()
+{
+    if (stopping_.exchange(true)) {
+        return;
+    }
+    epoch_.fetch_add(1, std::memory_order_release);
+    epoch_.notify_all();
+    workers_.clear(); // Joins
+}
+
+void WorkStealingQueue::run(std::size_t self)
+{
+    std::function<void()> task;
+    while (true) {
+        if (take(self, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+        // A push after this load bumps the epoch, so the wait below returns
+        // at once rather than missing it.
+        auto const seen = epoch_.load(std::memory_order_acquire);
+        if (take(self, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+        if (stopping_.load(std::memory_order_acquire)) {
+            return;
+        }
+        epoch_.wait(seen, std::memory_order_acquire);
+    }
+}
+
+bool WorkStealingQueue::take(std::size_t self, std::function<void()> &task)
+{
+    if (rings_[self]->pop(task)) {
+        return true;
+    }
+    auto const n = rings_.size();
+    for (auto i = 1UZ; i != n; ++i) {
+        if (rings_[(self + i) % n]->pop(task)) {
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace hc
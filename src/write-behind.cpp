@@ -0,0 +1,354 @@
+#include <hc/write-behind.h>
+
+#include <hc/schema/AigcScore.h>
+#include <hc/schema/Assignment.h>
+#include <hc/schema/Student.h>
+#include <hc/schema/Submission.h>
+#include <hc/schema/SubmissionFingerprint.h>
+#include <hc/schema/SubmissionSignature.h>
+#include <hc/schema/Teacher.h>
+
+#include <algorithm>
+#include <map>
+#include <span>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+namespace hc::db {
+
+namespace {
+
+using Run = std::span<Mutation const *const>;
+
+// Rows per multi-row INSERT. Keeps statements in a sane size.
+constexpr auto max_rows = 1000UZ;
+
+// Student IDs of `latest` by assignment, so that their rows are deleted with
+// one `student_id IN (...)` per assignment rather than one statement per row.
+// sqlpp has no row values for `(assignment_name, student_id) IN (...)`.
+template <typename T>
+std::map<std::string, std::vector<std::string>>
+by_assignment(std::map<std::pair<std::string, std::string>, T> const &latest)
+{
+    std::map<std::string, std::vector<std::string>> ids;
+    for (auto const &[key, _] : latest) {
+        ids[key.first].push_back(key.second);
+    }
+    return ids;
+}
+
+void insert_students(ConnectionPool::Handle &db, Run run)
+{
+    constexpr auto ts = schema::Student{};
+    auto insert = sqlpp::insert_into(ts).columns(ts.student_id, ts.name);
+    for (auto const *m : run) {
+        auto const &s = std::get<InsertStudent>(*m).student;
+        insert.add_values(ts.student_id = s.student_id, ts.name = s.name);
+    }
+    db(insert);
+}
+
+void insert_teachers(ConnectionPool::Handle &db, Run run)
+{
+    constexpr auto tt = schema::Teacher{};
+    auto insert =
+        sqlpp::insert_into(tt).columns(tt.teacher_id, tt.name, tt.password);
+    for (auto const *m : run) {
+        auto const &t = std::get<InsertTeacher>(*m).teacher;
+        insert.add_values(tt.teacher_id = t.teacher_id, tt.name = t.name,
+                          tt.password = t.password);
+    }
+    db(insert);
+}
+
+void insert_assignments(ConnectionPool::Handle &db, Run run)
+{
+    constexpr auto ta = schema::Assignment{};
+    auto insert =
+        sqlpp::insert_into(ta).columns(ta.name, ta.start_time, ta.end_time);
+    for (auto const *m : run) {
+        auto const &a = std::get<InsertAssignment>(*m);
+        insert.add_values(ta.name = a.name, ta.start_time = a.start_time,
+                          ta.end_time = a.end_time);
+    }
+    db(insert);
+}
+
+void upsert_submissions(ConnectionPool::Handle &db, Run run)
+{
+    // Only the last upsert of a key in the run matters.
+    std::map<std::pair<std::string, std::string>, Submission const *> latest;
+    for (auto const *m : run) {
+        auto const &s = std::get<UpsertSubmission>(*m).submission;
+        latest[{s.assignment_name, s.student_id}] = &s;
+    }
+
+    constexpr auto ts = schema::Submission{};
+    for (auto const &[assignment_name, student_ids] : by_assignment(latest)) {
+        db(sqlpp::delete_from(ts).where(ts.assignment_name == assignment_name &&
+                                        ts.student_id.in(student_ids)));
+    }
+
+    auto insert = sqlpp::insert_into(ts).columns(
+        ts.student_id, ts.submission_time, ts.assignment_name,
+        ts.original_filename, ts.filepath, ts.content_hash);
+    for (auto const &[_, s] : latest) {
+        insert.add_values(ts.student_id = s->student_id,
+                          ts.submission_time = s->submission_time,
+                          ts.assignment_name = s->assignment_name,
+                          ts.original_filename = s->original_filename,
+                          ts.filepath = s->filepath.string(),
+                          ts.content_hash =
+                              s->content_hash.empty()
+                                  ? std::nullopt
+                                  : std::optional{s->content_hash});
+    }
+    db(insert);
+}
+
+void upsert_fingerprints(ConnectionPool::Handle &db, Run run)
+{
+    std::map<std::pair<std::string, std::string>, UpsertFingerprints const *>
+        latest;
+    for (auto const *m : run) {
+        auto const &f = std::get<UpsertFingerprints>(*m);
+        latest[{f.assignment_name, f.student_id}] = &f;
+    }
+
+    constexpr auto tf = schema::SubmissionFingerprint{};
+    for (auto const &[assignment_name, student_ids] : by_assignment(latest)) {
+        db(sqlpp::delete_from(tf).where(tf.assignment_name == assignment_name &&
+                                        tf.student_id.in(student_ids)));
+    }
+
+    auto insert = sqlpp::insert_into(tf).columns(
+        tf.assignment_name, tf.student_id, tf.fingerprints);
+    for (auto const &[_, f] : latest) {
+        insert.add_values(
+            tf.assignment_name = f->assignment_name,
+            tf.student_id = f->student_id,
+            tf.fingerprints = hc::plagiarism::pack(f->fingerprints));
+    }
+    db(insert);
+}
+
+void upsert_signatures(ConnectionPool::Handle &db, Run run)
+{
+    std::map<std::pair<std::string, std::string>, UpsertSignature const *>
+        latest;
+    for (auto const *m : run) {
+        auto const &s = std::get<UpsertSignature>(*m);
+        latest[{s.assignment_name, s.student_id}] = &s;
+    }
+
+    constexpr auto ts = schema::SubmissionSignature{};
+    for (auto const &[assignment_name, student_ids] : by_assignment(latest)) {
+        db(sqlpp::delete_from(ts).where(ts.assignment_name == assignment_name &&
+                                        ts.student_id.in(student_ids)));
+    }
+
+    auto insert = sqlpp::insert_into(ts).columns(ts.assignment_name,
+                                                 ts.student_id, ts.signature);
+    for (auto const &[_, s] : latest) {
+        insert.add_values(ts.assignment_name = s->assignment_name,
+                          ts.student_id = s->student_id,
+                          ts.signature = hc::minhash::pack(s->signature));
+    }
+    db(insert);
+}
+
+void upsert_aigc_scores(ConnectionPool::Handle &db, Run run)
+{
+    std::map<std::string, double> latest;
+    for (auto const *m : run) {
+        auto const &s = std::get<UpsertAigcScore>(*m);
+        latest[s.content_hash] = s.score;
+    }
+
+    constexpr auto ta = schema::AigcScore{};
+    std::vector<std::string> hashes;
+    hashes.reserve(latest.size());
+    for (auto const &[hash, _] : latest) {
+        hashes.push_back(hash);
+    }
+    db(sqlpp::delete_from(ta).where(ta.content_hash.in(hashes)));
+
+    auto insert = sqlpp::insert_into(ta).columns(ta.content_hash, ta.score);
+    for (auto const &[hash, score] : latest) {
+        insert.add_values(ta.content_hash = hash, ta.score = score);
+    }
+    db(insert);
+}
+
+} // namespace
+
+WriteBehind::WriteBehind(ConnectionPool &pool, Durability durability,
+                         std::size_t max_batch)
+    : pool_{pool}, durability_{durability}, max_batch_{max_batch},
+      writer_{std::bind_front(&WriteBehind::run, this)}
+{
+}
+
+WriteBehind::~WriteBehind()
+{
+    // jthread requests stop and joins, and the writer drains the queue before
+    // exiting.
+    writer_.request_stop();
+}
+
+std::shared_future<void> WriteBehind::enqueue(std::vector<Mutation> mutations)
+{
+    Group g{.mutations{std::move(mutations)}, .committed{}};
+    auto f = g.committed.get_future().share();
+    {
+        std::scoped_lock guard{mutex_};
+        queue_.push_back(std::move(g));
+    }
+    cv_.notify_one();
+    return f;
+}
+
+std::shared_future<void> WriteBehind::enqueue(Mutation mutation)
+{
+    std::vector<Mutation> v;
+    v.push_back(std::move(mutation));
+    return enqueue(std::move(v));
+}
+
+void WriteBehind::wait_ack(std::shared_future<void> const &persisted) const
+{
+    if (durability_ == Durability::commit) {
+        persisted.get();
+    }
+}
+
+void WriteBehind::flush()
+{
+    std::unique_lock guard{mutex_};
+    drained_.wait(guard, [this] { return queue_.empty() && !writing_; });
+}
+
+Durability WriteBehind::durability() const noexcept
+{
+    return durability_;
+}
+
+void WriteBehind::run(std::stop_token stop)
+{
+    while (true) {
+        std::vector<Group> batch;
+        {
+            std::unique_lock guard{mutex_};
+            cv_.wait(guard, stop, [this] { return !queue_.empty(); });
+            if (queue_.empty()) { // Stop requested and nothing left
+                return;
+            }
+            auto rows = 0UZ;
+            while (!queue_.empty() &&
+                   (batch.empty() ||
+                    rows + queue_.front().mutations.size() <= max_batch_)) {
+                rows += queue_.front().mutations.size();
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+            writing_ = true;
+        }
+
+        commit(batch);
+
+        {
+            std::scoped_lock guard{mutex_};
+            writing_ = false;
+        }
+        drained_.notify_all();
+    }
+}
+
+void WriteBehind::commit(std::vector<Group> &groups)
+{
+    try {
+        auto db = pool_.acquire();
+        auto tx = sqlpp::start_transaction(*db);
+        execute(db, groups);
+        tx.commit();
+        for (auto &g : groups) {
+            g.committed.set_value();
+        }
+        spdlog::debug("Committed {} groups of mutations", groups.size());
+        return;
+    }
+    catch (std::exception const &e) {
+        spdlog::warn("Group commit of {} groups failed: {}", groups.size(),
+                     e.what());
+    }
+
+    // Retries one by one, so that one bad group doesn't fail the others.
+    for (auto &g : groups) {
+        try {
+            auto db = pool_.acquire();
+            auto tx = sqlpp::start_transaction(*db);
+            execute(db, std::span{&g, 1});
+            tx.commit();
+            g.committed.set_value();
+        }
+        catch (std::exception const &e) {
+            spdlog::error("Failed to persist mutations: {}", e.what());
+            g.committed.set_exception(std::current_exception());
+        }
+    }
+}
+
+void WriteBehind::execute(ConnectionPool::Handle &db, std::span<Group> groups)
+{
+    std::vector<Mutation const *> ms;
+    for (auto const &g : groups) {
+        for (auto const &m : g.mutations) {
+            ms.push_back(&m);
+        }
+    }
+
+    // Mutations of the same kind are coalesced into one statement. Groups
+    // interleave kinds, e.g. a submission and its fingerprints, so they're
+    // sorted by kind first. Kinds touch separate tables, and `Mutation`
+    // lists them in the order foreign keys need, so only order within a
+    // kind matters, which the stable sort keeps.
+    std::ranges::stable_sort(
+        ms, {}, [](Mutation const *m) { return m->index(); });
+    for (auto i = 0UZ; i != ms.size();) {
+        auto j = i;
+        while (j != ms.size() && j - i != max_rows &&
+               ms[j]->index() == ms[i]->index()) {
+            ++j;
+        }
+        auto const run = Run{ms}.subspan(i, j - i);
+        std::visit(
+            [&]<typename T>(T const &) {
+                if constexpr (std::is_same_v<T, InsertStudent>) {
+                    insert_students(db, run);
+                }
+                else if constexpr (std::is_same_v<T, InsertTeacher>) {
+                    insert_teachers(db, run);
+                }
+                else if constexpr (std::is_same_v<T, InsertAssignment>) {
+                    insert_assignments(db, run);
+                }
+                else if constexpr (std::is_same_v<T, UpsertSubmission>) {
+                    upsert_submissions(db, run);
+                }
+                else if constexpr (std::is_same_v<T, UpsertFingerprints>) {
+                    upsert_fingerprints(db, run);
+                }
+                else if constexpr (std::is_same_v<T, UpsertSignature>) {
+                    upsert_signatures(db, run);
+                }
+                else {
+                    static_assert(std::is_same_v<T, UpsertAigcScore>);
+                    upsert_aigc_scores(db, run);
+                }
+            },
+            *ms[i]);
+        i = j;
+    }
+}
+
+} // namespace hc::db
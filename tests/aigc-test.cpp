@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <atomic>
+#include <gtest/gtest.h>
+#include <hc/aigc.h>
+#include <httplib.h>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// Stands in for the scoring model: a text scores its length in percent.
+class StubService {
+  public:
+    StubService()
+    {
+        server_.Post("/score", [this](httplib::Request const &req,
+                                      httplib::Response &res) {
+            if (failures_.fetch_sub(1) > 0) {
+                res.status = httplib::StatusCode::ServiceUnavailable_503;
+                return;
+            }
+            auto const texts = nlohmann::json::parse(req.body)
+                                   .at("texts")
+                                   .get<std::vector<std::string>>();
+            ++requests_;
+            if (std::ranges::any_of(texts, &std::string::empty) ||
+                rejections_.fetch_sub(1) > 0) {
+                res.status = httplib::StatusCode::BadRequest_400;
+                return;
+            }
+            std::vector<double> scores;
+            for (auto const &t : texts) {
+                scores.push_back(static_cast<double>(t.size()) / 100);
+            }
+            {
+                std::scoped_lock guard{mutex_};
+                batches_.push_back(texts.size());
+            }
+            res.set_content(nlohmann::json{{"scores", scores}}.dump(),
+                            "application/json");
+        });
+        port_ = server_.bind_to_any_port("127.0.0.1");
+        thread_ = std::jthread{[this] { server_.listen_after_bind(); }};
+        server_.wait_until_ready();
+    }
+
+    StubService(StubService const &) = delete;
+    StubService(StubService &&) = delete;
+    StubService &operator=(StubService const &) = delete;
+    StubService &operator=(StubService &&) = delete;
+
+    ~StubService()
+    {
+        server_.stop();
+    }
+
+    [[nodiscard]] std::string endpoint() const
+    {
+        return std::format("http://127.0.0.1:{}/score", port_);
+    }
+
+    void fail_next(int n)
+    {
+        failures_ = n;
+    }
+
+    void reject_next(int n)
+    {
+        rejections_ = n;
+    }
+
+    // Requests that came through, i.e. not failed with 503.
+    [[nodiscard]] int requests() const
+    {
+        return requests_;
+    }
+
+    std::vector<std::size_t> batches()
+    {
+        std::scoped_lock guard{mutex_};
+        return batches_;
+    }
+
+  private:
+    httplib::Server server_;
+    int port_{};
+    std::atomic_int failures_{};
+    std::atomic_int rejections_{};
+    std::atomic_int requests_{};
+    std::mutex mutex_;
+    std::vector<std::size_t> batches_;
+    std::jthread thread_;
+};
+
+struct Collected {
+    std::mutex mutex;
+    std::map<std::string, double> scores;
+    std::atomic_int texts_read;
+};
+
+std::unique_ptr<hc::aigc::Scorer> make_scorer(StubService const &stub,
+                                              Collected &c,
+                                              std::size_t max_batch)
+{
+    return std::make_unique<hc::aigc::Scorer>(
+        hc::aigc::ScorerOptions{.endpoint = stub.endpoint(),
+                                .max_batch = max_batch,
+                                .max_delay = 50ms,
+                                .retry_delay = 10ms},
+        [&c](hc::aigc::Scorer::Job const &job) {
+            ++c.texts_read;
+            if (job.filename == "unreadable") {
+                throw std::runtime_error{"unreadable"};
+            }
+            if (job.filename == "empty") {
+                return std::string{};
+            }
+            return std::string(job.content_hash.size(), 'x');
+        },
+        [&c](std::span<hc::aigc::Scored const> scored) {
+            std::scoped_lock guard{c.mutex};
+            for (auto const &s : scored) {
+                c.scores[s.content_hash] = s.score;
+            }
+        });
+}
+
+} // namespace
+
+TEST(AigcTest, SplitEndpoint)
+{
+    using P = std::pair<std::string, std::string>;
+    EXPECT_EQ(hc::aigc::split_endpoint("http://127.0.0.1:9000/v1/score"),
+              (P{"http://127.0.0.1:9000", "/v1/score"}));
+    EXPECT_EQ(hc::aigc::split_endpoint("https://scorer"),
+              (P{"https://scorer", "/"}));
+    EXPECT_EQ(hc::aigc::split_endpoint("127.0.0.1:9000/score"), std::nullopt);
+    EXPECT_EQ(hc::aigc::split_endpoint("http:///score"), std::nullopt);
+}
+
+TEST(AigcTest, Batches)
+{
+    StubService stub;
+    Collected c;
+    auto const scorer = make_scorer(stub, c, 4);
+    for (auto i = 1; i <= 10; ++i) {
+        EXPECT_TRUE(scorer->post({.content_hash = std::string(i, 'h'),
+                                  .path{},
+                                  .filename{"a.txt"}}));
+    }
+    // Queued already.
+    EXPECT_TRUE(scorer->post(
+        {.content_hash = std::string(1, 'h'), .path{}, .filename{"a.txt"}}));
+    EXPECT_TRUE(scorer->post(
+        {.content_hash = "bad", .path{}, .filename{"unreadable"}}));
+    scorer->drain();
+
+    std::scoped_lock guard{c.mutex};
+    ASSERT_EQ(c.scores.size(), 10U);
+    EXPECT_DOUBLE_EQ(c.scores.at("hhh"), 0.03);
+    EXPECT_FALSE(c.scores.contains("bad"));
+    EXPECT_EQ(c.texts_read, 11);
+    auto const batches = stub.batches();
+    EXPECT_LT(batches.size(), 10U);
+    for (auto const b : batches) {
+        EXPECT_LE(b, 4U);
+    }
+}
+
+TEST(AigcTest, RetriesFailedBatches)
+{
+    StubService stub;
+    stub.fail_next(2);
+    Collected c;
+    auto const scorer = make_scorer(stub, c, 16);
+    EXPECT_TRUE(scorer->post(
+        {.content_hash = "hash", .path{}, .filename{"a.txt"}}));
+    scorer->drain();
+
+    std::scoped_lock guard{c.mutex};
+    EXPECT_EQ(c.scores.size(), 1U);
+    // Texts are read again, as nothing is kept while waiting to retry.
+    EXPECT_EQ(c.texts_read, 3);
+}
+
+TEST(AigcTest, SkipsEmptyTexts)
+{
+    StubService stub;
+    Collected c;
+    auto const scorer = make_scorer(stub, c, 16);
+    EXPECT_TRUE(scorer->post(
+        {.content_hash = "image", .path{}, .filename{"empty"}}));
+    scorer->drain();
+    EXPECT_TRUE(scorer->post(
+        {.content_hash = "hash", .path{}, .filename{"a.txt"}}));
+    scorer->drain();
+
+    std::scoped_lock guard{c.mutex};
+    EXPECT_FALSE(c.scores.contains("image"));
+    EXPECT_TRUE(c.scores.contains("hash"));
+    // Never sent.
+    EXPECT_EQ(stub.requests(), 1);
+}
+
+TEST(AigcTest, DropsRejectedBatches)
+{
+    StubService stub;
+    stub.reject_next(1);
+    Collected c;
+    auto const scorer = make_scorer(stub, c, 16);
+    EXPECT_TRUE(scorer->post(
+        {.content_hash = "hash", .path{}, .filename{"a.txt"}}));
+    scorer->drain();
+    {
+        std::scoped_lock guard{c.mutex};
+        EXPECT_TRUE(c.scores.empty());
+    }
+    EXPECT_EQ(stub.requests(), 1);
+
+    // Not pending any more, so it may be posted again.
+    EXPECT_TRUE(scorer->post(
+        {.content_hash = "hash", .path{}, .filename{"a.txt"}}));
+    scorer->drain();
+    std::scoped_lock guard{c.mutex};
+    EXPECT_EQ(c.scores.size(), 1U);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
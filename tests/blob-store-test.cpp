@@ -0,0 +1,123 @@
+#include <fstream>
+#include <gtest/gtest.h>
+#include <hc/blob-store.h>
+#include <hc/sha256.h>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string sha256(std::string_view s)
+{
+    hc::Sha256 sha;
+    sha.update(s);
+    return sha.hex_digest();
+}
+
+std::string read_file(fs::path const &path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>{ifs}, {}};
+}
+
+} // namespace
+
+TEST(BlobStoreTest, Sha256)
+{
+    EXPECT_EQ(sha256(""),
+              "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    EXPECT_EQ(sha256("abc"),
+              "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    EXPECT_EQ(
+        sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    EXPECT_EQ(sha256(std::string(1'000'000, 'a')),
+              "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+    // Chunks split across block boundaries hash as a whole.
+    std::string data;
+    for (auto i = 0; i != 1000; ++i) {
+        data += std::to_string(i);
+    }
+    hc::Sha256 chunked;
+    for (std::size_t i = 0, n = 1; i < data.size(); i += n, n = (n * 7) % 97) {
+        chunked.update(std::string_view{data}.substr(i, n));
+    }
+    EXPECT_EQ(chunked.hex_digest(), sha256(data));
+}
+
+TEST(BlobStoreTest, Deduplicate)
+{
+    auto const root = fs::temp_directory_path() / "hc" / "test blobs";
+    fs::remove_all(root);
+    hc::BlobStore store(root);
+
+    std::string const content(100'000, 'x');
+    auto const a = store.put(content);
+    EXPECT_EQ(a, sha256(content));
+    EXPECT_EQ(read_file(store.path(a)), content);
+
+    std::string b;
+    {
+        hc::BlobStore::Writer w(store);
+        for (auto i = 0UZ; i < content.size(); i += 4096) {
+            w.write(std::string_view{content}.substr(i, 4096));
+        }
+        b = w.commit();
+    }
+    EXPECT_EQ(b, a);
+    EXPECT_EQ(store.references(a), 2U);
+    EXPECT_TRUE(fs::is_empty(root / "tmp"));
+
+    store.release(a);
+    EXPECT_TRUE(fs::exists(store.path(a)));
+    store.release(a);
+    EXPECT_FALSE(fs::exists(store.path(a)));
+    EXPECT_EQ(store.references(a), 0U);
+
+    fs::remove_all(root);
+}
+
+TEST(BlobStoreTest, Uncommitted)
+{
+    auto const root = fs::temp_directory_path() / "hc" / "test blobs";
+    fs::remove_all(root);
+    hc::BlobStore store(root);
+    {
+        hc::BlobStore::Writer w(store);
+        w.write(std::string_view{"abandoned"});
+    }
+    EXPECT_TRUE(fs::is_empty(root / "tmp"));
+    fs::remove_all(root);
+}
+
+TEST(BlobStoreTest, CollectGarbage)
+{
+    auto const root = fs::temp_directory_path() / "hc" / "test blobs";
+    fs::remove_all(root);
+    std::string kept;
+    std::string dropped;
+    {
+        hc::BlobStore store(root);
+        kept = store.put(std::string_view{"kept"});
+        dropped = store.put(std::string_view{"dropped"});
+    }
+
+    // As after a restart, with only `kept` still referenced.
+    hc::BlobStore store(root);
+    store.retain(kept);
+    EXPECT_EQ(store.collect_garbage(std::chrono::hours{1}), 0U);
+    EXPECT_EQ(store.collect_garbage(std::chrono::seconds{0}), 1U);
+    EXPECT_TRUE(fs::exists(store.path(kept)));
+    EXPECT_FALSE(fs::exists(store.path(dropped)));
+    fs::remove_all(root);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
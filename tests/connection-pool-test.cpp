@@ -0,0 +1,140 @@
+#include <format>
+#include <gtest/gtest.h>
+#include <hc/connection-pool.h>
+#include <pqxx/pqxx>
+#include <thread>
+
+#ifndef HCRE_TEST_DB
+#error [dev] HCRE_TEST_DB not defined, should be defined in CMakeLists.txt
+#endif
+
+using namespace std::chrono_literals;
+using hc::db::ConnectionPool;
+
+namespace {
+
+// Tells connections of the pool apart from others on the server.
+constexpr auto application_name = "hc-connection-pool-test";
+
+class ConnectionPoolTest : public testing::Test {
+  protected:
+    ConnectionPoolTest()
+        : admin_(HCRE_TEST_DB
+#ifdef HCRE_TEST_DB_PASSWORD
+                 " password=" + std::string(HCRE_TEST_DB_PASSWORD)
+#endif // HCRE_TEST_DB_PASSWORD
+          )
+    {
+    }
+
+    ConnectionPool::Config make_config()
+    {
+        auto config = ConnectionPool::Config{};
+        config.host = admin_.hostname();
+        config.dbname = admin_.dbname();
+        config.user = admin_.username();
+#ifdef HCRE_TEST_DB_PASSWORD
+        config.password = HCRE_TEST_DB_PASSWORD;
+#endif // HCRE_TEST_DB_PASSWORD
+        config.application_name = application_name;
+        return config;
+    }
+
+    // Closes connections of the pool from the server side, as an idle
+    // timeout or a restart of the server does, behind the pool's back.
+    void terminate_pool_connections()
+    {
+        auto const filter = std::format(
+            "FROM pg_stat_activity WHERE application_name = '{}'",
+            application_name);
+        pqxx::nontransaction{admin_}.exec("SELECT pg_terminate_backend(pid) " +
+                                          filter);
+        while (pqxx::nontransaction{admin_}.query_value<int>(
+                   "SELECT count(*) " + filter) != 0) {
+            std::this_thread::sleep_for(10ms);
+        }
+    }
+
+  private:
+    pqxx::connection admin_;
+};
+
+} // namespace
+
+TEST_F(ConnectionPoolTest, CountsCheckouts)
+{
+    ConnectionPool pool{make_config(), 2, 50ms, 1h};
+    auto stats = pool.stats();
+    EXPECT_EQ(stats.capacity, 2U);
+    EXPECT_EQ(stats.open, 1U); // Established eagerly
+    EXPECT_EQ(stats.idle, 1U);
+
+    {
+        auto a = pool.acquire();
+        auto b = pool.acquire();
+        stats = pool.stats();
+        EXPECT_EQ(stats.open, 2U);
+        EXPECT_EQ(stats.idle, 0U);
+        // Exhausted.
+        EXPECT_THROW((void)pool.acquire(), std::runtime_error);
+        stats = pool.stats();
+        EXPECT_EQ(stats.waits, 1U);
+        EXPECT_EQ(stats.timeouts, 1U);
+        EXPECT_GE(stats.max_wait_us, 50'000U);
+    }
+
+    // Reused instead of connecting again.
+    pool.acquire()->execute("SELECT 1");
+    stats = pool.stats();
+    EXPECT_EQ(stats.checkouts, 3U);
+    EXPECT_EQ(stats.open, 2U);
+    EXPECT_EQ(stats.idle, 2U);
+    EXPECT_EQ(stats.dropped, 0U);
+    EXPECT_EQ(stats.probes, 0U);
+}
+
+TEST_F(ConnectionPoolTest, DiscardsConnectionBrokenByStatement)
+{
+    ConnectionPool pool{make_config(), 1, 1s, 1h};
+
+    // A failed statement alone doesn't break the connection.
+    EXPECT_ANY_THROW({
+        auto db = pool.acquire();
+        db->execute("SELECT 1 / 0");
+    });
+    auto stats = pool.stats();
+    EXPECT_EQ(stats.dropped, 0U);
+    EXPECT_EQ(stats.idle, 1U);
+
+    EXPECT_ANY_THROW({
+        auto db = pool.acquire();
+        db->execute("SELECT pg_terminate_backend(pg_backend_pid())");
+    });
+    stats = pool.stats();
+    EXPECT_EQ(stats.dropped, 1U);
+    EXPECT_EQ(stats.open, 0U);
+    EXPECT_EQ(stats.idle, 0U);
+
+    // Connects again on demand.
+    pool.acquire()->execute("SELECT 1");
+    EXPECT_EQ(pool.stats().open, 1U);
+}
+
+TEST_F(ConnectionPoolTest, ProbesIdleConnections)
+{
+    ConnectionPool pool{make_config(), 1, 1s, 0ms};
+    terminate_pool_connections();
+
+    // The client hasn't noticed, but the probe has.
+    pool.acquire()->execute("SELECT 1");
+    auto const stats = pool.stats();
+    EXPECT_EQ(stats.probes, 1U);
+    EXPECT_EQ(stats.dropped, 1U);
+    EXPECT_EQ(stats.open, 1U);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,229 @@
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <gtest/gtest.h>
+#include <hc/export-cache.h>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace std::chrono_literals;
+
+namespace {
+
+class ExportCacheTest : public testing::Test {
+  protected:
+    ExportCacheTest()
+    {
+        fs::remove_all(wd_);
+        fs::create_directories(wd_);
+    }
+
+    ExportCacheTest(ExportCacheTest const &) = delete;
+    ExportCacheTest(ExportCacheTest &&) = delete;
+    ExportCacheTest &operator=(ExportCacheTest const &) = delete;
+    ExportCacheTest &operator=(ExportCacheTest &&) = delete;
+
+    ~ExportCacheTest() override
+    {
+        fs::remove_all(wd_);
+    }
+
+    // Builds a blob after `release` is ready, named after how many builds
+    // started so far.
+    hc::ExportCache::Build build_after(std::shared_future<void> release)
+    {
+        return [this, release](hc::jobs::Context &context) {
+            auto const n = ++builds_;
+            while (release.wait_for(1ms) != std::future_status::ready) {
+                context.progress(0.5);
+            }
+            auto const path = wd_ / std::to_string(n);
+            std::ofstream{path} << "archive";
+            return path;
+        };
+    }
+
+    fs::path wd_{fs::temp_directory_path() / "hc" / "test export cache"};
+    std::atomic_int builds_;
+    std::atomic_int evicted_;
+    hc::ExportCache cache_{2, [this](fs::path const &) { ++evicted_; }};
+};
+
+// Stops waiting once `leave` is ready, as a cancelled job does.
+hc::ExportCache::Waiting waiting_until(std::shared_future<void> leave,
+                                       std::atomic<double> *progress = nullptr)
+{
+    return [leave, progress](double fraction) {
+        if (progress != nullptr) {
+            *progress = fraction;
+        }
+        if (leave.wait_for(0s) == std::future_status::ready) {
+            throw hc::jobs::Cancelled{};
+        }
+    };
+}
+
+} // namespace
+
+TEST_F(ExportCacheTest, SharesBuild)
+{
+    std::promise<void> release;
+    auto const build = build_after(release.get_future().share());
+    std::promise<void> never;
+    auto const never_leave = never.get_future().share();
+    std::atomic<double> progress;
+    std::vector<std::future<fs::path>> paths;
+    for (auto i = 0; i != 4; ++i) {
+        paths.push_back(std::async(std::launch::async, [&] {
+            return cache_.get_or_build(
+                "key", 1, build,
+                waiting_until(never_leave, &progress));
+        }));
+    }
+    while (progress != 0.5) {
+        std::this_thread::yield();
+    }
+    release.set_value();
+    for (auto &p : paths) {
+        EXPECT_EQ(p.get(), wd_ / "1");
+    }
+    EXPECT_EQ(builds_, 1);
+
+    // Cached, or built again for a newer revision.
+    EXPECT_EQ(cache_.get_or_build("key", 1, build,
+                                  waiting_until(never_leave)),
+              wd_ / "1");
+    EXPECT_EQ(cache_.get_or_build("key", 2, build,
+                                  waiting_until(never_leave)),
+              wd_ / "2");
+    cache_.cancel_all();
+    EXPECT_EQ(evicted_, 1);
+}
+
+TEST_F(ExportCacheTest, CancelledOnceNobodyWaits)
+{
+    std::promise<void> release;
+    auto const build = build_after(release.get_future().share());
+    std::promise<void> first_leaves;
+    std::promise<void> second_leaves;
+    std::atomic_bool started;
+    auto first = std::async(std::launch::async, [&] {
+        return cache_.get_or_build(
+            "key", 1, build,
+            [&, leave = waiting_until(first_leaves.get_future().share())](
+                double fraction) {
+                if (fraction != 0) {
+                    started = true;
+                }
+                leave(fraction);
+            });
+    });
+    while (!started) {
+        std::this_thread::yield();
+    }
+    auto second = std::async(std::launch::async, [&] {
+        return cache_.get_or_build(
+            "key", 1, build,
+            waiting_until(second_leaves.get_future().share()));
+    });
+
+    // The one that started it leaves, but the build goes on for the other.
+    first_leaves.set_value();
+    EXPECT_THROW(first.get(), hc::jobs::Cancelled);
+    std::this_thread::sleep_for(50ms);
+    second_leaves.set_value();
+    EXPECT_THROW(second.get(), hc::jobs::Cancelled);
+    cache_.cancel_all();
+    EXPECT_EQ(builds_, 1);
+
+    // Nobody waits for it, so it's cancelled, and built again next time.
+    std::promise<void> never;
+    auto const never_leave = never.get_future().share();
+    release.set_value();
+    EXPECT_EQ(cache_.get_or_build("key", 1, build,
+                                  waiting_until(never_leave)),
+              wd_ / "2");
+    EXPECT_EQ(builds_, 2);
+}
+
+TEST_F(ExportCacheTest, BuildsAgainAfterFailure)
+{
+    std::promise<void> never;
+    auto const waiting = waiting_until(never.get_future().share());
+    EXPECT_THROW((void)cache_.get_or_build(
+                     "key", 1,
+                     [](hc::jobs::Context &) -> fs::path {
+                         throw std::runtime_error{"disk full"};
+                     },
+                     waiting),
+                 std::runtime_error);
+    std::promise<void> release;
+    release.set_value();
+    EXPECT_EQ(cache_.get_or_build("key", 1,
+                                  build_after(release.get_future().share()),
+                                  waiting),
+              wd_ / "1");
+}
+
+TEST_F(ExportCacheTest, QueuesBuildsBeyondBuilders)
+{
+    std::promise<void> release;
+    auto const build = build_after(release.get_future().share());
+    std::promise<void> never;
+    auto const never_leave = never.get_future().share();
+    std::vector<std::future<fs::path>> paths;
+    for (auto const *key : {"a", "b", "c"}) {
+        paths.push_back(std::async(std::launch::async, [&, key] {
+            return cache_.get_or_build(key, 1, build,
+                                       waiting_until(never_leave));
+        }));
+    }
+    while (builds_ != 2) {
+        std::this_thread::yield();
+    }
+    // The third waits for one of both build threads.
+    std::this_thread::sleep_for(50ms);
+    EXPECT_EQ(builds_, 2);
+    release.set_value();
+    for (auto &p : paths) {
+        EXPECT_TRUE(fs::exists(p.get()));
+    }
+    EXPECT_EQ(builds_, 3);
+}
+
+TEST_F(ExportCacheTest, SupersededBuildEvictsItself)
+{
+    std::promise<void> release;
+    std::promise<void> never;
+    auto const never_leave = never.get_future().share();
+    auto older = std::async(std::launch::async, [&] {
+        return cache_.get_or_build("key", 1,
+                                   build_after(release.get_future().share()),
+                                   waiting_until(never_leave));
+    });
+    while (builds_ != 1) {
+        std::this_thread::yield();
+    }
+
+    // Doesn't wait for the older build, which is still going on.
+    std::promise<void> released;
+    released.set_value();
+    EXPECT_EQ(cache_.get_or_build("key", 2,
+                                  build_after(released.get_future().share()),
+                                  waiting_until(never_leave)),
+              wd_ / "2");
+    EXPECT_EQ(evicted_, 0);
+
+    release.set_value();
+    EXPECT_EQ(older.get(), wd_ / "1");
+    cache_.cancel_all();
+    EXPECT_EQ(evicted_, 1);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
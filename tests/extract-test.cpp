@@ -0,0 +1,177 @@
+#include <fstream>
+#include <gtest/gtest.h>
+#include <hc/extract.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace std::string_literals;
+
+namespace {
+
+class ExtractTest : public testing::Test {
+  protected:
+    void SetUp() override
+    {
+        fs::remove_all(wd_);
+        fs::create_directories(wd_);
+    }
+
+    void TearDown() override
+    {
+        fs::remove_all(wd_);
+    }
+
+    // A DOCX with only what extraction reads.
+    fs::path docx(std::string const &name, std::string const &body)
+    {
+        auto const dir = wd_ / ("docx-" + name);
+        fs::create_directories(dir / "word");
+        std::ofstream(dir / "word" / "document.xml")
+            << R"(<?xml version="1.0"?><w:document><w:body>)" << body
+            << "</w:body></w:document>";
+        std::vector<hc::archive::ManifestEntry> const entries{
+            {dir / "word" / "document.xml", u8"word/document.xml"}};
+        hc::archive::create_zip(wd_ / name, entries);
+        return wd_ / name;
+    }
+
+    fs::path write(std::string const &name, std::string const &content)
+    {
+        std::ofstream(wd_ / name, std::ios::binary) << content;
+        return wd_ / name;
+    }
+
+    fs::path wd_{fs::temp_directory_path() / "hc" / "test extract"};
+    hc::extract::Pipeline pipeline_{
+        hc::extract::Pipeline::with_defaults(wd_ / "tmp")};
+};
+
+} // namespace
+
+TEST(NormalizeTest, Normalize)
+{
+    EXPECT_EQ(hc::extract::normalize("\xEF\xBB\xBF  Hello,\r\n\r\n\r\n"
+                                     "\t world \x01!  \n"),
+              "Hello,\n\nworld !");
+    // Invalid bytes and overlong forms.
+    EXPECT_EQ(hc::extract::normalize("a\xFF" "b\xC0\xAF" "c"),
+              "a\xEF\xBF\xBD" "b\xEF\xBF\xBD\xEF\xBF\xBD" "c");
+    // No-break and ideographic spaces are blanks.
+    EXPECT_EQ(hc::extract::normalize("作业\xC2\xA0\xE3\x80\x80报告"),
+              "作业 报告");
+    EXPECT_EQ(hc::extract::normalize(" \n\t"), "");
+}
+
+TEST(NormalizeTest, TruncateUtf8)
+{
+    std::string s{"作业"};
+    hc::extract::truncate_utf8(s, 5);
+    EXPECT_EQ(s, "作");
+    hc::extract::truncate_utf8(s, 2);
+    EXPECT_EQ(s, "");
+    s = "abc";
+    hc::extract::truncate_utf8(s, 8);
+    EXPECT_EQ(s, "abc");
+}
+
+TEST_F(ExtractTest, PlainText)
+{
+    auto const p = write("main.cpp", "int main()\r\n{\r\n    return 0;\r\n}\r\n");
+    EXPECT_EQ(pipeline_.extract(p, "main.cpp"),
+              "int main()\n{\nreturn 0;\n}");
+    // Judged by content rather than name.
+    EXPECT_THROW((void)pipeline_.extract(write("a.pdf", "%PDF-1.7\n"), "a.pdf"),
+                 hc::extract::UnsupportedFormat);
+    EXPECT_THROW((void)pipeline_.extract(write("a.bin", "\x01\x00\x02"s),
+                                         "a.bin"),
+                 hc::extract::UnsupportedFormat);
+    EXPECT_THROW((void)pipeline_.extract(wd_ / "missing", "missing.txt"),
+                 std::system_error);
+}
+
+TEST_F(ExtractTest, Docx)
+{
+    auto const p = docx(
+        "report.docx",
+        "<w:p><w:r><w:t>Tom &amp; Jerry</w:t></w:r></w:p>"
+        R"(<w:p><w:r><w:t xml:space="preserve">A</w:t><w:tab/><w:t>B</w:t>)"
+        "</w:r><w:r><w:br/><w:t>&#x4F5C;&#19994;</w:t></w:r></w:p>");
+    EXPECT_EQ(pipeline_.extract(p, "Report.DOCX"), "Tom & Jerry\nA B\n作业");
+}
+
+TEST_F(ExtractTest, Container)
+{
+    fs::create_directories(wd_ / "zip");
+    std::ofstream(wd_ / "zip" / "a.txt") << "first";
+    fs::copy_file(docx("b.docx", "<w:p><w:r><w:t>second</w:t></w:r></w:p>"),
+                  wd_ / "zip" / "b.docx");
+    std::ofstream(wd_ / "zip" / "c.png") << "\x89PNG\r\n";
+    std::vector<hc::archive::ManifestEntry> const entries{
+        {wd_ / "zip" / "c.png", u8"c.png"},
+        {wd_ / "zip" / "b.docx", u8"dir/b.docx"},
+        {wd_ / "zip" / "a.txt", u8"a.txt"},
+    };
+    hc::archive::create_zip(wd_ / "all.zip", entries);
+
+    EXPECT_EQ(pipeline_.extract(wd_ / "all.zip", "all.zip"), "first\n\nsecond");
+    // Unpacked ones are removed.
+    EXPECT_TRUE(fs::is_empty(wd_ / "tmp"));
+}
+
+TEST_F(ExtractTest, Service)
+{
+    hc::extract::Service service{std::move(pipeline_),
+                                 hc::extract::TextCache{wd_ / "cache"}, 2};
+    auto const p = write("a.txt", "some text");
+    EXPECT_TRUE(service.post("aa00", p, "a.txt"));
+    EXPECT_TRUE(service.post("bb00", write("a.pdf", "%PDF-1.7\n"), "a.pdf"));
+    // Queued already.
+    EXPECT_TRUE(service.post("aa00", p, "a.txt"));
+    service.drain();
+
+    hc::extract::TextCache const cache{wd_ / "cache"};
+    EXPECT_EQ(cache.get("aa00"), "some text");
+    EXPECT_EQ(cache.get("bb00"), "");
+    EXPECT_EQ(cache.get("cc00"), std::nullopt);
+
+    EXPECT_EQ(service.cached("aa00"), "some text");
+    EXPECT_EQ(service.cached("cc00"), std::nullopt);
+
+    // Cached text is never extracted again, even if the file is gone.
+    fs::remove(p);
+    EXPECT_EQ(service.text("aa00", p, "a.txt"), "some text");
+    EXPECT_THROW((void)service.text("cc00", p, "a.txt"), std::system_error);
+}
+
+TEST_F(ExtractTest, ServiceCallsBack)
+{
+    hc::extract::Service service{std::move(pipeline_),
+                                 hc::extract::TextCache{wd_ / "cache"}, 1};
+    std::mutex mutex;
+    std::vector<std::string> texts;
+    auto const on_text = [&](std::string const &text) {
+        std::scoped_lock guard{mutex};
+        texts.push_back(text);
+    };
+    auto const p = write("a.txt", "some text");
+    EXPECT_TRUE(service.post("aa00", p, "a.txt", on_text));
+    // Queued or being extracted already, and called back as well.
+    EXPECT_TRUE(service.post("aa00", p, "a.txt", on_text));
+    service.drain();
+    // Cached already, and still called back.
+    EXPECT_TRUE(service.post("aa00", p, "a.txt", on_text));
+    // Never called back, as the file is missing.
+    EXPECT_TRUE(service.post("cc00", wd_ / "missing.txt", "missing.txt",
+                             on_text));
+    service.drain();
+
+    EXPECT_EQ(texts, std::vector<std::string>(3, "some text"));
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,90 @@
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <hc/io.h>
+#include <random>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string random_bytes(std::size_t n)
+{
+    std::mt19937 rng{42};
+    std::string s(n, '\0');
+    for (auto &c : s) {
+        c = static_cast<char>(rng());
+    }
+    return s;
+}
+
+std::string read_all(hc::io::Engine &engine, fs::path const &path,
+                     std::uint64_t size)
+{
+    hc::io::UniqueFd const fd(path, O_RDONLY);
+    hc::io::Reader reader(engine, fd.get(), size);
+    std::string res;
+    for (auto b = reader.next(); !b.empty(); b = reader.next()) {
+        res.append(b.data(), b.size());
+    }
+    return res;
+}
+
+} // namespace
+
+TEST(IoTest, RoundTrip)
+{
+    auto const wd = fs::temp_directory_path() / "hc" / "test io";
+    fs::create_directories(wd);
+    auto const path = wd / "data";
+
+    // Small buffers, so that all of them are in flight many times.
+    auto const engine = hc::io::Engine::make(3, 4096);
+    // Not a multiple of block size, and written in odd pieces.
+    auto const data = random_bytes(100'003);
+    {
+        hc::io::UniqueFd const fd(path, O_WRONLY | O_CREAT | O_TRUNC);
+        hc::io::Writer writer(*engine, fd.get());
+        for (auto i = 0UZ; i < data.size(); i += 777) {
+            writer.write(std::span{data}.subspan(
+                i, std::min(777UZ, data.size() - i)));
+        }
+        writer.finish();
+        EXPECT_EQ(writer.size(), data.size());
+    }
+    EXPECT_EQ(fs::file_size(path), data.size());
+    EXPECT_EQ(read_all(*engine, path, data.size()), data);
+
+    // Stops at the end of file if it's shorter than told.
+    EXPECT_EQ(read_all(*engine, path, data.size() * 2), data);
+    // Reads only as much as told.
+    EXPECT_EQ(read_all(*engine, path, 5000), data.substr(0, 5000));
+    EXPECT_EQ(read_all(*engine, path, 0), "");
+
+    // Abandoning a reader halfway leaves the engine usable.
+    {
+        hc::io::UniqueFd const fd(path, O_RDONLY);
+        hc::io::Reader reader(*engine, fd.get(), data.size());
+        EXPECT_FALSE(reader.next().empty());
+    }
+    EXPECT_EQ(read_all(hc::io::Engine::local(), path, data.size()), data);
+
+    fs::remove_all(wd);
+}
+
+TEST(IoTest, OpenFailure)
+{
+    try {
+        hc::io::UniqueFd const fd("/nonexistent/file", O_RDONLY);
+        FAIL();
+    }
+    catch (std::system_error const &e) {
+        EXPECT_EQ(e.code(), std::errc::no_such_file_or_directory);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,161 @@
+#include <future>
+#include <gtest/gtest.h>
+#include <hc/jobs.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std::chrono_literals;
+using hc::jobs::Priority;
+using hc::jobs::State;
+
+namespace {
+
+// Occupies the only worker until `release()`.
+class Blocker {
+  public:
+    explicit Blocker(hc::jobs::Scheduler &s)
+    {
+        id_ = *s.submit("block", Priority::high,
+                        [this](hc::jobs::Context & /*unused*/) {
+                            started_.set_value();
+                            released_.wait();
+                            return std::string{};
+                        });
+        started_.get_future().wait();
+    }
+
+    void release()
+    {
+        release_.set_value();
+    }
+
+  private:
+    std::string id_;
+    std::promise<void> started_;
+    std::promise<void> release_;
+    std::shared_future<void> released_{release_.get_future().share()};
+};
+
+} // namespace
+
+TEST(JobsTest, RunsByPriority)
+{
+    hc::jobs::Scheduler s{{.workers = 1}};
+    Blocker blocker{s};
+
+    std::mutex mutex;
+    std::vector<std::string> order;
+    auto job = [&](std::string name) {
+        return [&, name](hc::jobs::Context & /*unused*/) {
+            std::scoped_lock guard{mutex};
+            order.push_back(name);
+            return name;
+        };
+    };
+    auto const low = s.submit("t", Priority::low, job("low"));
+    (void)s.submit("t", Priority::normal, job("normal 1"));
+    (void)s.submit("t", Priority::high, job("high"));
+    (void)s.submit("t", Priority::normal, job("normal 2"));
+    ASSERT_TRUE(low);
+    EXPECT_EQ(s.status(*low)->state, State::queued);
+    blocker.release();
+    s.drain();
+
+    EXPECT_EQ(order, (std::vector<std::string>{"high", "normal 1", "normal 2",
+                                               "low"}));
+    auto const status = s.status(*low);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(status->state, State::succeeded);
+    EXPECT_EQ(status->result, "low");
+    EXPECT_DOUBLE_EQ(status->progress, 1.0);
+    EXPECT_FALSE(s.status("no such job"));
+}
+
+TEST(JobsTest, BoundsQueue)
+{
+    hc::jobs::Scheduler s{{.workers = 1, .max_queued = 2}};
+    Blocker blocker{s};
+    auto const noop = [](hc::jobs::Context & /*unused*/) {
+        return std::string{};
+    };
+    EXPECT_TRUE(s.submit("t", Priority::normal, noop));
+    EXPECT_TRUE(s.submit("t", Priority::normal, noop));
+    EXPECT_FALSE(s.submit("t", Priority::normal, noop));
+    blocker.release();
+    s.drain();
+    EXPECT_TRUE(s.submit("t", Priority::normal, noop));
+}
+
+TEST(JobsTest, Cancels)
+{
+    hc::jobs::Scheduler s{{.workers = 1}};
+
+    std::promise<void> started;
+    auto const running = *s.submit(
+        "t", Priority::normal, [&](hc::jobs::Context &context) -> std::string {
+            context.progress(0.5);
+            started.set_value();
+            while (true) {
+                std::this_thread::sleep_for(1ms);
+                context.progress(0.5);
+            }
+        });
+    auto const queued = *s.submit("t", Priority::normal,
+                                  [](hc::jobs::Context & /*unused*/) {
+                                      ADD_FAILURE() << "Cancelled job ran";
+                                      return std::string{};
+                                  });
+    started.get_future().wait();
+    EXPECT_DOUBLE_EQ(s.status(running)->progress, 0.5);
+
+    EXPECT_TRUE(s.cancel(queued));
+    EXPECT_EQ(s.status(queued)->state, State::cancelled);
+    EXPECT_TRUE(s.cancel(running));
+    s.drain();
+    EXPECT_EQ(s.status(running)->state, State::cancelled);
+    // Finished already.
+    EXPECT_FALSE(s.cancel(running));
+}
+
+TEST(JobsTest, ReportsFailures)
+{
+    hc::jobs::Scheduler s{{}};
+    auto const id = *s.submit("t", Priority::normal,
+                              [](hc::jobs::Context & /*unused*/) -> std::string {
+                                  throw std::runtime_error{"Disk is full"};
+                              });
+    s.drain();
+    auto const status = s.status(id);
+    ASSERT_TRUE(status);
+    EXPECT_EQ(status->state, State::failed);
+    EXPECT_EQ(status->error, "Disk is full");
+    EXPECT_EQ(status->result, std::nullopt);
+    EXPECT_EQ(nlohmann::json(*status).at("state"), "failed");
+}
+
+TEST(JobsTest, CancelsAllOnDestruction)
+{
+    std::atomic_bool cancelled{};
+    {
+        hc::jobs::Scheduler s{{.workers = 1}};
+        std::promise<void> started;
+        (void)s.submit("t", Priority::normal,
+                       [&](hc::jobs::Context &context) {
+                           started.set_value();
+                           while (!context.cancelled()) {
+                               std::this_thread::sleep_for(1ms);
+                           }
+                           cancelled = true;
+                           return std::string{};
+                       });
+        started.get_future().wait();
+    }
+    EXPECT_TRUE(cancelled);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <hc/minhash.h>
+#include <random>
+
+using hc::minhash::Signature;
+using hc::plagiarism::Fingerprints;
+
+namespace {
+
+// Two sets of 1000 elements sharing `shared` of them.
+std::pair<Fingerprints, Fingerprints> sets(std::size_t shared, unsigned seed)
+{
+    std::mt19937_64 rng{seed};
+    Fingerprints a;
+    Fingerprints b;
+    for (auto i = 0UZ; i != 1000; ++i) {
+        auto const x = rng();
+        a.push_back(x);
+        b.push_back(i < shared ? x : rng());
+    }
+    std::ranges::sort(a);
+    std::ranges::sort(b);
+    return {a, b};
+}
+
+} // namespace
+
+TEST(MinHashTest, Signature)
+{
+    for (auto const shared : {0UZ, 500UZ, 800UZ, 1000UZ}) {
+        auto const [a, b] = sets(shared, 1);
+        auto const jaccard = static_cast<double>(shared) /
+                             static_cast<double>(2000 - shared);
+        EXPECT_NEAR(hc::minhash::similarity(hc::minhash::signature(a),
+                                            hc::minhash::signature(b)),
+                    jaccard, 0.2)
+            << shared;
+    }
+
+    auto const sig = hc::minhash::signature(sets(0, 2).first);
+    EXPECT_EQ(hc::minhash::unpack(hc::minhash::pack(sig)), sig);
+    EXPECT_THROW(hc::minhash::unpack(std::vector<std::uint8_t>(3)),
+                 std::invalid_argument);
+}
+
+TEST(MinHashTest, LshIndex)
+{
+    auto const [original, copy] = sets(900, 3);
+    auto const unrelated = sets(0, 4).first;
+
+    hc::minhash::LshIndex index;
+    index.put("2024 Lab 1", "202326202022", hc::minhash::signature(original));
+    index.put("2025 Lab 1", "202326202023", hc::minhash::signature(unrelated));
+    // Empty documents aren't indexed.
+    index.put("2025 Lab 1", "202326202024", hc::minhash::signature({}));
+    EXPECT_EQ(index.size(), 2U);
+
+    auto const query = hc::minhash::signature(copy);
+    auto matches = index.query(query, 10, 0.5);
+    ASSERT_EQ(matches.size(), 1U);
+    EXPECT_EQ(matches[0].assignment_name, "2024 Lab 1");
+    EXPECT_EQ(matches[0].student_id, "202326202022");
+    EXPECT_GT(matches[0].similarity, 0.5);
+
+    ASSERT_NE(index.find("2024 Lab 1", "202326202022"), nullptr);
+    EXPECT_EQ(index.find("2024 Lab 1", "nobody"), nullptr);
+
+    // Replaced by a newer signature, but not by an older one.
+    index.put("2024 Lab 1", "202326202022", hc::minhash::signature(unrelated),
+              2);
+    EXPECT_TRUE(index.query(query, 10, 0.5).empty());
+    index.put("2024 Lab 1", "202326202022", hc::minhash::signature(original),
+              1);
+    EXPECT_TRUE(index.query(query, 10, 0.5).empty());
+    EXPECT_EQ(index.query(hc::minhash::signature(unrelated), 10, 0.5).size(),
+              2U);
+    EXPECT_EQ(index.query(hc::minhash::signature(unrelated), 1, 0.5).size(),
+              1U);
+
+    index.erase("2025 Lab 1", "202326202023");
+    matches = index.query(hc::minhash::signature(unrelated), 10, 0.5);
+    ASSERT_EQ(matches.size(), 1U);
+    EXPECT_EQ(matches[0].student_id, "202326202022");
+    index.erase("2024 Lab 1", "202326202022");
+    EXPECT_EQ(index.size(), 0U);
+    EXPECT_TRUE(index.query(hc::minhash::signature(unrelated), 10, 0).empty());
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <gtest/gtest.h>
+#include <hc/plagiarism.h>
+#include <iterator>
+#include <random>
+#include <string>
+
+using hc::plagiarism::fingerprint;
+using hc::plagiarism::Fingerprints;
+
+namespace {
+
+std::string random_text(std::size_t words, unsigned seed)
+{
+    static constexpr std::array<char const *, 8> vocabulary{
+        "the", "of", "submission", "assignment", "report", "data",
+        "result", "method"};
+    std::mt19937 rng{seed};
+    std::string s;
+    for (auto i = 0UZ; i != words; ++i) {
+        s += vocabulary[rng() % vocabulary.size()];
+        s += rng() % 10 == 0 ? ".\n" : " ";
+    }
+    return s;
+}
+
+std::size_t common(Fingerprints const &a, Fingerprints const &b)
+{
+    Fingerprints both;
+    std::ranges::set_intersection(a, b, std::back_inserter(both));
+    return both.size();
+}
+
+} // namespace
+
+TEST(PlagiarismTest, Winnow)
+{
+    auto const text = random_text(2000, 1);
+    auto const fp = fingerprint(text);
+    EXPECT_TRUE(std::ranges::is_sorted(fp));
+    EXPECT_FALSE(fp.empty());
+
+    // Formatting doesn't matter.
+    std::string reformatted;
+    for (auto const c : text) {
+        reformatted += c == ' ' ? std::string{"\t  "} : std::string{c};
+    }
+    EXPECT_EQ(fingerprint(reformatted), fp);
+    std::string upper = text;
+    for (auto &c : upper) {
+        c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    EXPECT_EQ(fingerprint(upper), fp);
+
+    // Streamed in pieces.
+    hc::plagiarism::Winnower w;
+    for (auto i = 0UZ; i < text.size(); i += 7) {
+        w.update(std::string_view{text}.substr(i, 7));
+    }
+    EXPECT_EQ(w.finish(), fp);
+
+    // A copied paragraph is found in another document.
+    auto const other = random_text(2000, 2);
+    auto const copied = other + text.substr(1000, 500);
+    EXPECT_LT(common(fp, fingerprint(other)), fp.size() / 10);
+    EXPECT_GT(common(fp, fingerprint(copied)), 0U);
+
+    EXPECT_TRUE(fingerprint(std::string_view{""}).empty());
+    EXPECT_EQ(
+        fingerprint(std::string_view{"a short text, yet longer than a k-gram"})
+            .size(),
+        1U);
+    EXPECT_EQ(fingerprint(text, {.max_fingerprints = 10}).size(), 10U);
+
+    EXPECT_EQ(hc::plagiarism::unpack(hc::plagiarism::pack(fp)), fp);
+}
+
+TEST(PlagiarismTest, Index)
+{
+    hc::plagiarism::Index index;
+    index.put("a", {1, 2, 3, 4});
+    index.put("b", {1, 2, 3, 5});
+    index.put("c", {4, 6});
+    index.put("d", {7});
+
+    auto pairs = index.top_pairs(10);
+    ASSERT_EQ(pairs.size(), 2U);
+    EXPECT_EQ(pairs[0].first, "a");
+    EXPECT_EQ(pairs[0].second, "b");
+    EXPECT_EQ(pairs[0].shared, 3U);
+    EXPECT_DOUBLE_EQ(pairs[0].similarity, 0.75);
+    EXPECT_EQ(pairs[1].first, "a");
+    EXPECT_EQ(pairs[1].second, "c");
+    EXPECT_DOUBLE_EQ(pairs[1].similarity, 0.5);
+    EXPECT_EQ(index.top_pairs(1).size(), 1U);
+    EXPECT_EQ(index.top_pairs(10, 2).size(), 1U);
+
+    // Resubmission replaces the old document.
+    index.put("b", {5, 7}, 2);
+    pairs = index.top_pairs(10);
+    ASSERT_EQ(pairs.size(), 2U);
+    EXPECT_EQ(pairs[0].first, "b");
+    EXPECT_EQ(pairs[0].second, "d");
+    EXPECT_DOUBLE_EQ(pairs[0].similarity, 1.0);
+
+    // Stale updates are ignored.
+    index.put("b", {1, 2, 3}, 1);
+    EXPECT_EQ(index.top_pairs(10)[0].second, "d");
+
+    index.erase("d");
+    index.erase("a");
+    EXPECT_EQ(index.size(), 2U);
+    EXPECT_TRUE(index.top_pairs(10).empty());
+    index.put("e", {6});
+    ASSERT_EQ(index.top_pairs(10).size(), 1U);
+    EXPECT_EQ(index.top_pairs(10)[0].first, "c");
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <hc/roster.h>
+#include <string>
+#include <vector>
+
+using hc::roster::ParseError;
+
+TEST(RosterTest, ParseCsv)
+{
+    using Rows = std::vector<std::vector<std::string>>;
+    EXPECT_EQ(hc::roster::parse_csv("a,b\nc,d"), (Rows{{"a", "b"}, {"c", "d"}}));
+    // What spreadsheets export on Windows.
+    EXPECT_EQ(hc::roster::parse_csv("\xEF\xBB\xBF" "a,b\r\n\r\nc,d\r\n"),
+              (Rows{{"a", "b"}, {"c", "d"}}));
+    EXPECT_EQ(hc::roster::parse_csv(R"("a,""b""",)" "\"c\nd\"\n"),
+              (Rows{{R"(a,"b")", "c\nd"}}));
+    EXPECT_EQ(hc::roster::parse_csv("a,\n,\n"), (Rows{{"a", ""}, {"", ""}}));
+    EXPECT_EQ(hc::roster::parse_csv(""), Rows{});
+    EXPECT_THROW(hc::roster::parse_csv("a,\"b\n"), ParseError);
+}
+
+TEST(RosterTest, ParseStudents)
+{
+    auto const csv = hc::roster::parse_students(
+        "student_id,name\n202326202022,刘家福\n202326202023,\"Li, Lei\"\n",
+        true);
+    ASSERT_EQ(csv.size(), 2U);
+    EXPECT_EQ(csv[0].student_id, "202326202022");
+    EXPECT_EQ(csv[0].name, "刘家福");
+    EXPECT_EQ(csv[1].name, "Li, Lei");
+
+    // Header is optional.
+    EXPECT_EQ(hc::roster::parse_students("202326202022,刘家福", true).size(),
+              1U);
+
+    auto const json = hc::roster::parse_students(
+        R"([{"student_id":"202326202022","name":"刘家福"}])", false);
+    ASSERT_EQ(json.size(), 1U);
+    EXPECT_EQ(json[0].name, "刘家福");
+
+    EXPECT_THROW(hc::roster::parse_students("202326202022", true), ParseError);
+    EXPECT_THROW(hc::roster::parse_students(R"([{"name":"x"}])", false),
+                 ParseError);
+    EXPECT_THROW(hc::roster::parse_students("[", false), ParseError);
+}
+
+TEST(RosterTest, ParseTeachers)
+{
+    auto const teachers =
+        hc::roster::parse_teachers("teacher_id,name,password\nt01,Alice,p\n",
+                                   true);
+    ASSERT_EQ(teachers.size(), 1U);
+    EXPECT_EQ(teachers[0].teacher_id, "t01");
+    EXPECT_EQ(teachers[0].password, "p");
+    EXPECT_THROW(hc::roster::parse_teachers("t01,Alice", true), ParseError);
+}
+
+TEST(RosterTest, Validate)
+{
+    std::vector<Student> const good{
+        {.student_id = "202326202022", .name = "刘家福"},
+        {.student_id = "202326202023", .name = "Li Lei"},
+    };
+    EXPECT_TRUE(hc::roster::validate(good).empty());
+
+    std::vector<Student> const bad{
+        {.student_id = "202326202022", .name = "刘家福"},
+        {.student_id = "2023", .name = "Short"},
+        {.student_id = "202326202022", .name = "Again"},
+        {.student_id = "202326202024", .name = ""},
+    };
+    auto const problems = hc::roster::validate(bad);
+    ASSERT_EQ(problems.size(), 3U);
+    EXPECT_EQ(problems[0], "Row 2: student ID '2023' should have 12 characters");
+    EXPECT_EQ(problems[1],
+              "Row 3: ID '202326202022' duplicates row 1");
+    EXPECT_EQ(problems[2], "Row 4: name is empty");
+
+    std::vector<Teacher> const teachers{
+        {.teacher_id = "t01", .name = "Alice", .password = "p"},
+        {.teacher_id = "t01", .name = "Bob", .password = ""},
+    };
+    EXPECT_EQ(hc::roster::validate(teachers).size(), 2U);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,5 +1,6 @@
 #include <fstream>
 #include <gtest/gtest.h>
+#include <hc/config.h>
 #include <hc/mock/mock-client.h>
 #include <hc/server.h>
 #include <httplib.h>
@@ -7,6 +8,7 @@
 #include <pqxx/pqxx>
 #include <spdlog/spdlog.h>
 #include <sstream>
+#include <thread>
 
 #ifndef HCRE_TEST_DB
 #error [dev] HCHCRE_TEST_DB not defined, should be defined in CMakeLists.txt
@@ -123,6 +125,69 @@ TEST_F(ServerTest, Valid)
     EXPECT_EQ(r->status, httplib::StatusCode::OK_200);
 }
 
+TEST_F(ServerTest, AssignmentsETag)
+{
+    auto r = c_.Get("/api/assignments");
+    ASSERT_TRUE(r);
+    ASSERT_TRUE(r->has_header("ETag"));
+    auto const etag = r->get_header_value("ETag");
+
+    // Unchanged
+    r = c_.Get("/api/assignments", {{"If-None-Match", etag}});
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::NotModified_304);
+    EXPECT_TRUE(r->body.empty());
+
+    // Changed
+    successfully_add_assignment_testassignmentinfinite(c_);
+    r = c_.Get("/api/assignments", {{"If-None-Match", etag}});
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::OK_200);
+    EXPECT_NE(r->get_header_value("ETag"), etag);
+    auto const j = nlohmann::json::parse(r->body);
+    ASSERT_EQ(j.size(), 1);
+    EXPECT_EQ(j[0]["name"], "Test Assignment Infinite");
+}
+
+TEST_F(ServerTest, AssignmentsSummaryPagination)
+{
+    for (auto const *name : {"Lab 1", "Lab 2", "Lab 3", "Essay"}) {
+        auto const body = nlohmann::json{
+            {"name", name},
+            {"start_time", "2025-11-26T00:00:00Z"},
+            {"end_time", "2099-11-26T00:00:00Z"},
+            {"submissions", nlohmann::json::object()},
+        }.dump();
+        auto r = c_.Post("/api/assignments/add", body, "application/json");
+        ASSERT_TRUE(r);
+        ASSERT_EQ(r->status, StatusCode::OK_200);
+    }
+
+    std::vector<std::string> names;
+    auto path = std::string{"/api/assignments?view=summary&name=Lab&limit=2"};
+    while (true) {
+        auto r = c_.Get(path);
+        ASSERT_TRUE(r);
+        ASSERT_EQ(r->status, StatusCode::OK_200);
+        auto const page = nlohmann::json::parse(r->body).get<AssignmentsPage>();
+        for (auto const &item : page.items) {
+            EXPECT_FALSE(item.contains("submissions"));
+            EXPECT_EQ(item.at("submission_count"), 0);
+            names.push_back(item.at("name"));
+        }
+        if (!page.next_cursor) {
+            break;
+        }
+        path = "/api/assignments?view=summary&name=Lab&limit=2&cursor=" +
+               *page.next_cursor;
+    }
+    EXPECT_EQ(names, (std::vector<std::string>{"Lab 1", "Lab 2", "Lab 3"}));
+
+    auto r = c_.Get("/api/assignments?cursor=garbage");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::BadRequest_400);
+}
+
 TEST_F(ServerTest, AddAssignment)
 {
     auto const *const body = R"({
@@ -211,6 +276,88 @@ TEST_F(ServerTest, SubmitToAssignment)
     ljf_successfully_submit_to_testassignmentinfinite(c_);
 }
 
+TEST_F(ServerTest, ChunkedBodyNeedsLength)
+{
+    // Only ingest may stream a body of unknown length.
+    auto r = c_.Post(
+        "/api/students/add",
+        [](std::size_t /*offset*/, httplib::DataSink &sink) {
+            sink.write("{}", 2);
+            sink.done();
+            return true;
+        },
+        "application/json");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::LengthRequired_411);
+}
+
+TEST_F(ServerTest, StreamSubmitToAssignment)
+{
+    successfully_add_assignment_testassignmentinfinite(c_);
+
+    httplib::Headers const headers{
+        {"X-Student-Id", "202326202022"},
+        {"X-Student-Name", "%E5%88%98%E5%AE%B6%E7%A6%8F"},
+        {"X-Assignment-Name", "Test%20Assignment%20Infinite"},
+        {"X-Filename", "ljf%20sb"},
+    };
+    auto r = c_.Post("/api/assignments/submit-stream", headers, "SB LJF",
+                     "application/octet-stream");
+    ASSERT_TRUE(r);
+    // No such student
+    EXPECT_EQ(r->status, StatusCode::BadRequest_400);
+
+    successfully_add_student_ljf(c_);
+    ljf_successfully_stream_submit_to_testassignmentinfinite(c_);
+    // Resubmission replaces the old one
+    ljf_successfully_stream_submit_to_testassignmentinfinite(c_);
+
+    auto const old_max = std::exchange(config::max_submission_size(), 1024);
+    r = c_.Post("/api/assignments/submit-stream", headers,
+                std::string(1025, 'x'), "application/octet-stream");
+    config::max_submission_size() = old_max;
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::PayloadTooLarge_413);
+}
+
+namespace {
+
+// Polls job `id` until it finishes.
+hc::jobs::Status wait_for_job(httplib::Client &c, httplib::Headers const &auth,
+                              std::string const &id)
+{
+    using namespace std::chrono_literals;
+    while (true) {
+        auto r = c.Get("/api/jobs/" + id, auth);
+        if (!r || r->status != StatusCode::OK_200) {
+            throw std::runtime_error{"Failed to get status of job " + id};
+        }
+        auto status = nlohmann::json::parse(r->body).get<hc::jobs::Status>();
+        if (status.state != hc::jobs::State::queued &&
+            status.state != hc::jobs::State::running) {
+            return status;
+        }
+        std::this_thread::sleep_for(10ms);
+    }
+}
+
+// Exports through a job, and returns the URI of the blob.
+std::string exported_uri(httplib::Client &c, std::string const &body)
+{
+    auto const auth = admin_authorization(c);
+    auto r = c.Post("/api/assignments/export", auth, body, "application/json");
+    if (!r || r->status != StatusCode::Accepted_202) {
+        throw std::runtime_error{"Failed to submit export"};
+    }
+    auto const job = nlohmann::json::parse(r->body).get<JobSubmitted>();
+    auto const status = wait_for_job(c, auth, job.job_id);
+    EXPECT_EQ(status.state, hc::jobs::State::succeeded);
+    EXPECT_DOUBLE_EQ(status.progress, 1.0);
+    return status.result.value_or("");
+}
+
+} // namespace
+
 TEST_F(ServerTest, Export)
 {
     successfully_add_assignment_testassignmentinfinite(c_);
@@ -222,6 +369,10 @@ TEST_F(ServerTest, Export)
         auto r =
             c_.Post("/api/assignments/export", empty_body, "application/json");
         ASSERT_TRUE(r);
+        EXPECT_EQ(r->status, httplib::StatusCode::Unauthorized_401);
+        r = c_.Post("/api/assignments/export", admin_authorization(c_),
+                    empty_body, "application/json");
+        ASSERT_TRUE(r);
         EXPECT_EQ(r->status, httplib::StatusCode::BadRequest_400);
     }
 
@@ -229,18 +380,407 @@ TEST_F(ServerTest, Export)
         auto const *const body = R"({
             "assignment_name": "Test Assignment Infinite"
         })";
-        auto r = c_.Post("/api/assignments/export", body, "application/json");
+        auto download = c_.Get(exported_uri(c_, body));
+        ASSERT_TRUE(download);
+        EXPECT_EQ(download->status, StatusCode::OK_200);
+    }
+}
+
+TEST_F(ServerTest, ExportIsCachedUntilResubmission)
+{
+    successfully_add_assignment_testassignmentinfinite(c_);
+    successfully_add_student_ljf(c_);
+    ljf_successfully_submit_to_testassignmentinfinite(c_);
+
+    auto export_uri = [this] {
+        return exported_uri(c_, R"({
+            "assignment_name": "Test Assignment Infinite"
+        })");
+    };
+
+    auto const first = export_uri();
+    EXPECT_EQ(export_uri(), first);
+
+    ljf_successfully_submit_to_testassignmentinfinite(c_);
+    auto const second = export_uri();
+    EXPECT_NE(second, first);
+
+    auto download = c_.Get(second);
+    ASSERT_TRUE(download);
+    EXPECT_EQ(download->status, StatusCode::OK_200);
+}
+
+TEST_F(ServerTest, Jobs)
+{
+    auto const auth = admin_authorization(c_);
+    auto r = c_.Get("/api/jobs/no-such-job", auth);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::NotFound_404);
+
+    successfully_add_assignment_testassignmentinfinite(c_);
+    successfully_add_student_ljf(c_);
+    ljf_successfully_submit_to_testassignmentinfinite(c_);
+    r = c_.Post("/api/assignments/export", auth,
+                R"({"assignment_name": "Test Assignment Infinite"})",
+                "application/json");
+    ASSERT_TRUE(r);
+    ASSERT_EQ(r->status, StatusCode::Accepted_202);
+    auto const job = nlohmann::json::parse(r->body).get<JobSubmitted>();
+    auto const status = wait_for_job(c_, auth, job.job_id);
+    EXPECT_EQ(status.kind, "export");
+    EXPECT_EQ(status.owner, "admin");
+
+    // Without logging in.
+    r = c_.Get(job.status_uri);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::Unauthorized_401);
+    r = c_.Post(job.status_uri + "/cancel", "", "application/json");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::Unauthorized_401);
+
+    // Finished already.
+    r = c_.Post(job.status_uri + "/cancel", auth, "", "application/json");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::Conflict_409);
+    EXPECT_EQ(nlohmann::json::parse(r->body).at("state"), "succeeded");
+}
+
+TEST_F(ServerTest, StreamExport)
+{
+    successfully_add_assignment_testassignmentinfinite(c_);
+    successfully_add_student_ljf(c_);
+    ljf_successfully_submit_to_testassignmentinfinite(c_);
+
+    auto const *const body = R"({
+        "assignment_name": "Test Assignment Infinite",
+        "mode": "stream"
+    })";
+    auto r = c_.Post("/api/assignments/export", admin_authorization(c_), body,
+                     "application/json");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::OK_200);
+    EXPECT_EQ(r->get_header_value("Content-Type"),
+              "application/x-zstd-compressed-tar");
+    // Zstandard frame magic number
+    ASSERT_GE(r->body.size(), 4);
+    EXPECT_EQ(r->body.substr(0, 4), "\x28\xB5\x2F\xFD");
+
+    auto const *const unknown = R"({
+        "assignment_name": "Test Assignment Infinite",
+        "mode": "streaming"
+    })";
+    r = c_.Post("/api/assignments/export", admin_authorization(c_), unknown,
+                "application/json");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::BadRequest_400);
+}
+
+TEST_F(ServerTest, ExportProfiles)
+{
+    successfully_add_assignment_testassignmentinfinite(c_);
+    successfully_add_student_ljf(c_);
+    ljf_successfully_submit_to_testassignmentinfinite(c_);
+
+    auto export_with = [](std::string const &profile) {
+        return nlohmann::json{
+            {"assignment_name", "Test Assignment Infinite"},
+            {"profile", profile},
+        }
+            .dump();
+    };
+
+    auto const fast = exported_uri(c_, export_with("fast"));
+    auto const small = exported_uri(c_, export_with("small"));
+    // Archives of different profiles are cached separately.
+    EXPECT_NE(fast, small);
+
+    auto bad = c_.Post("/api/assignments/export", admin_authorization(c_),
+                       export_with("tiny"), "application/json");
+    ASSERT_TRUE(bad);
+    EXPECT_EQ(bad->status, StatusCode::BadRequest_400);
+}
+
+TEST_F(ServerTest, StreamExportZip)
+{
+    successfully_add_assignment_testassignmentinfinite(c_);
+    successfully_add_student_ljf(c_);
+    ljf_successfully_submit_to_testassignmentinfinite(c_);
+
+    auto const *const body = R"({
+        "assignment_name": "Test Assignment Infinite",
+        "mode": "stream",
+        "format": "zip"
+    })";
+    auto r = c_.Post("/api/assignments/export", admin_authorization(c_), body,
+                     "application/json");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::OK_200);
+    EXPECT_EQ(r->get_header_value("Content-Type"), "application/zip");
+    ASSERT_GE(r->body.size(), 4);
+    EXPECT_EQ(r->body.substr(0, 4), "PK\x03\x04");
+}
+
+TEST_F(ServerTest, IngestSubmissions)
+{
+    successfully_add_assignment_testassignmentinfinite(c_);
+    successfully_add_student_ljf(c_);
+    ljf_successfully_submit_to_testassignmentinfinite(c_);
+
+    auto const wd = std::filesystem::temp_directory_path() / "hc-ingest-test";
+    std::filesystem::create_directories(wd);
+    std::ofstream(wd / "report") << "Migrated report";
+    std::ofstream(wd / "other") << "Nobody's";
+    std::vector<hc::archive::ManifestEntry> const entries{
+        {wd / "report", u8"Test Assignment Infinite/202326202022刘家福/报告.txt"},
+        {wd / "other", u8"Test Assignment Infinite/202399999999某人/x.txt"},
+        {wd / "other", u8"No Such Assignment/202326202022刘家福/x.txt"},
+    };
+    hc::archive::create_tar_zst(wd / "old.tar.zst", entries);
+    std::ifstream ifs(wd / "old.tar.zst", std::ios::binary);
+    std::string const archive{std::istreambuf_iterator<char>{ifs}, {}};
+
+    auto r = c_.Post("/api/assignments/ingest", archive,
+                     "application/octet-stream");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::Unauthorized_401);
+
+    r = c_.Post("/api/admin/login", R"({"username":"xhw","password":"xhw"})",
+                "application/json");
+    ASSERT_TRUE(r);
+    auto const token =
+        nlohmann::json::parse(r->body).get<AdminLoginResult>().token;
+    httplib::Headers const headers{{"Authorization", "Bearer " + token}};
+    r = c_.Post("/api/assignments/ingest", headers, archive,
+                "application/octet-stream");
+    ASSERT_TRUE(r);
+    ASSERT_EQ(r->status, StatusCode::OK_200) << r->body;
+    auto const result = nlohmann::json::parse(r->body).get<IngestResult>();
+    EXPECT_EQ(result.ingested, 1U);
+    EXPECT_EQ(result.skipped.size(), 2U);
+
+    // Replaces what was submitted before.
+    r = c_.Get("/api/assignments");
+    ASSERT_TRUE(r);
+    auto const assignments =
+        nlohmann::json::parse(r->body).get<std::vector<Assignment>>();
+    ASSERT_EQ(assignments.size(), 1U);
+    auto const &sub = assignments[0].submissions.at("202326202022");
+    EXPECT_EQ(sub.original_filename, "报告.txt");
+    std::ifstream ingested(sub.filepath);
+    std::string content;
+    std::getline(ingested, content);
+    EXPECT_EQ(content, "Migrated report");
+
+    r = c_.Post("/api/assignments/ingest", headers, "not an archive",
+                "application/octet-stream");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::BadRequest_400);
+
+    std::filesystem::remove_all(wd);
+}
+
+TEST_F(ServerTest, DuplicateSubmissions)
+{
+    successfully_add_assignment_testassignmentinfinite(c_);
+    successfully_add_student_ljf(c_);
+    auto r = c_.Post("/api/students/add",
+                     R"({"student_id":"202326202023","name":"Li Lei"})",
+                     "application/json");
+    ASSERT_TRUE(r);
+    ASSERT_EQ(r->status, StatusCode::OK_200);
+
+    ljf_successfully_stream_submit_to_testassignmentinfinite(c_);
+    httplib::Headers const copier{
+        {"X-Student-Id", "202326202023"},
+        {"X-Student-Name", "Li%20Lei"},
+        {"X-Assignment-Name", "Test%20Assignment%20Infinite"},
+        {"X-Filename", "copied"},
+    };
+    r = c_.Post("/api/assignments/submit-stream", copier, "SB LJF",
+                "application/octet-stream");
+    ASSERT_TRUE(r);
+    ASSERT_EQ(r->status, StatusCode::OK_200);
+
+    // Stored once.
+    r = c_.Get("/api/assignments");
+    ASSERT_TRUE(r);
+    auto const assignments =
+        nlohmann::json::parse(r->body).get<std::vector<Assignment>>();
+    ASSERT_EQ(assignments.size(), 1U);
+    auto const &subs = assignments[0].submissions;
+    EXPECT_EQ(subs.at("202326202022").content_hash,
+              subs.at("202326202023").content_hash);
+    EXPECT_EQ(subs.at("202326202022").filepath,
+              subs.at("202326202023").filepath);
+
+    auto const *const path =
+        "/api/assignments/duplicates?assignment_name=Test%20Assignment%20Infinite";
+    r = c_.Get(path);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::Unauthorized_401);
+
+    r = c_.Post("/api/admin/login", R"({"username":"xhw","password":"xhw"})",
+                "application/json");
+    ASSERT_TRUE(r);
+    auto const token =
+        nlohmann::json::parse(r->body).get<AdminLoginResult>().token;
+    r = c_.Get(path, {{"Authorization", "Bearer " + token}});
+    ASSERT_TRUE(r);
+    ASSERT_EQ(r->status, StatusCode::OK_200) << r->body;
+    auto const groups =
+        nlohmann::json::parse(r->body).get<std::vector<DuplicateGroup>>();
+    ASSERT_EQ(groups.size(), 1U);
+    EXPECT_EQ(groups[0].student_ids,
+              (std::vector<std::string>{"202326202022", "202326202023"}));
+
+    // The blob outlives one of its submissions.
+    r = c_.Post("/api/assignments/submit-stream", copier, "Own work",
+                "application/octet-stream");
+    ASSERT_TRUE(r);
+    ASSERT_EQ(r->status, StatusCode::OK_200);
+    EXPECT_TRUE(std::filesystem::exists(subs.at("202326202022").filepath));
+}
+
+TEST_F(ServerTest, Plagiarism)
+{
+    successfully_add_assignment_testassignmentinfinite(c_);
+    successfully_add_student_ljf(c_);
+    successfully_add_student_lilei(c_);
+
+    std::string const copied =
+        "Winnowing selects the minimum hash of every window of k-grams, "
+        "so that a long enough common substring always shares one. ";
+    successfully_stream_submit_to_testassignmentinfinite(
+        c_, "202326202022", "%E5%88%98%E5%AE%B6%E7%A6%8F",
+        "My own introduction, written by myself. " + copied);
+    successfully_stream_submit_to_testassignmentinfinite(
+        c_, "202326202023", "Li%20Lei",
+        copied + "And a conclusion nobody else wrote at all.");
+
+    auto const auth = admin_authorization(c_);
+    auto const *const path = "/api/assignments/plagiarism"
+                             "?assignment_name=Test%20Assignment%20Infinite";
+    auto r = c_.Get(path, auth);
+    ASSERT_TRUE(r);
+    ASSERT_EQ(r->status, StatusCode::OK_200) << r->body;
+    auto pairs = nlohmann::json::parse(r->body)
+                     .get<std::vector<hc::plagiarism::SimilarPair>>();
+    ASSERT_EQ(pairs.size(), 1U);
+    EXPECT_EQ(pairs[0].first, "202326202022");
+    EXPECT_EQ(pairs[0].second, "202326202023");
+    EXPECT_GT(pairs[0].shared, 0U);
+
+    // Resubmitting own work updates the index.
+    successfully_stream_submit_to_testassignmentinfinite(
+        c_, "202326202023", "Li%20Lei",
+        "Entirely rewritten, with nothing in common with the other one.");
+    r = c_.Get(path, auth);
+    ASSERT_TRUE(r);
+    pairs = nlohmann::json::parse(r->body)
+                .get<std::vector<hc::plagiarism::SimilarPair>>();
+    EXPECT_TRUE(pairs.empty());
+}
+
+TEST_F(ServerTest, NearDuplicates)
+{
+    successfully_add_assignment_testassignmentinfinite(c_);
+    successfully_add_student_ljf(c_);
+    successfully_add_student_lilei(c_);
+
+    auto const report = report_text(40);
+    successfully_stream_submit_to_testassignmentinfinite(
+        c_, "202326202022", "%E5%88%98%E5%AE%B6%E7%A6%8F", report);
+    successfully_stream_submit_to_testassignmentinfinite(
+        c_, "202326202023", "Li%20Lei", report + "Plus a sentence of mine.");
+
+    auto const auth = admin_authorization(c_);
+    auto r = c_.Get("/api/assignments/near-duplicates"
+                    "?assignment_name=Test%20Assignment%20Infinite"
+                    "&student_id=202326202022",
+                    auth);
+    ASSERT_TRUE(r);
+    ASSERT_EQ(r->status, StatusCode::OK_200) << r->body;
+    auto const matches = nlohmann::json::parse(r->body)
+                             .get<std::vector<hc::minhash::Match>>();
+    ASSERT_EQ(matches.size(), 1U);
+    EXPECT_EQ(matches[0].student_id, "202326202023");
+    EXPECT_GT(matches[0].similarity, 0.5);
+
+    r = c_.Get("/api/assignments/near-duplicates"
+               "?assignment_name=Test%20Assignment%20Infinite"
+               "&student_id=202326202099",
+               auth);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::NotFound_404);
+}
+
+TEST_F(ServerTest, SimilarityMatrix)
+{
+    successfully_add_assignment_testassignmentinfinite(c_);
+    successfully_add_student_ljf(c_);
+    successfully_add_student_lilei(c_);
+
+    auto const report = report_text(40);
+    successfully_stream_submit_to_testassignmentinfinite(
+        c_, "202326202022", "%E5%88%98%E5%AE%B6%E7%A6%8F", report);
+    successfully_stream_submit_to_testassignmentinfinite(
+        c_, "202326202023", "Li%20Lei", report + "Plus a sentence of mine.");
+
+    auto const auth = admin_authorization(c_);
+    auto r = c_.Get("/api/assignments/similarity-matrix"
+                    "?assignment_name=Test%20Assignment%20Infinite"
+                    "&measure=containment",
+                    auth);
+    ASSERT_TRUE(r);
+    ASSERT_EQ(r->status, StatusCode::OK_200) << r->body;
+    auto const m = nlohmann::json::parse(r->body).get<SimilarityMatrix>();
+    ASSERT_EQ(m.student_ids,
+              (std::vector<std::string>{"202326202022", "202326202023"}));
+    ASSERT_EQ(m.matrix.size(), 2U);
+    EXPECT_EQ(m.matrix[0][0], 1.0F);
+    EXPECT_EQ(m.matrix[0][1], m.matrix[1][0]);
+    EXPECT_GT(m.matrix[0][1], 0.9F);
+
+    r = c_.Get("/api/assignments/similarity-matrix"
+               "?assignment_name=Test%20Assignment%20Infinite&measure=cosine",
+               auth);
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::BadRequest_400);
+}
+
+TEST_F(ServerTest, SubmissionText)
+{
+    successfully_add_assignment_testassignmentinfinite(c_);
+    successfully_add_student_ljf(c_);
+    httplib::Headers const headers{
+        {"X-Student-Id", "202326202022"},
+        {"X-Student-Name", "%E5%88%98%E5%AE%B6%E7%A6%8F"},
+        {"X-Assignment-Name", "Test%20Assignment%20Infinite"},
+        {"X-Filename", "main.cpp"},
+    };
+    auto r = c_.Post("/api/assignments/submit-stream", headers,
+                     "int main()\r\n{\r\n    return 0;\r\n}\r\n",
+                     "application/octet-stream");
+    ASSERT_TRUE(r);
+    ASSERT_EQ(r->status, StatusCode::OK_200);
+
+    auto const auth = admin_authorization(c_);
+    // Extracted in background, if not yet.
+    using namespace std::chrono_literals;
+    for (auto i = 0; i != 100; ++i) {
+        r = c_.Get("/api/assignments/submission-text"
+                   "?assignment_name=Test%20Assignment%20Infinite"
+                   "&student_id=202326202022",
+                   auth);
         ASSERT_TRUE(r);
-        EXPECT_EQ(r->status, StatusCode::OK_200);
-
-        {
-            auto const j = nlohmann::json::parse(r->body);
-            auto res = j.get<AssignmentsExportResult>();
-            auto download = c_.Get(res.exported_uri);
-            ASSERT_TRUE(download);
-            EXPECT_EQ(download->status, StatusCode::OK_200);
+        if (r->status != StatusCode::Accepted_202) {
+            break;
         }
+        EXPECT_EQ(r->get_header_value("Retry-After"), "1");
+        std::this_thread::sleep_for(10ms);
     }
+    ASSERT_EQ(r->status, StatusCode::OK_200) << r->body;
+    EXPECT_EQ(r->body, "int main()\n{\nreturn 0;\n}");
 }
 
 TEST_F(ServerTest, Stop)
@@ -302,6 +842,62 @@ TEST_F(ServerTest, TeacherAdminFlow)
     EXPECT_EQ(vres.principal, "t01");
 }
 
+TEST_F(ServerTest, ImportRoster)
+{
+    auto r = c_.Post("/api/admin/login", R"({"username":"xhw","password":"xhw"})",
+                     "application/json");
+    ASSERT_TRUE(r);
+    auto const token =
+        nlohmann::json::parse(r->body).get<AdminLoginResult>().token;
+    httplib::Headers const headers{{"Authorization", "Bearer " + token}};
+
+    // A semester of students in one request.
+    constexpr auto n = 10000UZ;
+    std::string csv = "student_id,name\n";
+    for (auto i = 0UZ; i != n; ++i) {
+        csv += std::format("2023{:08},学生{}\n", i, i);
+    }
+    auto const start = std::chrono::steady_clock::now();
+    r = c_.Post("/api/students/import", headers, csv, "text/csv");
+    auto const elapsed = std::chrono::steady_clock::now() - start;
+    ASSERT_TRUE(r);
+    ASSERT_EQ(r->status, StatusCode::OK_200) << r->body;
+    EXPECT_EQ(nlohmann::json::parse(r->body).get<RosterImportResult>().imported,
+              n);
+    spdlog::info(
+        "Imported {} students in {} ms", n,
+        std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+
+    r = c_.Get("/api/students");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(nlohmann::json::parse(r->body).size(), n);
+
+    // One bad row rejects the whole roster.
+    auto const *const bad = R"([
+        {"student_id": "202400000000", "name": "New"},
+        {"student_id": "202300000000", "name": "Existing"}
+    ])";
+    r = c_.Post("/api/students/import", headers, bad, "application/json");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::BadRequest_400);
+    r = c_.Get("/api/students");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(nlohmann::json::parse(r->body).size(), n);
+
+    r = c_.Post("/api/students/import", "202400000000,New", "text/csv");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::Unauthorized_401);
+
+    r = c_.Post("/api/teacher/import", headers,
+                "t01,Alice,pass\nt02,Bob,pass\n", "text/csv");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::OK_200);
+    r = c_.Post("/api/teacher/login", R"({"teacher_id":"t02","password":"pass"})",
+                "application/json");
+    ASSERT_TRUE(r);
+    EXPECT_EQ(r->status, StatusCode::OK_200);
+}
+
 int main(int argc, char **argv)
 {
     spdlog::set_level(spdlog::level::trace); // Toggle when debugging
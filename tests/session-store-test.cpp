@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <hc/session-store.h>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+TEST(TimerWheelTest, FiresInOrder)
+{
+    auto const origin = Clock::time_point{};
+    hc::TimerWheel<int> wheel{1ms, origin};
+    // Across every level, and beyond the top one.
+    std::vector<std::chrono::milliseconds> const due{
+        3ms, 63ms, 64ms, 65ms, 4095ms, 4096ms, 300'000ms, 16'777'300ms,
+        20'000'000ms};
+    for (auto i = 0UZ; i != due.size(); ++i) {
+        wheel.schedule(static_cast<int>(i), origin + due[i]);
+    }
+    EXPECT_EQ(wheel.size(), due.size());
+
+    std::mt19937 rng{42};
+    auto now = origin;
+    std::vector<int> fired;
+    while (wheel.size() != 0) {
+        // Advanced by various steps, as sweeps may be late.
+        now += std::chrono::milliseconds{rng() % 5000};
+        for (auto const i : wheel.advance(now)) {
+            EXPECT_LE(origin + due[i], now) << "Fired early: " << i;
+            // At most one step late.
+            EXPECT_GT(origin + due[i] + 5000ms, now) << "Fired late: " << i;
+            fired.push_back(i);
+        }
+    }
+    EXPECT_TRUE(std::ranges::is_sorted(fired));
+    EXPECT_EQ(fired.size(), due.size());
+}
+
+TEST(TimerWheelTest, RoundsUpToTicks)
+{
+    auto const origin = Clock::time_point{};
+    hc::TimerWheel<int> wheel{10ms, origin};
+    wheel.schedule(1, origin + 15ms);
+    EXPECT_TRUE(wheel.advance(origin + 19ms).empty());
+    EXPECT_EQ(wheel.advance(origin + 20ms), std::vector{1});
+    // Passed already.
+    wheel.schedule(2, origin);
+    EXPECT_EQ(wheel.advance(origin + 30ms), std::vector{2});
+}
+
+TEST(SessionStoreTest, CreatesAndRevokes)
+{
+    hc::SessionStore store{{}};
+    auto const admin = store.create("admin");
+    auto const teacher = store.create("T001");
+    EXPECT_NE(admin, teacher);
+    EXPECT_EQ(store.find(admin), "admin");
+    EXPECT_EQ(store.find(teacher), "T001");
+    EXPECT_EQ(store.find("no such token"), std::nullopt);
+
+    store.revoke(admin);
+    EXPECT_EQ(store.find(admin), std::nullopt);
+    EXPECT_EQ(store.find(teacher), "T001");
+    EXPECT_EQ(store.size(), 1U);
+}
+
+TEST(SessionStoreTest, ExpiresWhenIdle)
+{
+    hc::SessionStore store{
+        {.absolute_ttl = 10s, .idle_ttl = 100ms, .tick = 10ms}};
+    auto const used = store.create("used");
+    auto const idle = store.create("idle");
+    for (auto i = 0; i != 6; ++i) {
+        std::this_thread::sleep_for(40ms);
+        EXPECT_EQ(store.find(used), "used");
+    }
+    EXPECT_EQ(store.find(idle), std::nullopt);
+    store.sweep();
+    // Swept without being looked up.
+    EXPECT_EQ(store.size(), 1U);
+}
+
+TEST(SessionStoreTest, ExpiresAfterAbsoluteTtl)
+{
+    hc::SessionStore store{
+        {.absolute_ttl = 150ms, .idle_ttl = 10s, .tick = 10ms}};
+    auto const token = store.create("admin");
+    auto const start = Clock::now();
+    while (Clock::now() - start < 140ms) {
+        EXPECT_EQ(store.find(token), "admin");
+        std::this_thread::sleep_for(20ms);
+    }
+    std::this_thread::sleep_for(40ms);
+    EXPECT_EQ(store.find(token), std::nullopt);
+    store.sweep();
+    EXPECT_EQ(store.size(), 0U);
+}
+
+TEST(SessionStoreTest, Concurrent)
+{
+    hc::SessionStore store{{.idle_ttl = 500ms, .tick = 10ms, .shards = 4}};
+    std::vector<std::jthread> threads;
+    for (auto t = 0; t != 4; ++t) {
+        threads.emplace_back([&store, t] {
+            auto const principal = std::to_string(t);
+            for (auto i = 0; i != 2000; ++i) {
+                auto const token = store.create(principal);
+                EXPECT_EQ(store.find(token), principal);
+                if (i % 2 == 0) {
+                    store.revoke(token);
+                }
+            }
+        });
+    }
+    threads.clear();
+    std::this_thread::sleep_for(600ms);
+    store.sweep();
+    EXPECT_EQ(store.size(), 0U);
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <hc/similarity.h>
+#include <random>
+#include <thread>
+
+using hc::plagiarism::Fingerprints;
+using namespace hc::similarity;
+
+namespace {
+
+// A set of `size` elements, the first `shared` of which are common to all
+// sets of the same `shared`.
+Fingerprints set(std::size_t size, std::size_t shared, unsigned seed)
+{
+    std::mt19937_64 common{1};
+    std::mt19937_64 own{seed};
+    Fingerprints s;
+    for (auto i = 0UZ; i != size; ++i) {
+        s.push_back(i < shared ? common() : own());
+    }
+    std::ranges::sort(s);
+    return s;
+}
+
+} // namespace
+
+TEST(SimilarityTest, KernelsAgree)
+{
+    std::mt19937_64 rng{42};
+    // Sizes not multiple of vectors exercise the tails.
+    for (auto const n : {0UZ, 1UZ, 3UZ, 7UZ, 8UZ, 13UZ, 64UZ, 1001UZ}) {
+        std::vector<std::uint64_t> a(n);
+        std::vector<std::uint64_t> b(n);
+        std::ranges::generate(a, std::ref(rng));
+        std::ranges::generate(b, std::ref(rng));
+        auto const expected = and_count(a, b, Kernel::scalar);
+        for (auto const k : {Kernel::avx2, Kernel::avx512}) {
+            if (supported(k)) {
+                EXPECT_EQ(and_count(a, b, k), expected)
+                    << to_string(k) << ", n = " << n;
+            }
+        }
+    }
+    EXPECT_TRUE(supported(Kernel::scalar));
+    EXPECT_TRUE(supported(best_kernel()));
+}
+
+TEST(SimilarityTest, Matrix)
+{
+    // 0 and 1 share half, 2 shares nothing, 3 contains 0, 4 is empty.
+    std::vector<Fingerprints> const sets{
+        set(1000, 500, 10), set(1000, 500, 11), set(1000, 0, 12),
+        [] {
+            auto s = set(1000, 500, 10);
+            auto const more = set(1000, 0, 13);
+            s.insert(s.end(), more.begin(), more.end());
+            std::ranges::sort(s);
+            return s;
+        }(),
+        {},
+    };
+    Sketches const sketches{sets};
+    auto const n = sets.size();
+
+    for (auto const measure : {Measure::jaccard, Measure::containment}) {
+        for (auto const threads : {1UZ, 3UZ}) {
+            auto const m = matrix(sketches, {.measure = measure,
+                                             .kernel = Kernel::scalar,
+                                             .threads = threads});
+            ASSERT_EQ(m.size(), n * n);
+            for (auto i = 0UZ; i != n; ++i) {
+                for (auto j = 0UZ; j != n; ++j) {
+                    EXPECT_EQ(m[(i * n) + j], m[(j * n) + i]);
+                }
+            }
+            EXPECT_EQ(m[0], 1.0F);
+            EXPECT_EQ(m[(4 * n) + 4], 0.0F);
+            EXPECT_EQ(m[(0 * n) + 4], 0.0F);
+            EXPECT_LT(m[(0 * n) + 2], 0.05F);
+            if (measure == Measure::jaccard) {
+                EXPECT_NEAR(m[(0 * n) + 1], 1.0 / 3, 0.05);
+                EXPECT_NEAR(m[(0 * n) + 3], 0.5, 0.05);
+            }
+            else {
+                EXPECT_NEAR(m[(0 * n) + 1], 0.5, 0.05);
+                EXPECT_NEAR(m[(0 * n) + 3], 1.0, 0.01);
+            }
+            EXPECT_EQ(m, matrix(sketches, {.measure = measure}));
+        }
+    }
+}
+
+TEST(SimilarityTest, ConcurrentMatrices)
+{
+    std::vector<Fingerprints> sets;
+    for (auto i = 0U; i != 300; ++i) {
+        sets.push_back(set(200, 100, i));
+    }
+    Sketches const sketches{sets};
+    auto const expected = matrix(sketches, {.threads = 1});
+    // More than the budget of helpers, so some run on their own thread.
+    std::vector<std::jthread> callers;
+    for (auto i = 0; i != 16; ++i) {
+        callers.emplace_back([&] { EXPECT_EQ(matrix(sketches), expected); });
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,88 @@
+#include <atomic>
+#include <future>
+#include <gtest/gtest.h>
+#include <hc/task-queue.h>
+#include <latch>
+#include <vector>
+
+TEST(WorkStealingQueueTest, RunsAll)
+{
+    std::atomic_int done{};
+    {
+        hc::WorkStealingQueue q{4, 1024};
+        std::vector<std::jthread> producers;
+        for (auto p = 0; p != 4; ++p) {
+            producers.emplace_back([&] {
+                for (auto i = 0; i != 10'000; ++i) {
+                    while (!q.enqueue([&] { ++done; })) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        producers.clear();
+        q.shutdown();
+    }
+    EXPECT_EQ(done, 40'000);
+}
+
+TEST(WorkStealingQueueTest, BoundsQueue)
+{
+    hc::WorkStealingQueue q{2, 4};
+    std::promise<void> release;
+    std::shared_future<void> const released{release.get_future()};
+    std::latch started{2};
+    for (auto i = 0; i != 2; ++i) {
+        ASSERT_TRUE(q.enqueue([&] {
+            started.count_down();
+            released.wait();
+        }));
+    }
+    started.wait();
+
+    // Both workers are busy, and each of them queues 2.
+    std::atomic_int done{};
+    for (auto i = 0; i != 4; ++i) {
+        EXPECT_TRUE(q.enqueue([&] { ++done; }));
+    }
+    EXPECT_FALSE(q.enqueue([&] { ++done; }));
+
+    release.set_value();
+    q.shutdown();
+    EXPECT_EQ(done, 4);
+    // Shut down already.
+    EXPECT_FALSE(q.enqueue([] {}));
+}
+
+TEST(WorkStealingQueueTest, Steals)
+{
+    hc::WorkStealingQueue q{2, 64};
+    std::promise<void> release;
+    std::shared_future<void> const released{release.get_future()};
+    std::promise<void> started;
+    ASSERT_TRUE(q.enqueue([&] {
+        started.set_value();
+        released.wait();
+    }));
+    started.get_future().wait();
+
+    // Half of them are queued to the blocked worker, and the other has to
+    // take them.
+    std::atomic_int done{};
+    for (auto i = 0; i != 10; ++i) {
+        ASSERT_TRUE(q.enqueue([&] { ++done; }));
+    }
+    while (done != 10) {
+        std::this_thread::yield();
+    }
+    EXPECT_GE(q.steals(), 1U);
+
+    release.set_value();
+    q.shutdown();
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}